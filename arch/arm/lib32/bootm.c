@@ -199,6 +199,7 @@ static int bootm_load_tee_from_file(struct image_data *data)
 {
 	int fd, ret;
 	struct optee_header hdr;
+	u64 start;
 
 	fd = open(data->tee_file, O_RDONLY);
 	if (fd < 0) {
@@ -218,7 +219,10 @@ static int bootm_load_tee_from_file(struct image_data *data)
 		goto out;
 	}
 
-	if (read_full(fd, (void *)data->tee_res->start, hdr.init_size) < 0) {
+	start = bootm_phase_start();
+	ret = read_full(fd, (void *)data->tee_res->start, hdr.init_size);
+	bootm_phase_end(BOOTM_PHASE_READ, start);
+	if (ret < 0) {
 		pr_err("%s", strerror(errno));
 		ret = -errno;
 		release_region(data->tee_res);
@@ -388,6 +392,7 @@ static int do_bootz_linux_fdt(int fd, struct image_data *data, void **outfdt)
 	struct fdt_header __header, *header;
 	void *oftree;
 	int ret;
+	u64 start;
 
 	u32 end;
 
@@ -413,7 +418,9 @@ static int do_bootz_linux_fdt(int fd, struct image_data *data, void **outfdt)
 
 	end -= sizeof(*header);
 
+	start = bootm_phase_start();
 	ret = read_full(fd, oftree + sizeof(*header), end);
+	bootm_phase_end(BOOTM_PHASE_READ, start);
 	if (ret < 0)
 		goto err_free;
 	if (ret < end) {
@@ -462,6 +469,7 @@ static int do_bootz_linux(struct image_data *data)
 	unsigned long load_address = data->os_address;
 	unsigned long mem_free;
 	void *fdt = NULL;
+	u64 phase_start;
 
 	fd = open(data->os_file, O_RDONLY);
 	if (fd < 0) {
@@ -516,8 +524,10 @@ static int do_bootz_linux(struct image_data *data)
 
 	memcpy(zimage, header, sizeof(*header));
 
+	phase_start = bootm_phase_start();
 	ret = read_full(fd, zimage + sizeof(*header),
 			image_size - sizeof(*header));
+	bootm_phase_end(BOOTM_PHASE_READ, phase_start);
 	if (ret < 0)
 		goto err_out;
 	if (ret < image_size - sizeof(*header)) {
@@ -571,14 +581,18 @@ static int aimage_load_resource(int fd, struct resource *r, void* buf, int ps)
 	int ret;
 	void *image = (void *)r->start;
 	unsigned to_read = ps - resource_size(r) % ps;
+	u64 start;
 
+	start = bootm_phase_start();
 	ret = read_full(fd, image, resource_size(r));
 	if (ret < 0)
-		return ret;
+		goto out;
 
 	ret = read_full(fd, buf, to_read);
 	if (ret < 0)
 		printf("could not read dummy %u\n", to_read);
+out:
+	bootm_phase_end(BOOTM_PHASE_READ, start);
 
 	return ret;
 }
@@ -593,6 +607,7 @@ static int do_bootm_aimage(struct image_data *data)
 	struct android_header_comp *cmp;
 	unsigned long mem_free;
 	unsigned long mem_start, mem_size;
+	u64 start;
 
 	ret = sdram_start_and_size(&mem_start, &mem_size);
 	if (ret)
@@ -621,7 +636,9 @@ static int do_bootm_aimage(struct image_data *data)
 	buf = xmalloc(header->page_size);
 
 	to_read = header->page_size - sizeof(*header);
+	start = bootm_phase_start();
 	ret = read_full(fd, buf, to_read);
+	bootm_phase_end(BOOTM_PHASE_READ, start);
 	if (ret < 0) {
 		printf("could not read dummy %d from %s\n", to_read, data->os_file);
 		goto err_out;
@@ -40,6 +40,12 @@ static struct device_d sdl_device = {
 	.platform_data = &mode,
 };
 
+static struct device_d headless_device = {
+	.id	  = DEVICE_ID_DYNAMIC,
+	.name     = "headlessfb",
+	.platform_data = &mode,
+};
+
 static struct device_d devrandom_device = {
 	.id	  = DEVICE_ID_DYNAMIC,
 	.name     = "devrandom",
@@ -55,7 +61,10 @@ static int devices_init(struct device_d *dev)
 	if (sdl_yres)
 		mode.yres = sdl_yres;
 
-	platform_device_register(&sdl_device);
+	if (sdl_headless || !IS_ENABLED(CONFIG_DRIVER_VIDEO_SDL))
+		platform_device_register(&headless_device);
+	else
+		platform_device_register(&sdl_device);
 
 	platform_device_register(&devrandom_device);
 
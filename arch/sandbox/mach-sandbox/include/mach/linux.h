@@ -13,6 +13,8 @@ int linux_register_device(const char *name, void *start, void *end);
 int tap_alloc(const char *dev);
 uint64_t linux_get_time(void);
 int linux_open(const char *filename, int readwrite);
+int linux_create(const char *filename);
+void linux_close(int fd);
 const char *linux_get_builddir(void);
 int linux_open_hostfile(struct hf_info *hf);
 int linux_read(int fd, void *buf, size_t count);
@@ -39,6 +41,7 @@ struct linux_console_data {
 
 extern int sdl_xres;
 extern int sdl_yres;
+extern int sdl_headless;
 struct sdl_fb_info {
 	void *screen_base;
 	int xres;
@@ -48,10 +51,13 @@ struct sdl_fb_info {
 };
 int sdl_video_open(const struct sdl_fb_info *);
 void sdl_video_pause(void);
+void sdl_video_damage(int x, int y, int w, int h);
 void sdl_video_close(void);
 
-int sdl_sound_init(unsigned sample_rate);
+int sdl_sound_init(unsigned sample_rate, unsigned channels);
 int sdl_sound_play(const void *data, unsigned nsamples);
+int sdl_sound_queue(const void *data, unsigned len);
+unsigned sdl_sound_queued(void);
 void sdl_sound_stop(void);
 void sdl_sound_close(void);
 
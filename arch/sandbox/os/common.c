@@ -53,6 +53,7 @@ void __sanitizer_set_death_callback(void (*callback)(void));
 
 int sdl_xres;
 int sdl_yres;
+int sdl_headless;
 
 static struct termios term_orig, term_vi;
 static char erase_char;	/* the users erase character */
@@ -177,6 +178,16 @@ int linux_open(const char *filename, int readwrite)
 	return open(filename, (readwrite ? O_RDWR : O_RDONLY) | O_CLOEXEC);
 }
 
+int linux_create(const char *filename)
+{
+	return open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+}
+
+void linux_close(int fd)
+{
+	close(fd);
+}
+
 int linux_read(int fd, void *buf, size_t count)
 {
 	ssize_t ret;
@@ -456,10 +467,11 @@ static struct option long_options[] = {
 	{"stdinout", 1, 0, 'B'},
 	{"xres",     1, 0, 'x'},
 	{"yres",     1, 0, 'y'},
+	{"headless", 0, 0, 'H'},
 	{0, 0, 0, 0},
 };
 
-static const char optstring[] = "hm:i:e:d:O:I:B:x:y:";
+static const char optstring[] = "hm:i:e:d:O:I:B:x:y:H";
 
 int main(int argc, char *argv[])
 {
@@ -505,6 +517,9 @@ int main(int argc, char *argv[])
 		case 'y':
 			sdl_yres = strtoul(optarg, NULL, 0);
 			break;
+		case 'H':
+			sdl_headless = 1;
+			break;
 		default:
 			break;
 		}
@@ -635,7 +650,8 @@ static void print_usage(const char *prgname)
 "                       stdin and stdout. <filein> and <fileout> can be regular\n"
 "                       files or FIFOs.\n"
 "  -x, --xres=<res>     SDL width.\n"
-"  -y, --yres=<res>     SDL height.\n",
+"  -y, --yres=<res>     SDL height.\n"
+"  -H, --headless       Use a framebuffer in memory only instead of SDL.\n",
 	prgname
 	);
 }
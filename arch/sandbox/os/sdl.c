@@ -17,12 +17,64 @@ static struct sdl_fb_info info;
 static SDL_atomic_t shutdown;
 SDL_Window *window;
 
+/* Region changed since the last upload, protected by damage_lock */
+static SDL_mutex *damage_lock;
+static SDL_cond *damage_cond;
+static SDL_Rect damage;
+static bool damaged;
+
+/*
+ * Without a flush, e.g. after writes to /dev/fb0 that weren't closed
+ * yet, the screen is still refreshed this often.
+ */
+#define SCANOUT_IDLE_MS	1000
+
+void sdl_video_damage(int x, int y, int w, int h)
+{
+	SDL_Rect rect = { .x = x, .y = y, .w = w, .h = h };
+
+	SDL_LockMutex(damage_lock);
+
+	if (damaged)
+		SDL_UnionRect(&damage, &rect, &damage);
+	else
+		damage = rect;
+	damaged = true;
+
+	SDL_CondSignal(damage_cond);
+	SDL_UnlockMutex(damage_lock);
+}
+
+/* Wait for damage, returns false on shutdown */
+static bool scanout_wait(SDL_Rect *rect)
+{
+	bool running = true;
+
+	SDL_LockMutex(damage_lock);
+
+	while (!damaged && (running = !SDL_AtomicGet(&shutdown))) {
+		if (SDL_CondWaitTimeout(damage_cond, damage_lock,
+					SCANOUT_IDLE_MS) == SDL_MUTEX_TIMEDOUT) {
+			damage = (SDL_Rect) { .w = info.xres, .h = info.yres };
+			damaged = true;
+		}
+	}
+
+	*rect = damage;
+	damaged = false;
+
+	SDL_UnlockMutex(damage_lock);
+
+	return running;
+}
+
 static int scanout(void *ptr)
 {
 	SDL_Renderer *renderer;
 	SDL_Surface *surface;
 	SDL_Texture *texture;
 	void *buf = info.screen_base;
+	SDL_Rect rect;
 	int ret = -1;
 
 	renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
@@ -44,10 +96,10 @@ static int scanout(void *ptr)
 		goto free_surface;
 	}
 
-	while (!SDL_AtomicGet(&shutdown)) {
-		SDL_Delay(100);
-
-		SDL_UpdateTexture(texture, NULL, buf, surface->pitch);
+	while (scanout_wait(&rect)) {
+		SDL_UpdateTexture(texture, &rect,
+				  (char *)buf + rect.y * surface->pitch + rect.x * (info.bpp / 8),
+				  surface->pitch);
 		SDL_RenderClear(renderer);
 		SDL_RenderCopy(renderer, texture, NULL, NULL);
 		SDL_RenderPresent(renderer);
@@ -69,8 +121,15 @@ static SDL_Thread *thread;
 void sdl_video_close(void)
 {
 	SDL_AtomicSet(&shutdown, true); /* implies full memory barrier */
+
+	SDL_LockMutex(damage_lock);
+	SDL_CondSignal(damage_cond);
+	SDL_UnlockMutex(damage_lock);
+
 	SDL_WaitThread(thread, NULL);
 	SDL_AtomicSet(&shutdown, false);
+	SDL_DestroyCond(damage_cond);
+	SDL_DestroyMutex(damage_lock);
 	SDL_DestroyWindow(window);
 	SDL_QuitSubSystem(SDL_INIT_VIDEO);
 }
@@ -91,6 +150,17 @@ int sdl_video_open(const struct sdl_fb_info *_info)
 		goto quit_subsystem;
 	}
 
+	damage_lock = SDL_CreateMutex();
+	damage_cond = SDL_CreateCond();
+	if (!damage_lock || !damage_cond) {
+		sdl_perror("create damage signal");
+		goto free_signal;
+	}
+
+	/* the first frame is uploaded in full */
+	damage = (SDL_Rect) { .w = info.xres, .h = info.yres };
+	damaged = true;
+
 	/* All scanout needs to happen in the same thread, because not all
 	 * graphic backends are thread-safe. The window is created in the main
 	 * thread though to work around libEGL crashing with SDL_VIDEODRIVER=wayland
@@ -99,12 +169,16 @@ int sdl_video_open(const struct sdl_fb_info *_info)
 	thread = SDL_CreateThread(scanout, "video-scanout", NULL);
 	if (!thread) {
 		sdl_perror("start scanout thread");
-		goto destroy_window;
+		goto free_signal;
 	}
 
 	return 0;
 
-destroy_window:
+free_signal:
+	SDL_DestroyCond(damage_cond);
+	SDL_DestroyMutex(damage_lock);
+	damage_cond = NULL;
+	damage_lock = NULL;
 	SDL_DestroyWindow(window);
 quit_subsystem:
 	SDL_QuitSubSystem(SDL_INIT_VIDEO);
@@ -114,12 +188,12 @@ quit_subsystem:
 
 static SDL_AudioDeviceID dev;
 
-int sdl_sound_init(unsigned sample_rate)
+int sdl_sound_init(unsigned sample_rate, unsigned channels)
 {
 	SDL_AudioSpec audiospec = {
 		.freq = sample_rate,
 		.format = AUDIO_S16,
-		.channels = 1,
+		.channels = channels,
 		.samples = 2048,
 	};
 
@@ -155,3 +229,13 @@ void sdl_sound_stop(void)
 {
 	SDL_ClearQueuedAudio(dev);
 }
+
+int sdl_sound_queue(const void *data, unsigned len)
+{
+	return SDL_QueueAudio(dev, data, len);
+}
+
+unsigned sdl_sound_queued(void)
+{
+	return SDL_GetQueuedAudioSize(dev);
+}
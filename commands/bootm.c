@@ -125,7 +125,7 @@ BAREBOX_CMD_HELP_OPT ("-o DTB\t","specify open firmware device tree")
 BAREBOX_CMD_HELP_OPT ("-t TEE\t","specify TEE image")
 #endif
 #ifdef CONFIG_BOOTM_VERBOSE
-BAREBOX_CMD_HELP_OPT ("-v\t","verbose")
+BAREBOX_CMD_HELP_OPT ("-v\t","verbose, also print the time spent per load phase")
 #endif
 BAREBOX_CMD_HELP_END
 
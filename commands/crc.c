@@ -11,6 +11,9 @@
 #include <malloc.h>
 #include <libfile.h>
 #include <environment.h>
+#include <clock.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
 
 static int crc_from_file(const char* file, ulong *crc)
 {
@@ -25,6 +28,65 @@ static int crc_from_file(const char* file, ulong *crc)
 	return 0;
 }
 
+/* the reference implementation of each CRC comes first */
+static const struct {
+	const char *name;
+	const char *impl;
+	uint32_t (*crc)(uint32_t, const void *, unsigned int);
+} crc_impls[] = {
+	{ "crc32", "bytewise", crc32_bytewise },
+	{ "crc32", "slice-by-8", crc32 },
+	{ "crc32c", "bytewise", crc32c_bytewise },
+	{ "crc32c", "slice-by-8", crc32c },
+};
+
+#define CRC_BENCH_SIZE	SZ_1M
+#define CRC_BENCH_NS	(200 * MSECOND)
+
+static int crc_bench(void)
+{
+	unsigned char *buf;
+	uint32_t crc, ref = 0;
+	u64 start, ns, bytes;
+	unsigned int mbs;
+	int i, err = 0;
+
+	buf = malloc(CRC_BENCH_SIZE);
+	if (!buf)
+		return -ENOMEM;
+
+	for (i = 0; i < CRC_BENCH_SIZE; i++)
+		buf[i] = i * 7 + (i >> 8);
+
+	for (i = 0; i < ARRAY_SIZE(crc_impls); i++) {
+		bytes = 0;
+		start = get_time_ns();
+
+		do {
+			crc = crc_impls[i].crc(0, buf, CRC_BENCH_SIZE);
+			bytes += CRC_BENCH_SIZE;
+			ns = get_time_ns() - start;
+		} while (ns < CRC_BENCH_NS);
+
+		mbs = div64_u64(bytes * 1000, ns);
+		printf("%-7s %-11s %6u MB/s  0x%08x", crc_impls[i].name,
+		       crc_impls[i].impl, mbs, crc);
+
+		if (!i || strcmp(crc_impls[i].name, crc_impls[i - 1].name)) {
+			ref = crc;
+		} else if (crc != ref) {
+			printf(" != 0x%08x ** ERROR **", ref);
+			err = 1;
+		}
+
+		printf("\n");
+	}
+
+	free(buf);
+
+	return err;
+}
+
 static int do_crc(int argc, char *argv[])
 {
 	loff_t start = 0, size = ~0;
@@ -36,8 +98,10 @@ static int do_crc(int argc, char *argv[])
 	char *crcvarname = NULL, *sizevarname = NULL;
 	int opt, err = 0, filegiven = 0, verify = 0;
 
-	while((opt = getopt(argc, argv, "f:F:v:V:r:s:")) > 0) {
+	while((opt = getopt(argc, argv, "bf:F:v:V:r:s:")) > 0) {
 		switch(opt) {
+		case 'b':
+			return crc_bench() ? COMMAND_ERROR : COMMAND_SUCCESS;
 		case 'f':
 			filename = optarg;
 			filegiven = 1;
@@ -126,12 +190,13 @@ BAREBOX_CMD_HELP_OPT ("-v CRC",  "Verify")
 BAREBOX_CMD_HELP_OPT ("-V FILE", "Verify with CRC read from FILE")
 BAREBOX_CMD_HELP_OPT  ("-r <var>",  "Set <var> to the checksum result")
 BAREBOX_CMD_HELP_OPT  ("-s <var>",  "Set <var> to the data size")
+BAREBOX_CMD_HELP_OPT ("-b",      "Report the speed of the CRC32 and CRC32C implementations")
 BAREBOX_CMD_HELP_END
 
 BAREBOX_CMD_START(crc32)
 	.cmd		= do_crc,
 	BAREBOX_CMD_DESC("CRC32 checksum calculation")
-	BAREBOX_CMD_OPTS("[-f"
+	BAREBOX_CMD_OPTS("[-bf"
 #ifdef CONFIG_CMD_CRC_CMP
 					  "F"
 #endif
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 // SPDX-FileCopyrightText: © 2013 Sascha Hauer, Pengutronix
 
+#include <block.h>
 #include <command.h>
 #include <common.h>
 #include <complete.h>
@@ -85,6 +86,8 @@ static int do_devinfo(int argc, char *argv[])
 		if (dev->info)
 			dev->info(dev);
 
+		blockdevice_info(dev);
+
 		if (dev->parent)
 			printf("Parent: %s\n", dev_name(dev->parent));
 
@@ -93,14 +93,21 @@ static int do_digest(int argc, char *argv[])
 	size_t keylen = 0;
 	size_t digestlen = 0;
 	char *algo = NULL;
+	bool bench = false, prefer = false;
 	int opt;
 	int ret = COMMAND_ERROR;
 
 	if (argc < 2)
 		return COMMAND_ERROR_USAGE;
 
-	while((opt = getopt(argc, argv, "a:k:K:s:S:")) > 0) {
+	while((opt = getopt(argc, argv, "a:bk:K:ps:S:")) > 0) {
 		switch(opt) {
+		case 'b':
+			bench = true;
+			break;
+		case 'p':
+			prefer = true;
+			break;
 		case 'k':
 			key = optarg;
 			keylen = strlen(key);
@@ -121,6 +128,15 @@ static int do_digest(int argc, char *argv[])
 		}
 	}
 
+	if (bench) {
+		ret = digest_algo_bench(algo, prefer);
+		if (ret) {
+			eprintf("algo '%s' not found\n", algo);
+			return COMMAND_ERROR;
+		}
+		return 0;
+	}
+
 	if (!algo)
 		return COMMAND_ERROR_USAGE;
 
@@ -189,10 +205,14 @@ err:
 
 BAREBOX_CMD_HELP_START(digest)
 BAREBOX_CMD_HELP_TEXT("Calculate a digest over a FILE or a memory area.")
+BAREBOX_CMD_HELP_TEXT("With -b, measure the throughput of all drivers of <algo>, or of")
+BAREBOX_CMD_HELP_TEXT("all registered drivers if no -a is given.")
 BAREBOX_CMD_HELP_TEXT("Options:")
 BAREBOX_CMD_HELP_OPT ("-a <algo>\t",  "hash or signature algorithm to use")
 BAREBOX_CMD_HELP_OPT ("-k <key>\t",   "use supplied <key> (ASCII or hex) for MAC")
 BAREBOX_CMD_HELP_OPT ("-K <file>\t",  "use key from <file> (binary) for MAC")
+BAREBOX_CMD_HELP_OPT ("-b\t",         "benchmark digest drivers")
+BAREBOX_CMD_HELP_OPT ("-p\t",         "with -b, make the fastest driver the default")
 BAREBOX_CMD_HELP_OPT ("-s <hex>\t",   "verify data against supplied <hex> (hash, MAC or signature)")
 BAREBOX_CMD_HELP_OPT ("-S <file>\t",  "verify data against <file> (hash, MAC or signature)")
 BAREBOX_CMD_HELP_END
@@ -200,7 +220,7 @@ BAREBOX_CMD_HELP_END
 BAREBOX_CMD_START(digest)
 	.cmd		= do_digest,
 	BAREBOX_CMD_DESC("calculate digest")
-	BAREBOX_CMD_OPTS("-a <algo> [-k <key> | -K <file>] [-s <sig> | -S <file>] FILE|AREA")
+	BAREBOX_CMD_OPTS("-a <algo> [-k <key> | -K <file>] [-s <sig> | -S <file>] FILE|AREA | -b [-p] [-a <algo>]")
 	BAREBOX_CMD_GROUP(CMD_GRP_FILE)
 	BAREBOX_CMD_HELP(cmd_digest_help)
 	BAREBOX_CMD_USAGE(prints_algo_help)
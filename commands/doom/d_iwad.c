@@ -84,11 +84,10 @@ static boolean DirIsFile(char *path, char *filename)
         && !strcasecmp(&path[path_len - filename_len], filename);
 }
 
-// Check if the specified directory contains the specified IWAD
-// file, returning the full path to the IWAD if found, or NULL
-// if not found.
+// Check if the specified directory contains the specified file,
+// returning the full path to the file if found, or NULL if not found.
 
-static char *CheckDirectoryHasIWAD(char *dir, char *iwadname)
+static char *CheckDirectoryHasFile(char *dir, char *iwadname)
 {
     char *filename; 
 
@@ -124,6 +123,27 @@ static char *CheckDirectoryHasIWAD(char *dir, char *iwadname)
     return NULL;
 }
 
+// Check if the specified directory contains the specified IWAD
+// file, either as it is or gzip compressed, returning the full
+// path to the IWAD if found, or NULL if not found.
+
+static char *CheckDirectoryHasIWAD(char *dir, char *iwadname)
+{
+    char *gzname;
+    char *filename;
+
+    filename = CheckDirectoryHasFile(dir, iwadname);
+
+    if (filename == NULL)
+    {
+        gzname = M_StringJoin(iwadname, ".gz", NULL);
+        filename = CheckDirectoryHasFile(dir, gzname);
+        free(gzname);
+    }
+
+    return filename;
+}
+
 // Search a directory to try to find an IWAD
 // Returns the location of the IWAD if found, otherwise NULL.
 
@@ -159,6 +179,7 @@ static GameMission_t IdentifyIWADByName(char *name, int mask)
 {
     size_t i;
     GameMission_t mission;
+    size_t len;
     char *p;
 
     p = strrchr(name, DIR_SEPARATOR);
@@ -168,6 +189,15 @@ static GameMission_t IdentifyIWADByName(char *name, int mask)
         name = p + 1;
     }
 
+    // Ignore the extension of a gzip compressed IWAD.
+
+    len = strlen(name);
+
+    if (len >= 3 && !strcasecmp(name + len - 3, ".gz"))
+    {
+        len -= 3;
+    }
+
     mission = none;
 
     for (i=0; i<arrlen(iwads); ++i)
@@ -181,7 +211,8 @@ static GameMission_t IdentifyIWADByName(char *name, int mask)
 
         // Check if it ends in this IWAD name.
 
-        if (!strcasecmp(name, iwads[i].name))
+        if (strlen(iwads[i].name) == len
+         && !strncasecmp(name, iwads[i].name, len))
         {
             mission = iwads[i].mission;
             break;
@@ -205,10 +236,10 @@ static void BuildIWADDirList(void)
 }
 
 //
-// Searches WAD search paths for an WAD with a specific filename.
-// 
+// Searches WAD search paths for a file with a specific filename.
+//
 
-char *D_FindWADByName(char *name)
+static char *FindFileByName(char *name)
 {
     char *path;
     int i;
@@ -252,6 +283,32 @@ char *D_FindWADByName(char *name)
     return NULL;
 }
 
+//
+// Searches WAD search paths for an WAD with a specific filename,
+// falling back to a gzip compressed copy of it.
+//
+
+char *D_FindWADByName(char *name)
+{
+    char *gzname;
+    char *path;
+
+    path = FindFileByName(name);
+
+    if (path == NULL && !M_StringEndsWith(name, ".gz"))
+    {
+        gzname = M_StringJoin(name, ".gz", NULL);
+        path = FindFileByName(gzname);
+
+        if (path != gzname)
+        {
+            free(gzname);
+        }
+    }
+
+    return path;
+}
+
 //
 // D_TryWADByName
 //
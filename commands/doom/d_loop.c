@@ -39,6 +39,7 @@
 #include "net_server.h"
 #include "net_sdl.h"
 #include "net_loop.h"
+#include "net_udp.h"
 
 // The complete set of data for a particular tic.
 
@@ -76,6 +77,15 @@ int gametic;
 
 boolean singletics = false;
 
+// When set to true, frames are also drawn between tics, with moving
+// things at positions interpolated by D_GetFractionalTic().
+
+boolean uncapped_framerate = false;
+
+// Time the most recent tic was run at.
+
+static int lastticms;
+
 // Index of the local player.
 
 static int localplayer;
@@ -184,6 +194,14 @@ static boolean BuildNewTic(void)
         NET_CL_SendTiccmd(&cmd, maketic);
     }
 
+#endif
+#ifdef FEATURE_NETGAME
+
+    if (net_client_connected)
+    {
+        NET_UDP_SendTiccmd(&cmd, maketic);
+    }
+
 #endif
     ticdata[maketic % BACKUPTICS].cmds[localplayer] = cmd;
     ticdata[maketic % BACKUPTICS].ingame[localplayer] = true;
@@ -219,6 +237,11 @@ void NetUpdate (void)
     NET_CL_Run();
     NET_SV_Run();
 
+#endif
+#ifdef FEATURE_NETGAME
+
+    NET_UDP_Run();
+
 #endif
 
     // check time
@@ -270,8 +293,42 @@ void D_StartNetGame(net_gamesettings_t *settings,
 	settings->extratics = 1;
 	settings->ticdup = 1;
 
+
+#ifdef FEATURE_NETGAME
+    if (net_client_connected)
+    {
+        NET_UDP_StartGame(settings);
+    }
+#endif
+
 	ticdup = settings->ticdup;
 	new_sync = settings->new_sync;
+	localplayer = settings->consoleplayer;
+}
+
+//
+// D_ReceiveTic
+// Called by the network code when the ticcmds of all
+// players for the next tic have arrived.
+//
+void D_ReceiveTic(ticcmd_t *ticcmds, boolean *players_mask)
+{
+    int i;
+
+    for (i = 0; i < NET_MAXPLAYERS; ++i)
+    {
+        if (!drone && i == localplayer)
+        {
+            // This is us.  Don't overwrite it.
+        }
+        else
+        {
+            ticdata[recvtic % BACKUPTICS].cmds[i] = ticcmds[i];
+            ticdata[recvtic % BACKUPTICS].ingame[i] = players_mask[i];
+        }
+    }
+
+    ++recvtic;
 }
 
 boolean D_InitNetGame(net_connect_data_t *connect_data)
@@ -288,6 +345,10 @@ boolean D_InitNetGame(net_connect_data_t *connect_data)
 
     player_class = connect_data->player_class;
 
+#ifdef FEATURE_NETGAME
+    result = NET_UDP_Init(connect_data);
+#endif
+
 #ifdef FEATURE_MULTIPLAYER
 
     //!
@@ -388,6 +449,9 @@ void D_QuitNetGame (void)
     NET_SV_Shutdown();
     NET_CL_Disconnect();
 #endif
+#ifdef FEATURE_NETGAME
+    NET_UDP_Shutdown();
+#endif
 }
 
 static int GetLowTic(void)
@@ -396,7 +460,7 @@ static int GetLowTic(void)
 
     lowtic = maketic;
 
-#ifdef FEATURE_MULTIPLAYER
+#if defined(FEATURE_MULTIPLAYER) || defined(FEATURE_NETGAME)
     if (net_client_connected)
     {
         if (drone || recvtic < lowtic)
@@ -591,6 +655,14 @@ void TryRunTics (void)
 
     while (!PlayersInGame() || lowtic < gametic/ticdup + counts)
     {
+        // With an uncapped framerate, draw another frame
+        // rather than wait for the next tic.
+
+        if (uncapped_framerate && !singletics)
+        {
+            return;
+        }
+
 	NetUpdate ();
 
         lowtic = GetLowTic();
@@ -635,6 +707,7 @@ void TryRunTics (void)
 
             loop_interface->RunTic(set->cmds, set->ingame);
 	    gametic++;
+            lastticms = I_GetTimeMS();
 
 	    // modify command for duplicated tics
 
@@ -645,6 +718,30 @@ void TryRunTics (void)
     }
 }
 
+//
+// How far the game is into the next tic, from 0 right after
+// a tic was run up to FRACUNIT when the next one is due.
+//
+
+fixed_t D_GetFractionalTic(void)
+{
+    int ms;
+
+    if (!uncapped_framerate || singletics)
+    {
+        return FRACUNIT;
+    }
+
+    ms = I_GetTimeMS() - lastticms;
+
+    if (ms < 0 || ms >= 1000 / TICRATE)
+    {
+        return FRACUNIT;
+    }
+
+    return (ms * TICRATE * FRACUNIT) / 1000;
+}
+
 void D_RegisterLoopCallbacks(loop_interface_t *i)
 {
     loop_interface = i;
@@ -20,6 +20,7 @@
 #define __D_LOOP__
 
 #include "net_defs.h"
+#include "m_fixed.h"
 
 // Callback function invoked while waiting for the netgame to start.
 // The callback is invoked when new players are ready. The callback
@@ -61,6 +62,10 @@ void D_QuitNetGame (void);
 //? how many ticks to run?
 void TryRunTics (void);
 
+// Fraction of the next tic that has passed, for drawing frames
+// between tics.
+fixed_t D_GetFractionalTic(void);
+
 // Called at start of game loop to initialize timers
 void D_StartGameLoop(void);
 
@@ -68,13 +73,17 @@ void D_StartGameLoop(void);
 
 boolean D_InitNetGame(net_connect_data_t *connect_data);
 
+// Store the ticcmds of the other players for the next tic.
+
+void D_ReceiveTic(ticcmd_t *ticcmds, boolean *players_mask);
+
 // Start game with specified settings. The structure will be updated
 // with the actual settings for the game.
 
 void D_StartNetGame(net_gamesettings_t *settings,
                     netgame_startup_callback_t callback);
 
-extern boolean singletics;
+extern boolean singletics, uncapped_framerate;
 extern int gametic, ticdup;
 
 #endif
@@ -72,6 +72,7 @@
 
 #include "d_main.h"
 #include "r_main.h"
+#include "r_governor.h"
 #include "d_net.h"
 #include "doom.h"
 
@@ -1206,6 +1207,9 @@ void D_DoomMain (void)
 
     I_DisplayFPSDots(devparm);
 
+    if (devparm)
+        W_EnableLookupStats();
+
     //!
     // @category net
     // @vanilla
@@ -1556,6 +1560,32 @@ void D_DoomMain (void)
 	    showfps = true;
     }
 
+    //!
+    //
+    // Draw frames between tics as well, moving the view and things
+    // smoothly, instead of drawing at most one frame per tic.
+    //
+
+    if (M_CheckParm("-uncapped"))
+    {
+        uncapped_framerate = true;
+    }
+
+    //!
+    // @arg <fps>
+    //
+    // Lower the detail and view size below the menu settings as
+    // needed to hold the given frame rate. Same as setting the
+    // doom.target_fps device parameter.
+    //
+
+    p = M_CheckParmWithArgs("-targetfps", 1);
+
+    if (p)
+    {
+        governor_target_fps = atoi(myargv[p+1]);
+    }
+
     //!
     // @arg [<x> <y> | <xy>]
     // @vanilla
@@ -1645,6 +1675,8 @@ void D_DoomMain (void)
     DEH_printf("ST_Init: Init status bar.\n");
     ST_Init ();
 
+    W_PrintLookupStats();
+
     // If Doom II without a MAP01 lump, this is a store demo.
     // Moved this here so that MAP01 isn't constantly looked up
     // in the main loop.
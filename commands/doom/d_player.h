@@ -158,6 +158,9 @@ typedef struct player_s
     // True if secret level has been done.
     boolean		didsecret;	
 
+    // viewz at the start of the current tic.
+    fixed_t		oldviewz;
+
 } player_t;
 
 
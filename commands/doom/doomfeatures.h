@@ -31,6 +31,12 @@
 
 #undef FEATURE_MULTIPLAYER
 
+// Enables peer to peer network games over UDP ('-net')
+
+#ifdef CONFIG_NET
+#define FEATURE_NETGAME
+#endif
+
 // Enables sound output
 
 #ifdef CONFIG_SOUND
@@ -10,11 +10,29 @@
 
 extern uint32_t* DG_ScreenBuffer;
 
+typedef enum
+{
+    DG_EV_KEY,          // data1: doom key, data2: pressed
+    DG_EV_MOUSEBUTTON,  // data1: button number, data2: pressed
+    DG_EV_MOUSEMOTION,  // data1: dx, data2: dy
+} dg_evtype_t;
+
+typedef struct
+{
+    dg_evtype_t type;
+    int data1;
+    int data2;
+
+    // get_time_ns() when the input driver reported the event
+    uint64_t time;
+} dg_event_t;
+
 void DG_RunDoom(void *arg);
 void DG_DrawFrame(void);
 void DG_SleepMs(uint32_t ms);
 uint32_t DG_GetTicksMs(void);
-int DG_GetKey(int* pressed, unsigned char* key);
+uint32_t DG_GetTicksUs(void);
+int DG_GetEvent(dg_event_t *ev);
 void DG_SetWindowTitle(const char * title);
 
 #endif //DOOM_GENERIC
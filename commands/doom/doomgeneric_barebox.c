@@ -15,17 +15,37 @@
 #include <gui/graphic_utils.h>
 #include <i_video.h>
 #include <bthread.h>
+#include <init.h>
+#include <param.h>
 #include <asm/setjmp.h>
 
 #include "doomgeneric.h"
 #include "z_zone.h"
 #include "doom.h"
-
-#define KEYQUEUE_SIZE 16
-
-static unsigned short s_KeyQueue[KEYQUEUE_SIZE];
-static unsigned int s_KeyQueueWriteIndex = 0;
-static unsigned int s_KeyQueueReadIndex = 0;
+#include "r_governor.h"
+
+/*
+ * Input events are queued by the input notifier and drained once per
+ * tic by I_GetEvent. Each one carries the time the driver reported it,
+ * so the delay until the first frame drawn after it was consumed can
+ * be measured.
+ */
+#define EVENTQUEUE_SIZE 256	/* power of two */
+
+static dg_event_t s_EventQueue[EVENTQUEUE_SIZE];
+/* free running, masked on access */
+static unsigned int s_EventQueueWrite;
+static unsigned int s_EventQueueRead;
+
+static unsigned int s_EventsQueued;
+static unsigned int s_EventsMerged;
+static unsigned int s_EventsDropped;
+
+/* report time of the oldest consumed event not yet on screen, or 0 */
+static uint64_t s_LatencyPending;
+static uint64_t s_LatencySum;
+static uint64_t s_LatencyMax;
+static unsigned int s_LatencyCount;
 
 static int convertToDoomKey(int key)
 {
@@ -54,7 +74,7 @@ static int convertToDoomKey(int key)
 	case KEY_BACKSPACE:
 		return DOOM_KEY_ESCAPE;
 	default:
-		if (key > NR_KEYS)
+		if (key >= NR_KEYS)
 			break;
 		key = keycode_bb_keys[key];
 		if (isprint(key))
@@ -64,24 +84,73 @@ static int convertToDoomKey(int key)
 	return -1;
 }
 
-static void addKeyToQueue(int keyData)
+static void queueEvent(dg_evtype_t type, int data1, int data2, uint64_t time)
 {
-        s_KeyQueue[s_KeyQueueWriteIndex] = keyData;
-        s_KeyQueueWriteIndex++;
-        s_KeyQueueWriteIndex %= KEYQUEUE_SIZE;
+	unsigned int used = s_EventQueueWrite - s_EventQueueRead;
+	dg_event_t *ev;
+
+	/*
+	 * Mouse motion is summed into the newest event if that is motion
+	 * too, so moving the mouse can't fill the queue.
+	 */
+	if (type == DG_EV_MOUSEMOTION && used) {
+		ev = &s_EventQueue[(s_EventQueueWrite - 1) & (EVENTQUEUE_SIZE - 1)];
+		if (ev->type == DG_EV_MOUSEMOTION) {
+			ev->data1 += data1;
+			ev->data2 += data2;
+			s_EventsMerged++;
+			return;
+		}
+	}
+
+	if (used == EVENTQUEUE_SIZE) {
+		s_EventsDropped++;
+		return;
+	}
+
+	ev = &s_EventQueue[s_EventQueueWrite & (EVENTQUEUE_SIZE - 1)];
+	ev->type = type;
+	ev->data1 = data1;
+	ev->data2 = data2;
+	ev->time = time;
+
+	s_EventQueueWrite++;
+	s_EventsQueued++;
 }
 
 static void key_input_notify(struct input_notifier *in,
 			     struct input_event *ev)
 {
-	int keyData = convertToDoomKey(ev->code);
+	int keyData;
 
-	if (keyData < 0)
+	if (ev->type == EV_REL) {
+		if (ev->code == REL_X)
+			queueEvent(DG_EV_MOUSEMOTION, ev->value, 0, ev->time);
+		else if (ev->code == REL_Y)
+			queueEvent(DG_EV_MOUSEMOTION, 0, ev->value, ev->time);
 		return;
+	}
 
-	keyData |= ev->value << 8;
+	if (ev->type != EV_KEY)
+		return;
 
-	addKeyToQueue(keyData);
+	switch (ev->code) {
+	case BTN_LEFT:
+		queueEvent(DG_EV_MOUSEBUTTON, 0, ev->value, ev->time);
+		return;
+	case BTN_RIGHT:
+		queueEvent(DG_EV_MOUSEBUTTON, 1, ev->value, ev->time);
+		return;
+	case BTN_MIDDLE:
+		queueEvent(DG_EV_MOUSEBUTTON, 2, ev->value, ev->time);
+		return;
+	}
+
+	keyData = convertToDoomKey(ev->code);
+	if (keyData < 0)
+		return;
+
+	queueEvent(DG_EV_KEY, keyData, ev->value, ev->time);
 }
 
 static struct input_notifier notifier = { key_input_notify };
@@ -121,6 +190,11 @@ static int DG_Init(void)
 	s_Fb.red.offset = info->red.offset;
 	s_Fb.transp.offset = info->transp.offset;
 
+	s_EventQueueRead = s_EventQueueWrite = 0;
+	s_EventsQueued = s_EventsMerged = s_EventsDropped = 0;
+	s_LatencyPending = s_LatencySum = s_LatencyMax = 0;
+	s_LatencyCount = 0;
+
 	if (IS_ENABLED(CONFIG_INPUT)) {
 		input = console_get_by_name("input");
 		if (input && console_open(input) == 0)
@@ -142,12 +216,38 @@ static void DG_Exit(void)
 
 	fb_close(sc);
 
+	printf("input: %u events queued, %u merged, %u dropped\n",
+	       s_EventsQueued, s_EventsMerged, s_EventsDropped);
+	if (s_LatencyCount)
+		printf("input to frame latency: avg %llu us, max %llu us over %u samples\n",
+		       div_u64(div_u64(s_LatencySum, s_LatencyCount), 1000),
+		       div_u64(s_LatencyMax, 1000), s_LatencyCount);
+
         Z_FreeMemory();
 
         pr_notice("DOOM port doesn't release all resources. State now:\n");
         malloc_stats();
 }
 
+/*
+ * Time the game may run before the renderer and thinkers yield to
+ * background services at their checkpoints, 0 to yield once per frame
+ * only.
+ */
+static int doom_timeslice_us = 5000;
+static struct bthread *doom_thread;
+
+static int doom_timeslice_set(struct param_d *p, void *priv)
+{
+	if (doom_timeslice_us < 0)
+		return -EINVAL;
+
+	if (doom_thread)
+		bthread_set_slice(doom_thread, doom_timeslice_us * 1000ULL);
+
+	return 0;
+}
+
 void DG_RunDoom(void *arg)
 {
     int ret;
@@ -156,12 +256,17 @@ void DG_RunDoom(void *arg)
     if (WARN_ON(ret < 0))
 	    return;
 
+    doom_thread = current;
+    bthread_set_slice(current, doom_timeslice_us * 1000ULL);
+
     ret = setjmp(exit_jmpbuf);
     if (!ret)
 	    D_DoomMain();
 
     DG_Exit();
 
+    doom_thread = NULL;
+
     WARN_ON(ret == EXIT_SUCCESS ? 0 : ret);
 }
 
@@ -169,6 +274,28 @@ extern int showfps;
 
 void DG_DrawFrame(void)
 {
+	struct fb_rect rect;
+	uint64_t latency;
+
+	/* I_FinishUpdate centers the view horizontally only */
+	rect.x1 = (s_Fb.xres - SCREENWIDTH * fb_scaling) / 2;
+	rect.x2 = rect.x1 + SCREENWIDTH * fb_scaling;
+	rect.y1 = 0;
+	rect.y2 = SCREENHEIGHT * fb_scaling;
+
+	fb_damage(sc->info, &rect);
+	fb_flush(sc->info);
+
+	if (s_LatencyPending) {
+		latency = get_time_ns() - s_LatencyPending;
+		s_LatencyPending = 0;
+
+		s_LatencySum += latency;
+		if (latency > s_LatencyMax)
+			s_LatencyMax = latency;
+		s_LatencyCount++;
+	}
+
 	bthread_reschedule();
 }
 
@@ -182,28 +309,88 @@ uint32_t DG_GetTicksMs()
 	return div_u64(get_time_ns(), 1000000);
 }
 
-int DG_GetKey(int* pressed, unsigned char* doomKey)
+uint32_t DG_GetTicksUs(void)
 {
+	return div_u64(get_time_ns(), 1000);
+}
 
-	if (s_KeyQueueReadIndex == s_KeyQueueWriteIndex)
-	{
-		//key queue is empty
-
+int DG_GetEvent(dg_event_t *ev)
+{
+	if (s_EventQueueRead == s_EventQueueWrite)
 		return 0;
-	}
-	else
-	{
-		unsigned short keyData = s_KeyQueue[s_KeyQueueReadIndex];
-		s_KeyQueueReadIndex++;
-		s_KeyQueueReadIndex %= KEYQUEUE_SIZE;
 
-		*pressed = keyData >> 8;
-		*doomKey = keyData & 0xFF;
+	*ev = s_EventQueue[s_EventQueueRead & (EVENTQUEUE_SIZE - 1)];
+	s_EventQueueRead++;
 
-		return 1;
-	}
+	/* the frame after this tic is the first that can show it */
+	if (!s_LatencyPending)
+		s_LatencyPending = ev->time;
+
+	return 1;
 }
 
 void DG_SetWindowTitle(const char * title)
 {
 }
+
+/*
+ * The doom device holds the frame rate governor's and scheduler settings
+ * between runs and shows what the governor did.
+ */
+static struct device_d doom_device = {
+	.name = "doom",
+	.id = DEVICE_ID_SINGLE,
+};
+
+static const char * const doom_detail_names[] = { "high", "low" };
+
+static char *doom_render_history;
+
+static int doom_render_history_get(struct param_d *p, void *priv)
+{
+	char *s;
+	int i;
+
+	free(doom_render_history);
+	doom_render_history = s = xzalloc(GOVERNOR_HISTORY * 11 + 1);
+
+	/* oldest first, skipping frames not rendered yet */
+	for (i = 0; i < GOVERNOR_HISTORY; i++) {
+		uint32_t us = governor_history[(governor_history_pos + i) %
+					       GOVERNOR_HISTORY];
+
+		if (us)
+			s += sprintf(s, "%s%u", s == doom_render_history ? "" : " ",
+				     us);
+	}
+
+	return 0;
+}
+
+static int doom_device_init(void)
+{
+	int ret;
+
+	ret = register_device(&doom_device);
+	if (ret)
+		return ret;
+
+	dev_add_param_int(&doom_device, "target_fps", NULL, NULL,
+			  &governor_target_fps, "%d", NULL);
+	dev_add_param_int(&doom_device, "timeslice_us", doom_timeslice_set,
+			  NULL, &doom_timeslice_us, "%d", NULL);
+	dev_add_param_int_ro(&doom_device, "governor_level",
+			     &governor_level, "%d");
+	dev_add_param_enum_ro(&doom_device, "detail", &governor_detail,
+			      doom_detail_names, ARRAY_SIZE(doom_detail_names));
+	dev_add_param_int_ro(&doom_device, "screenblocks",
+			     &governor_screenblocks, "%d");
+	dev_add_param_int_ro(&doom_device, "render_us",
+			     &governor_render_us, "%d");
+	dev_add_param_string(&doom_device, "render_history",
+			     param_set_readonly, doom_render_history_get,
+			     &doom_render_history, NULL);
+
+	return 0;
+}
+device_initcall(doom_device_init);
@@ -36,6 +36,7 @@
 #include "i_video.h"
 
 #include "p_setup.h"
+#include "p_prefetch.h"
 #include "p_saveg.h"
 #include "p_tick.h"
 
@@ -591,6 +592,9 @@ void G_DoLoadLevel (void)
 { 
     int             i; 
 
+    // Whatever the prefetcher has loaded is used from here on.
+    P_CancelPrefetch ();
+
     // Set the sky map.
     // First thing, we have a dummy sky texture name,
     //  a flat. The data is in the WAD only because
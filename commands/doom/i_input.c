@@ -41,6 +41,10 @@ int vanilla_keyboard_mapping = 1;
 
 static int shiftdown = 0;
 
+// Mouse buttons currently held, bit n for button n.
+
+static int mouse_button_state = 0;
+
 // Lookup table for mapping ASCII characters to their equivalent when
 // shift is pressed on an American layout keyboard:
 static const char shiftxform[] =
@@ -127,26 +131,53 @@ static void UpdateShiftStatus(int pressed, unsigned char key)
 }
 
 
+static void UpdateMouseButtons(int pressed, int button)
+{
+    if (pressed)
+    {
+        mouse_button_state |= 1 << button;
+    }
+    else
+    {
+        mouse_button_state &= ~(1 << button);
+    }
+}
+
 void I_GetEvent(void)
 {
     event_t event;
-    int pressed;
-    unsigned char key;
+    dg_event_t dgevent;
+    boolean mouse_moved = false;
+    int mouse_dx = 0, mouse_dy = 0;
 
-    
-	while (DG_GetKey(&pressed, &key))
+    while (DG_GetEvent(&dgevent))
     {
-        UpdateShiftStatus(pressed, key);
+        if (dgevent.type == DG_EV_MOUSEBUTTON)
+        {
+            UpdateMouseButtons(dgevent.data2, dgevent.data1);
+            mouse_moved = true;
+            continue;
+        }
+
+        if (dgevent.type == DG_EV_MOUSEMOTION)
+        {
+            mouse_dx += dgevent.data1;
+            mouse_dy += dgevent.data2;
+            mouse_moved = true;
+            continue;
+        }
+
+        UpdateShiftStatus(dgevent.data2, dgevent.data1);
 
         // process event
         
-        if (pressed)
+        if (dgevent.data2)
         {
             // data1 has the key pressed, data2 has the character
             // (shift-translated, etc)
             event.type = ev_keydown;
-            event.data1 = TranslateKey(key);
-            event.data2 = GetTypedChar(key);
+            event.data1 = TranslateKey(dgevent.data1);
+            event.data2 = GetTypedChar(dgevent.data1);
 
             if (event.data1 != 0)
             {
@@ -156,7 +187,7 @@ void I_GetEvent(void)
         else
         {
             event.type = ev_keyup;
-            event.data1 = TranslateKey(key);
+            event.data1 = TranslateKey(dgevent.data1);
 
             // data2 is just initialized to zero for ev_keyup.
             // For ev_keydown it's the shifted Unicode character
@@ -174,16 +205,16 @@ void I_GetEvent(void)
         }
     }
 
+    // Motion and buttons of the whole tic go out as one event.
 
-                /*
-            case SDL_MOUSEMOTION:
-                event.type = ev_mouse;
-                event.data1 = mouse_button_state;
-                event.data2 = AccelerateMouse(sdlevent.motion.xrel);
-                event.data3 = -AccelerateMouse(sdlevent.motion.yrel);
-                D_PostEvent(&event);
-                break;
-                */
+    if (mouse_moved)
+    {
+        event.type = ev_mouse;
+        event.data1 = mouse_button_state;
+        event.data2 = mouse_dx;
+        event.data3 = -mouse_dy;
+        D_PostEvent(&event);
+    }
 }
 
 void I_InitInput(void)
@@ -0,0 +1,1125 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	System interface for music: MUS lumps played on a fixed
+//	point, OPL2 style FM synthesizer using the GENMIDI
+//	instrument patches, mixed into the PCM sound output.
+//
+//	Like the OPL, envelopes and levels are attenuations on a
+//	log scale, 256 units per halving of the amplitude, which
+//	are converted to linear gain through a table. Envelopes are
+//	only advanced once per block of samples, so per sample each
+//	operator costs a sine table lookup and a multiply.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <clock.h>
+#include <linux/math64.h>
+
+#include "doomtype.h"
+
+#include "i_sound.h"
+#include "i_swap.h"
+#include "m_argv.h"
+#include "tables.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+// Samples rendered between envelope updates, about 3ms.
+
+#define OPL_BLOCK		128
+
+#define OPL_NUM_VOICES		9
+
+#define MUS_NUM_CHANNELS	16
+#define MUS_PERCUSSION_CHAN	15
+
+// MUS timing is 140 ticks per second.
+
+#define MUS_TICRATE		140
+
+// Attenuation units per halving of the amplitude (6dB).
+// Everything beyond ENV_SILENT (96dB) is inaudible.
+
+#define ENV_SILENT		4096
+
+#define GENMIDI_HEADER		"#OPL_II#"
+#define GENMIDI_NUM_INSTRS	128
+#define GENMIDI_NUM_PERCUSSION	47
+
+#define GENMIDI_FLAG_FIXED	0x0001
+
+typedef struct
+{
+    byte tremolo;
+    byte attack;
+    byte sustain;
+    byte waveform;
+    byte scale;
+    byte level;
+} PACKEDATTR genmidi_op_t;
+
+typedef struct
+{
+    genmidi_op_t modulator;
+    byte feedback;
+    genmidi_op_t carrier;
+    byte unused;
+    short base_note_offset;
+} PACKEDATTR genmidi_voice_t;
+
+typedef struct
+{
+    unsigned short flags;
+    byte fine_tuning;
+    byte fixed_note;
+
+    genmidi_voice_t voices[2];
+} PACKEDATTR genmidi_instr_t;
+
+typedef enum
+{
+    ENV_ATTACK,
+    ENV_DECAY,
+    ENV_SUSTAIN,
+    ENV_RELEASE,
+    ENV_OFF,
+} envstate_t;
+
+typedef struct
+{
+    // Phase, a full cycle is 2^32, and the phase
+    // increment per sample.
+    unsigned int phase;
+    unsigned int inc;
+
+    // Frequency multiplier from the patch, times two.
+    int mult2;
+    int waveform;
+
+    // Envelope: attenuation in 16.16 fixed point, and
+    // its change per sample in each stage.
+    envstate_t state;
+    int env;
+    int attack_step;
+    int decay_step;
+    int release_step;
+    int sustain_level;
+    boolean sustained;
+
+    // Total level from the patch.
+    int level;
+
+    // Linear gain for the current block, 16.16 fixed point.
+    int gain;
+} opl_operator_t;
+
+typedef struct
+{
+    opl_operator_t mod;
+    opl_operator_t car;
+
+    // Modulator feedback shift, 0 for none, and its last outputs.
+    int feedback;
+    int fb1, fb2;
+
+    // Additive synthesis instead of FM.
+    boolean additive;
+
+    // Which MUS channel and note is playing on this voice.
+    int channel;
+    int key;
+    int note;
+    int base_note_offset;
+
+    // Velocity times channel volume.
+    int volume;
+
+    // For stealing the oldest voice.
+    unsigned int age;
+} opl_voice_t;
+
+typedef struct
+{
+    int instrument;
+    int volume;
+    int last_velocity;
+
+    // Pitch bend in 1/32 semitones.
+    int bend;
+} mus_channel_t;
+
+typedef struct
+{
+    byte id[4];
+    unsigned short scorelen;
+    unsigned short scorestart;
+    unsigned short primarychannels;
+    unsigned short secondarychannels;
+    unsigned short instrumentcount;
+} PACKEDATTR musheader_t;
+
+typedef struct
+{
+    const byte *score;
+    unsigned int scorelen;
+} mus_song_t;
+
+// Frequency in 16.16 fixed point Hz of the lowest MIDI octave,
+// in steps of 1/32 semitone.
+
+static const unsigned int freq_curve[384] =
+{
+    535809, 536777, 537747, 538719, 539692, 540667, 541644, 542622,
+    543603, 544585, 545569, 546554, 547542, 548531, 549522, 550515,
+    551510, 552506, 553504, 554504, 555506, 556510, 557515, 558522,
+    559531, 560542, 561555, 562570, 563586, 564604, 565624, 566646,
+    567670, 568696, 569723, 570752, 571784, 572817, 573852, 574888,
+    575927, 576968, 578010, 579054, 580100, 581148, 582198, 583250,
+    584304, 585360, 586417, 587477, 588538, 589601, 590667, 591734,
+    592803, 593874, 594947, 596022, 597099, 598177, 599258, 600341,
+    601425, 602512, 603601, 604691, 605784, 606878, 607975, 609073,
+    610173, 611276, 612380, 613487, 614595, 615705, 616818, 617932,
+    619049, 620167, 621287, 622410, 623534, 624661, 625790, 626920,
+    628053, 629188, 630324, 631463, 632604, 633747, 634892, 636039,
+    637188, 638339, 639493, 640648, 641805, 642965, 644127, 645290,
+    646456, 647624, 648794, 649966, 651141, 652317, 653496, 654676,
+    655859, 657044, 658231, 659420, 660612, 661805, 663001, 664199,
+    665399, 666601, 667805, 669012, 670221, 671431, 672645, 673860,
+    675077, 676297, 677519, 678743, 679969, 681198, 682428, 683661,
+    684896, 686134, 687374, 688615, 689860, 691106, 692354, 693605,
+    694859, 696114, 697372, 698632, 699894, 701158, 702425, 703694,
+    704965, 706239, 707515, 708793, 710074, 711357, 712642, 713930,
+    715219, 716512, 717806, 719103, 720402, 721704, 723008, 724314,
+    725623, 726934, 728247, 729563, 730881, 732201, 733524, 734849,
+    736177, 737507, 738839, 740174, 741512, 742851, 744193, 745538,
+    746885, 748234, 749586, 750940, 752297, 753656, 755018, 756382,
+    757749, 759118, 760489, 761863, 763240, 764618, 766000, 767384,
+    768770, 770159, 771551, 772945, 774341, 775740, 777142, 778546,
+    779952, 781361, 782773, 784187, 785604, 787024, 788445, 789870,
+    791297, 792727, 794159, 795594, 797031, 798471, 799914, 801359,
+    802807, 804257, 805710, 807166, 808624, 810085, 811549, 813015,
+    814484, 815955, 817429, 818906, 820386, 821868, 823353, 824840,
+    826331, 827824, 829319, 830818, 832319, 833822, 835329, 836838,
+    838350, 839865, 841382, 842902, 844425, 845951, 847479, 849010,
+    850544, 852081, 853620, 855162, 856707, 858255, 859806, 861359,
+    862915, 864474, 866036, 867601, 869169, 870739, 872312, 873888,
+    875467, 877049, 878633, 880221, 881811, 883404, 885000, 886599,
+    888201, 889806, 891413, 893024, 894637, 896253, 897873, 899495,
+    901120, 902748, 904379, 906013, 907650, 909290, 910933, 912578,
+    914227, 915879, 917534, 919191, 920852, 922516, 924182, 925852,
+    927525, 929201, 930879, 932561, 934246, 935934, 937625, 939319,
+    941016, 942716, 944419, 946126, 947835, 949547, 951263, 952982,
+    954703, 956428, 958156, 959887, 961622, 963359, 965099, 966843,
+    968590, 970340, 972093, 973849, 975609, 977371, 979137, 980906,
+    982678, 984454, 986232, 988014, 989799, 991587, 993379, 995174,
+    996972, 998773, 1000577, 1002385, 1004196, 1006010, 1007828, 1009649,
+    1011473, 1013300, 1015131, 1016965, 1018803, 1020643, 1022487, 1024335,
+    1026185, 1028039, 1029897, 1031757, 1033621, 1035489, 1037360, 1039234,
+    1041111, 1042992, 1044877, 1046765, 1048656, 1050550, 1052448, 1054350,
+    1056255, 1058163, 1060075, 1061990, 1063909, 1065831, 1067757, 1069686,
+};
+
+// 2^(-i/256) in 1.15 fixed point, converts attenuation to gain.
+
+static const unsigned int exp_table[256] =
+{
+    32768, 32679, 32591, 32503, 32415, 32327, 32240, 32153,
+    32066, 31979, 31893, 31806, 31720, 31635, 31549, 31464,
+    31379, 31294, 31209, 31125, 31041, 30957, 30873, 30790,
+    30706, 30623, 30541, 30458, 30376, 30293, 30212, 30130,
+    30048, 29967, 29886, 29805, 29725, 29644, 29564, 29484,
+    29405, 29325, 29246, 29167, 29088, 29009, 28931, 28852,
+    28774, 28697, 28619, 28542, 28464, 28388, 28311, 28234,
+    28158, 28082, 28006, 27930, 27855, 27779, 27704, 27629,
+    27554, 27480, 27406, 27332, 27258, 27184, 27110, 27037,
+    26964, 26891, 26818, 26746, 26674, 26601, 26530, 26458,
+    26386, 26315, 26244, 26173, 26102, 26031, 25961, 25891,
+    25821, 25751, 25681, 25612, 25543, 25474, 25405, 25336,
+    25268, 25199, 25131, 25063, 24995, 24928, 24860, 24793,
+    24726, 24659, 24593, 24526, 24460, 24394, 24328, 24262,
+    24196, 24131, 24066, 24001, 23936, 23871, 23806, 23742,
+    23678, 23614, 23550, 23486, 23423, 23359, 23296, 23233,
+    23170, 23108, 23045, 22983, 22921, 22859, 22797, 22735,
+    22674, 22613, 22552, 22491, 22430, 22369, 22309, 22248,
+    22188, 22128, 22068, 22009, 21949, 21890, 21831, 21772,
+    21713, 21654, 21595, 21537, 21479, 21421, 21363, 21305,
+    21247, 21190, 21133, 21076, 21019, 20962, 20905, 20849,
+    20792, 20736, 20680, 20624, 20568, 20513, 20457, 20402,
+    20347, 20292, 20237, 20182, 20127, 20073, 20019, 19965,
+    19911, 19857, 19803, 19750, 19696, 19643, 19590, 19537,
+    19484, 19431, 19379, 19326, 19274, 19222, 19170, 19118,
+    19066, 19015, 18963, 18912, 18861, 18810, 18759, 18708,
+    18658, 18607, 18557, 18507, 18457, 18407, 18357, 18308,
+    18258, 18209, 18160, 18110, 18061, 18013, 17964, 17915,
+    17867, 17819, 17770, 17722, 17674, 17627, 17579, 17531,
+    17484, 17437, 17390, 17343, 17296, 17249, 17202, 17156,
+    17109, 17063, 17017, 16971, 16925, 16879, 16834, 16788,
+    16743, 16697, 16652, 16607, 16562, 16518, 16473, 16428,
+};
+
+// OPL frequency multipliers, times two.
+
+static const int mult_table[16] =
+{
+    1, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 20, 24, 24, 30, 30,
+};
+
+extern int snd_samplerate;
+
+static int genmidi_lump;
+static const genmidi_instr_t *main_instrs;
+static const genmidi_instr_t *percussion_instrs;
+
+static opl_voice_t voices[OPL_NUM_VOICES];
+static mus_channel_t channels[MUS_NUM_CHANNELS];
+static unsigned int voice_age;
+
+static mus_song_t *playing_song;
+static boolean song_looping;
+static boolean music_paused;
+static int music_volume = 127;
+
+// Position in the score, and samples (16.16 fixed point) until
+// the next event.
+static unsigned int score_pos;
+static uint64_t next_event;
+static unsigned int tick_samples;
+
+//
+// Operators
+//
+
+static int AttenuationToGain(int att)
+{
+    if (att >= ENV_SILENT)
+    {
+        return 0;
+    }
+
+    return exp_table[att & 255] >> (att >> 8);
+}
+
+// Per sample envelope step to cover the full range in ms.
+
+static int EnvelopeStep(unsigned int ms)
+{
+    unsigned int samples;
+
+    samples = (ms * snd_samplerate) / 1000;
+
+    if (samples == 0)
+    {
+        return ENV_SILENT << 16;
+    }
+
+    return (ENV_SILENT << 16) / samples;
+}
+
+static void SetupOperator(opl_operator_t *op, const genmidi_op_t *patch,
+                          int level)
+{
+    int rate;
+
+    op->mult2 = mult_table[patch->tremolo & 0x0f];
+    op->sustained = (patch->tremolo & 0x20) != 0;
+    op->waveform = patch->waveform & 0x03;
+
+    // Total level is in 0.75dB steps, sustain level in 3dB.
+
+    op->level = (level & 0x3f) * 32;
+    op->sustain_level = ((patch->sustain >> 4) * 128) << 16;
+
+    // Rates roughly double the speed for every step,
+    // rate 0 never changes the envelope.
+
+    rate = patch->attack >> 4;
+    op->attack_step = rate ? EnvelopeStep(2826 >> (rate - 1)) : 0;
+
+    rate = patch->attack & 0x0f;
+    op->decay_step = rate ? EnvelopeStep(39280 >> (rate - 1)) : 0;
+
+    rate = patch->sustain & 0x0f;
+    op->release_step = rate ? EnvelopeStep(39280 >> (rate - 1)) : 0;
+
+    op->state = ENV_ATTACK;
+    op->env = ENV_SILENT << 16;
+    op->phase = 0;
+}
+
+static void AdvanceEnvelope(opl_operator_t *op, unsigned int n)
+{
+    int64_t env = op->env;
+
+    switch (op->state)
+    {
+        case ENV_ATTACK:
+            env -= (int64_t) op->attack_step * n;
+
+            if (env <= 0)
+            {
+                env = 0;
+                op->state = ENV_DECAY;
+            }
+            break;
+
+        case ENV_DECAY:
+            env += (int64_t) op->decay_step * n;
+
+            if (env >= op->sustain_level)
+            {
+                env = op->sustain_level;
+                op->state = op->sustained ? ENV_SUSTAIN : ENV_RELEASE;
+            }
+            break;
+
+        case ENV_SUSTAIN:
+            break;
+
+        case ENV_RELEASE:
+            env += (int64_t) op->release_step * n;
+
+            if (env >= ENV_SILENT << 16)
+            {
+                env = ENV_SILENT << 16;
+                op->state = ENV_OFF;
+            }
+            break;
+
+        case ENV_OFF:
+            break;
+    }
+
+    op->env = env;
+    op->gain = AttenuationToGain((op->env >> 16) + op->level);
+}
+
+// Waveform lookup, index is FINEANGLES per cycle.
+
+static inline int OperatorWave(int waveform, unsigned int index)
+{
+    index &= FINEMASK;
+
+    switch (waveform)
+    {
+        case 0:
+            return finesine[index];
+
+        case 1:
+            // Half sine
+            return index < FINEANGLES / 2 ? finesine[index] : 0;
+
+        case 2:
+            // Absolute sine
+            return finesine[index & (FINEANGLES / 2 - 1)];
+
+        default:
+            // Quarter sine pulses
+            return index & (FINEANGLES / 4) ?
+                   0 : finesine[index & (FINEANGLES / 4 - 1)];
+    }
+}
+
+//
+// Voices
+//
+
+static void SetVoiceFrequency(opl_voice_t *voice)
+{
+    unsigned int hz;
+    unsigned int inc;
+    int index;
+
+    index = (voice->note + voice->base_note_offset) * 32
+          + channels[voice->channel].bend;
+
+    if (index < 0)
+    {
+        index = 0;
+    }
+
+    hz = freq_curve[index % 384] << (index / 384);
+    inc = div_u64((uint64_t) hz << 16, snd_samplerate);
+
+    voice->mod.inc = (inc * voice->mod.mult2) >> 1;
+    voice->car.inc = (inc * voice->car.mult2) >> 1;
+}
+
+static opl_voice_t *AllocateVoice(void)
+{
+    opl_voice_t *result;
+    int i;
+
+    // Use a silent voice, or else the one released first,
+    // or else the oldest.
+
+    result = &voices[0];
+
+    for (i = 0; i < OPL_NUM_VOICES; ++i)
+    {
+        if (voices[i].car.state == ENV_OFF)
+        {
+            return &voices[i];
+        }
+
+        if ((voices[i].key < 0) > (result->key < 0)
+         || ((voices[i].key < 0) == (result->key < 0)
+          && voices[i].age < result->age))
+        {
+            result = &voices[i];
+        }
+    }
+
+    return result;
+}
+
+static void KeyOn(int channel, int key, int velocity)
+{
+    const genmidi_instr_t *instr;
+    const genmidi_voice_t *patch;
+    opl_voice_t *voice;
+    int note;
+
+    if (channel == MUS_PERCUSSION_CHAN)
+    {
+        if (key < 35 || key > 81)
+        {
+            return;
+        }
+
+        instr = &percussion_instrs[key - 35];
+    }
+    else
+    {
+        instr = &main_instrs[channels[channel].instrument];
+    }
+
+    note = key;
+
+    if (SHORT(instr->flags) & GENMIDI_FLAG_FIXED)
+    {
+        note = instr->fixed_note;
+    }
+
+    patch = &instr->voices[0];
+    voice = AllocateVoice();
+
+    voice->channel = channel;
+    voice->key = key;
+    voice->note = note;
+    voice->base_note_offset = SHORT(patch->base_note_offset);
+    voice->volume = velocity * channels[channel].volume;
+    voice->age = voice_age++;
+
+    voice->feedback = (patch->feedback >> 1) & 0x07;
+    voice->additive = (patch->feedback & 0x01) != 0;
+    voice->fb1 = voice->fb2 = 0;
+
+    SetupOperator(&voice->mod, &patch->modulator, patch->modulator.level);
+    SetupOperator(&voice->car, &patch->carrier, patch->carrier.level);
+
+    SetVoiceFrequency(voice);
+}
+
+static void KeyOff(int channel, int key)
+{
+    int i;
+
+    for (i = 0; i < OPL_NUM_VOICES; ++i)
+    {
+        if (voices[i].channel == channel && voices[i].key == key)
+        {
+            voices[i].key = -1;
+
+            if (voices[i].mod.state != ENV_OFF)
+            {
+                voices[i].mod.state = ENV_RELEASE;
+            }
+
+            if (voices[i].car.state != ENV_OFF)
+            {
+                voices[i].car.state = ENV_RELEASE;
+            }
+        }
+    }
+}
+
+static void ReleaseChannel(int channel)
+{
+    int i;
+
+    for (i = 0; i < OPL_NUM_VOICES; ++i)
+    {
+        if (voices[i].channel == channel && voices[i].key >= 0)
+        {
+            KeyOff(channel, voices[i].key);
+        }
+    }
+}
+
+static void SilenceVoices(void)
+{
+    int i;
+
+    for (i = 0; i < OPL_NUM_VOICES; ++i)
+    {
+        voices[i].key = -1;
+        voices[i].channel = -1;
+        voices[i].mod.state = ENV_OFF;
+        voices[i].car.state = ENV_OFF;
+    }
+}
+
+//
+// Render n samples of all voices, added to both sides of buf.
+//
+
+static void RenderVoices(int32_t *buf, unsigned int n)
+{
+    opl_voice_t *voice;
+    int32_t *out;
+    unsigned int i;
+    int mod, car;
+    int volume, gain;
+
+    for (voice = voices; voice < voices + OPL_NUM_VOICES; ++voice)
+    {
+        if (voice->car.state == ENV_OFF)
+        {
+            continue;
+        }
+
+        AdvanceEnvelope(&voice->mod, n);
+        AdvanceEnvelope(&voice->car, n);
+
+        // Voice and music volume, and the carrier gain for
+        // this block.  Operator outputs are 1.15 fixed point,
+        // scaled down so that all voices together stay close
+        // to full scale.
+
+        volume = (voice->volume * music_volume) >> 7;
+        gain = (voice->car.gain * volume) >> 15;
+
+        if (gain == 0 && !voice->additive && voice->car.state != ENV_ATTACK)
+        {
+            continue;
+        }
+
+        out = buf;
+
+        for (i = 0; i < n; ++i)
+        {
+            // Modulator, with self feedback
+
+            mod = voice->mod.phase >> 19;
+
+            if (voice->feedback)
+            {
+                mod += (voice->fb1 + voice->fb2) >> (9 - voice->feedback);
+            }
+
+            mod = ((OperatorWave(voice->mod.waveform, mod) >> 1)
+                   * voice->mod.gain) >> 15;
+
+            voice->fb2 = voice->fb1;
+            voice->fb1 = mod;
+
+            // Carrier, phase modulated unless additive
+
+            if (voice->additive)
+            {
+                car = ((OperatorWave(voice->car.waveform,
+                                     voice->car.phase >> 19) >> 1) * gain
+                       + mod * volume) >> 17;
+            }
+            else
+            {
+                car = ((OperatorWave(voice->car.waveform,
+                                     (voice->car.phase >> 19) + mod) >> 1)
+                       * gain) >> 17;
+            }
+
+            *out++ += car;
+            *out++ += car;
+
+            voice->mod.phase += voice->mod.inc;
+            voice->car.phase += voice->car.inc;
+        }
+    }
+}
+
+//
+// MUS score
+//
+
+static void ResetChannels(void)
+{
+    int i;
+
+    for (i = 0; i < MUS_NUM_CHANNELS; ++i)
+    {
+        channels[i].instrument = 0;
+        channels[i].volume = 127;
+        channels[i].last_velocity = 127;
+        channels[i].bend = 0;
+    }
+}
+
+static int ReadScoreByte(void)
+{
+    if (score_pos >= playing_song->scorelen)
+    {
+        return -1;
+    }
+
+    return playing_song->score[score_pos++];
+}
+
+static void SetChannelBend(int channel, int value)
+{
+    int i;
+
+    // 128 is centered, the range is two semitones up and down.
+
+    channels[channel].bend = (value - 128) / 2;
+
+    for (i = 0; i < OPL_NUM_VOICES; ++i)
+    {
+        if (voices[i].channel == channel && voices[i].car.state != ENV_OFF)
+        {
+            SetVoiceFrequency(&voices[i]);
+        }
+    }
+}
+
+static void ControllerEvent(int channel, int controller, int value)
+{
+    switch (controller)
+    {
+        case 0:
+            channels[channel].instrument = value & 0x7f;
+            break;
+
+        case 3:
+            channels[channel].volume = value & 0x7f;
+            break;
+
+        case 10:    // All sounds off
+        case 11:    // All notes off
+            ReleaseChannel(channel);
+            break;
+
+        case 14:    // Reset all controllers
+            channels[channel].volume = 127;
+            SetChannelBend(channel, 128);
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Play one group of events, returns the delay in
+// ticks to the next group, or -1 at the end of the score.
+
+static int PlayEventGroup(void)
+{
+    int event, channel, data, value;
+    unsigned int delay;
+
+    do
+    {
+        event = ReadScoreByte();
+
+        if (event < 0)
+        {
+            return -1;
+        }
+
+        channel = event & 0x0f;
+
+        switch ((event >> 4) & 0x07)
+        {
+            case 0:     // Release note
+                KeyOff(channel, ReadScoreByte() & 0x7f);
+                break;
+
+            case 1:     // Play note
+                data = ReadScoreByte();
+
+                if (data & 0x80)
+                {
+                    channels[channel].last_velocity = ReadScoreByte() & 0x7f;
+                }
+
+                KeyOn(channel, data & 0x7f, channels[channel].last_velocity);
+                break;
+
+            case 2:     // Pitch wheel
+                SetChannelBend(channel, ReadScoreByte() & 0xff);
+                break;
+
+            case 3:     // System event
+                ControllerEvent(channel, ReadScoreByte() & 0x7f, 0);
+                break;
+
+            case 4:     // Controller change
+                data = ReadScoreByte();
+                value = ReadScoreByte();
+                ControllerEvent(channel, data & 0x7f, value);
+                break;
+
+            case 5:     // End of measure
+                break;
+
+            case 6:     // Score end
+                return -1;
+
+            default:
+                ReadScoreByte();
+                break;
+        }
+    } while (!(event & 0x80));
+
+    // Variable length delay, seven bits per byte.
+
+    delay = 0;
+
+    do
+    {
+        data = ReadScoreByte();
+
+        if (data < 0)
+        {
+            return -1;
+        }
+
+        delay = (delay << 7) | (data & 0x7f);
+    } while (data & 0x80);
+
+    return delay;
+}
+
+//
+// Mixer hook: play events and render voices for nframes
+// of stereo output.
+//
+
+static void I_OPL_RenderMusic(int32_t *buf, unsigned int nframes)
+{
+    unsigned int n;
+    int delay;
+
+    while (nframes > 0 && playing_song != NULL && !music_paused)
+    {
+        while (next_event < (1 << 16) && playing_song != NULL)
+        {
+            delay = PlayEventGroup();
+
+            if (delay < 0)
+            {
+                if (!song_looping)
+                {
+                    playing_song = NULL;
+                    break;
+                }
+
+                // Restart, at least a tick later so an empty
+                // score can't spin here.
+
+                score_pos = 0;
+                ResetChannels();
+                delay = 1;
+            }
+
+            next_event += (uint64_t) delay * tick_samples;
+        }
+
+        n = (unsigned int) (next_event >> 16);
+
+        if (n > nframes)
+        {
+            n = nframes;
+        }
+
+        if (n > OPL_BLOCK)
+        {
+            n = OPL_BLOCK;
+        }
+
+        RenderVoices(buf, n);
+
+        buf += n * 2;
+        nframes -= n;
+        next_event -= n << 16;
+    }
+
+    // Let released notes ring out after the song ends.
+
+    while (nframes > 0 && !music_paused)
+    {
+        n = nframes > OPL_BLOCK ? OPL_BLOCK : nframes;
+
+        RenderVoices(buf, n);
+
+        buf += n * 2;
+        nframes -= n;
+    }
+}
+
+//
+// Music module
+//
+
+static void I_OPL_SetMusicVolume(int volume)
+{
+    music_volume = volume;
+}
+
+static void I_OPL_PauseSong(void)
+{
+    music_paused = true;
+}
+
+static void I_OPL_ResumeSong(void)
+{
+    music_paused = false;
+}
+
+static void *I_OPL_RegisterSong(void *data, int len)
+{
+    const musheader_t *header = data;
+    mus_song_t *song;
+    unsigned int start, scorelen;
+
+    if (len < (int) sizeof(musheader_t) || memcmp(header->id, "MUS\x1a", 4))
+    {
+        return NULL;
+    }
+
+    start = SHORT(header->scorestart);
+    scorelen = SHORT(header->scorelen) & 0xffff;
+
+    if (start > (unsigned int) len)
+    {
+        return NULL;
+    }
+
+    if (scorelen > len - start)
+    {
+        scorelen = len - start;
+    }
+
+    // The lump stays locked by s_sound.c while the
+    // song is registered.
+
+    song = Z_Malloc(sizeof(mus_song_t), PU_STATIC, NULL);
+    song->score = (const byte *) data + start;
+    song->scorelen = scorelen;
+
+    return song;
+}
+
+static void I_OPL_StopSong(void)
+{
+    playing_song = NULL;
+    SilenceVoices();
+}
+
+static void I_OPL_UnRegisterSong(void *handle)
+{
+    if (handle == NULL)
+    {
+        return;
+    }
+
+    if (handle == playing_song)
+    {
+        I_OPL_StopSong();
+    }
+
+    Z_Free(handle);
+}
+
+static void I_OPL_PlaySong(void *handle, boolean looping)
+{
+    I_OPL_StopSong();
+
+    if (handle == NULL)
+    {
+        return;
+    }
+
+    ResetChannels();
+
+    score_pos = 0;
+    next_event = 0;
+    song_looping = looping;
+    playing_song = handle;
+}
+
+static boolean I_OPL_MusicIsPlaying(void)
+{
+    return playing_song != NULL;
+}
+
+//
+// Render some seconds of a song as fast as possible
+// and report the CPU time it took.
+//
+
+static void BenchmarkMusic(void)
+{
+    static int32_t buf[OPL_BLOCK * 2];
+    uint64_t start, ns;
+    uint32_t percent, hundredths;
+    unsigned int i, n;
+    void *song;
+    int seconds;
+    int lump;
+    int p;
+
+    //!
+    // @arg <seconds>
+    //
+    // Measure the time needed to synthesize music, using the
+    // music of the first level.
+    //
+
+    p = M_CheckParmWithArgs("-musicbench", 1);
+
+    if (p == 0)
+    {
+        return;
+    }
+
+    seconds = atoi(myargv[p + 1]);
+
+    if (seconds <= 0)
+    {
+        return;
+    }
+
+    lump = W_CheckNumForName("D_E1M1");
+
+    if (lump < 0)
+    {
+        lump = W_CheckNumForName("D_RUNNIN");
+    }
+
+    if (lump < 0)
+    {
+        return;
+    }
+
+    song = I_OPL_RegisterSong(W_CacheLumpNum(lump, PU_STATIC),
+                              W_LumpLength(lump));
+    I_OPL_PlaySong(song, true);
+
+    n = (seconds * snd_samplerate) / OPL_BLOCK;
+    start = get_time_ns();
+
+    for (i = 0; i < n; ++i)
+    {
+        I_OPL_RenderMusic(buf, OPL_BLOCK);
+    }
+
+    ns = div_u64(get_time_ns() - start, seconds);
+
+    I_OPL_UnRegisterSong(song);
+    W_ReleaseLumpNum(lump);
+
+    percent = div_u64_rem(div_u64(ns, 100000), 100, &hundredths);
+
+    printf("I_OPL: %u us per second of music, %u.%02u%% of the CPU\n",
+           (unsigned int) div_u64(ns, 1000), percent, hundredths);
+}
+
+static boolean I_OPL_InitMusic(void)
+{
+    const byte *lump;
+    int lumpnum;
+
+    lumpnum = W_CheckNumForName("GENMIDI");
+
+    if (lumpnum < 0
+     || W_LumpLength(lumpnum) < 8 + (GENMIDI_NUM_INSTRS
+                                      + GENMIDI_NUM_PERCUSSION)
+                                    * sizeof(genmidi_instr_t))
+    {
+        return false;
+    }
+
+    lump = W_CacheLumpNum(lumpnum, PU_STATIC);
+
+    if (memcmp(lump, GENMIDI_HEADER, strlen(GENMIDI_HEADER)))
+    {
+        W_ReleaseLumpNum(lumpnum);
+        return false;
+    }
+
+    main_instrs = (const genmidi_instr_t *) (lump + strlen(GENMIDI_HEADER));
+    percussion_instrs = main_instrs + GENMIDI_NUM_INSTRS;
+    genmidi_lump = lumpnum;
+
+    tick_samples = div_u64((uint64_t) snd_samplerate << 16, MUS_TICRATE);
+
+    SilenceVoices();
+    ResetChannels();
+
+    // Music is mixed into the digital sound output.
+
+    if (!I_PCM_HookMusic(I_OPL_RenderMusic))
+    {
+        W_ReleaseLumpNum(lumpnum);
+        return false;
+    }
+
+    BenchmarkMusic();
+
+    return true;
+}
+
+static void I_OPL_ShutdownMusic(void)
+{
+    I_OPL_StopSong();
+    I_PCM_HookMusic(NULL);
+    W_ReleaseLumpNum(genmidi_lump);
+}
+
+static snddevice_t music_opl_devices[] =
+{
+    SNDDEVICE_ADLIB,
+    SNDDEVICE_SB,
+};
+
+music_module_t music_opl_module =
+{
+    music_opl_devices,
+    arrlen(music_opl_devices),
+    I_OPL_InitMusic,
+    I_OPL_ShutdownMusic,
+    I_OPL_SetMusicVolume,
+    I_OPL_PauseSong,
+    I_OPL_ResumeSong,
+    I_OPL_RegisterSong,
+    I_OPL_UnRegisterSong,
+    I_OPL_PlaySong,
+    I_OPL_StopSong,
+    I_OPL_MusicIsPlaying,
+    NULL,
+};
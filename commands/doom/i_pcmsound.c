@@ -0,0 +1,398 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	System interface for digital sound, mixed in software
+//	and streamed to a barebox PCM sound card.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <sound.h>
+
+#include "doomtype.h"
+
+#include "deh_str.h"
+#include "i_sound.h"
+#include "m_misc.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#define NUM_CHANNELS		16
+
+// Fractional bits of the sample position, leaves room
+// for sounds of up to 1M samples.
+
+#define MIX_FRACBITS		12
+
+// Frames mixed at once, bounds the mixing done per call.
+
+#define MIX_MAXFRAMES		1024
+
+typedef struct
+{
+    // Lump locked while the channel is playing, -1 if idle.
+    int lumpnum;
+
+    const byte *samples;
+    unsigned int length;
+
+    // Position and step through samples, MIX_FRACBITS fixed point.
+    unsigned int pos;
+    unsigned int step;
+
+    // Volume 0-254 for each side.
+    int left;
+    int right;
+} pcm_channel_t;
+
+extern int snd_samplerate;
+extern int snd_maxslicetime_ms;
+
+static boolean use_sfx_prefix;
+static struct sound_card *card;
+static pcm_channel_t channels[NUM_CHANNELS];
+
+// Music synthesizer mixed into the output, if any.
+
+static void (*music_render)(int32_t *buf, unsigned int nframes);
+
+static int32_t mixbuf[MIX_MAXFRAMES * 2];
+static int16_t outbuf[MIX_MAXFRAMES * 2];
+
+// W_ReleaseLumpNum only turns the lump back into PU_CACHE, it
+// doesn't count. Release a lump only when no other channel is
+// still playing it.
+
+static void ReleaseLump(int lumpnum)
+{
+    int i;
+
+    for (i = 0; i < NUM_CHANNELS; ++i)
+    {
+        if (channels[i].lumpnum == lumpnum)
+        {
+            return;
+        }
+    }
+
+    W_ReleaseLumpNum(lumpnum);
+}
+
+static void ReleaseChannel(pcm_channel_t *ch)
+{
+    int lumpnum = ch->lumpnum;
+
+    if (lumpnum >= 0)
+    {
+        ch->lumpnum = -1;
+        ReleaseLump(lumpnum);
+    }
+}
+
+static void GetSfxLumpName(sfxinfo_t *sfx, char *buf, size_t buf_len)
+{
+    // Linked sfx lumps? Get the lump number for the sound linked to.
+
+    if (sfx->link != NULL)
+    {
+        sfx = sfx->link;
+    }
+
+    // Doom adds a DS* prefix to sound lumps; Heretic and Hexen don't
+    // do this.
+
+    if (use_sfx_prefix)
+    {
+        M_snprintf(buf, buf_len, "ds%s", DEH_String(sfx->name));
+    }
+    else
+    {
+        M_StringCopy(buf, DEH_String(sfx->name), buf_len);
+    }
+}
+
+static int I_PCM_GetSfxLumpNum(sfxinfo_t *sfx)
+{
+    char namebuf[9];
+
+    GetSfxLumpName(sfx, namebuf, sizeof(namebuf));
+
+    return W_GetNumForName(namebuf);
+}
+
+static void I_PCM_UpdateSoundParams(int handle, int vol, int sep)
+{
+    if (handle < 0 || handle >= NUM_CHANNELS)
+    {
+        return;
+    }
+
+    channels[handle].left = ((254 - sep) * vol) / 127;
+    channels[handle].right = (sep * vol) / 127;
+}
+
+static int I_PCM_StartSound(sfxinfo_t *sfxinfo, int channel, int vol, int sep)
+{
+    pcm_channel_t *ch;
+    const byte *data;
+    unsigned int lumplen;
+    unsigned int samplerate;
+    unsigned int length;
+
+    if (channel < 0 || channel >= NUM_CHANNELS)
+    {
+        return -1;
+    }
+
+    ch = &channels[channel];
+    ReleaseChannel(ch);
+
+    // The lump stays locked, not copied, while any channel
+    // plays it.
+
+    data = W_CacheLumpNum(sfxinfo->lumpnum, PU_STATIC);
+    lumplen = W_LumpLength(sfxinfo->lumpnum);
+
+    // Check the header, and ensure this is a valid sound
+
+    if (lumplen < 8 || data[0] != 0x03 || data[1] != 0x00)
+    {
+        ReleaseLump(sfxinfo->lumpnum);
+        return -1;
+    }
+
+    samplerate = (data[3] << 8) | data[2];
+    length = (data[7] << 24) | (data[6] << 16) | (data[5] << 8) | data[4];
+
+    // If the header specifies that the length of the sound is greater
+    // than the length of the lump itself, this is an invalid sound lump.
+
+    // We also discard sound lumps that are less than 49 samples long,
+    // as this is how DMX behaves - although the actual cut-off length
+    // seems to vary slightly depending on the sample rate.  This needs
+    // further investigation to better understand the correct
+    // behavior.
+
+    if (length > lumplen - 8 || length <= 48
+     || length >= (1U << (32 - MIX_FRACBITS)) || samplerate == 0)
+    {
+        ReleaseLump(sfxinfo->lumpnum);
+        return -1;
+    }
+
+    // The DMX sound library seems to skip the first 16 and last 16
+    // bytes of the lump - reason unknown.
+
+    ch->lumpnum = sfxinfo->lumpnum;
+    ch->samples = data + 8 + 16;
+    ch->length = (length - 32) << MIX_FRACBITS;
+    ch->pos = 0;
+    ch->step = (samplerate << MIX_FRACBITS) / snd_samplerate;
+
+    I_PCM_UpdateSoundParams(channel, vol, sep);
+
+    return channel;
+}
+
+static void I_PCM_StopSound(int handle)
+{
+    if (handle < 0 || handle >= NUM_CHANNELS)
+    {
+        return;
+    }
+
+    ReleaseChannel(&channels[handle]);
+}
+
+static boolean I_PCM_SoundIsPlaying(int handle)
+{
+    if (handle < 0 || handle >= NUM_CHANNELS)
+    {
+        return false;
+    }
+
+    return channels[handle].lumpnum >= 0;
+}
+
+//
+// Mix nframes of all playing channels into outbuf.
+//
+
+static void MixChannels(unsigned int nframes)
+{
+    pcm_channel_t *ch;
+    int32_t *out;
+    int32_t sample;
+    unsigned int i, n;
+
+    memset(mixbuf, 0, nframes * 2 * sizeof(*mixbuf));
+
+    for (ch = channels; ch < channels + NUM_CHANNELS; ++ch)
+    {
+        if (ch->lumpnum < 0)
+        {
+            continue;
+        }
+
+        out = mixbuf;
+
+        for (n = 0; n < nframes && ch->pos < ch->length; ++n)
+        {
+            sample = ch->samples[ch->pos >> MIX_FRACBITS] - 128;
+
+            *out++ += sample * ch->left;
+            *out++ += sample * ch->right;
+
+            ch->pos += ch->step;
+        }
+
+        if (ch->pos >= ch->length)
+        {
+            ReleaseChannel(ch);
+        }
+    }
+
+    if (music_render != NULL)
+    {
+        music_render(mixbuf, nframes);
+    }
+
+    for (i = 0; i < nframes * 2; ++i)
+    {
+        sample = mixbuf[i];
+
+        if (sample > 32767)
+        {
+            sample = 32767;
+        }
+        else if (sample < -32768)
+        {
+            sample = -32768;
+        }
+
+        outbuf[i] = sample;
+    }
+}
+
+//
+// Called once per tic: top up the sound card's ring with
+// as many frames as it has room for.
+//
+
+static void I_PCM_UpdateSound(void)
+{
+    unsigned int nframes;
+
+    for (;;)
+    {
+        nframes = sound_card_pcm_space(card);
+
+        if (nframes == 0)
+        {
+            break;
+        }
+
+        if (nframes > MIX_MAXFRAMES)
+        {
+            nframes = MIX_MAXFRAMES;
+        }
+
+        MixChannels(nframes);
+        sound_card_pcm_write(card, outbuf, nframes);
+    }
+}
+
+static void I_PCM_ShutdownSound(void)
+{
+    int i;
+
+    for (i = 0; i < NUM_CHANNELS; ++i)
+    {
+        ReleaseChannel(&channels[i]);
+    }
+
+    sound_card_pcm_close(card);
+    card = NULL;
+    music_render = NULL;
+}
+
+static boolean I_PCM_InitSound(boolean _use_sfx_prefix)
+{
+    int i;
+
+    use_sfx_prefix = _use_sfx_prefix;
+
+    for (i = 0; i < NUM_CHANNELS; ++i)
+    {
+        channels[i].lumpnum = -1;
+    }
+
+    card = sound_card_get_default();
+
+    // Buffer two slices, so one is always queued while the
+    // next is mixed.
+
+    if (sound_card_pcm_open(card, snd_samplerate, SOUND_PCM_S16_STEREO,
+                            snd_maxslicetime_ms * 2 * 1000) < 0)
+    {
+        card = NULL;
+        return false;
+    }
+
+    printf("I_PCM_InitSound: %s at %i Hz\n", card->name, snd_samplerate);
+
+    return true;
+}
+
+//
+// Install a function that adds music to each mixed block,
+// fails if digital sound output is not active.
+//
+
+boolean I_PCM_HookMusic(void (*render)(int32_t *buf, unsigned int nframes))
+{
+    if (card == NULL && render != NULL)
+    {
+        return false;
+    }
+
+    music_render = render;
+
+    return true;
+}
+
+static snddevice_t sound_pcm_devices[] =
+{
+    SNDDEVICE_SB,
+    SNDDEVICE_PAS,
+    SNDDEVICE_GUS,
+    SNDDEVICE_WAVEBLASTER,
+    SNDDEVICE_SOUNDCANVAS,
+    SNDDEVICE_AWE32,
+};
+
+sound_module_t sound_pcm_module =
+{
+    sound_pcm_devices,
+    arrlen(sound_pcm_devices),
+    I_PCM_InitSound,
+    I_PCM_ShutdownSound,
+    I_PCM_GetSfxLumpNum,
+    I_PCM_UpdateSound,
+    I_PCM_UpdateSoundParams,
+    I_PCM_StartSound,
+    I_PCM_StopSound,
+    I_PCM_SoundIsPlaying,
+};
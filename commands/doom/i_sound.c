@@ -50,14 +50,17 @@ static sound_module_t *sound_module;
 static music_module_t *music_module;
 
 int snd_musicdevice = SNDDEVICE_SB;
-int snd_sfxdevice = SNDDEVICE_PCSPEAKER;
+int snd_sfxdevice = SNDDEVICE_SB;
 
 // Sound modules
 
+extern sound_module_t sound_pcm_module;
 extern sound_module_t sound_pcsound_module;
 
 // For OPL module:
 
+extern music_module_t music_opl_module;
+
 // For native music module:
 
 extern char *timidity_cfg_path;
@@ -67,6 +70,7 @@ extern char *timidity_cfg_path;
 static sound_module_t *sound_modules[] = 
 {
 #ifdef FEATURE_SOUND
+    &sound_pcm_module,
     &sound_pcsound_module,
 #endif
     NULL,
@@ -76,8 +80,7 @@ static sound_module_t *sound_modules[] =
 
 static music_module_t *music_modules[] =
 {
-#if 0
-    &music_sdl_module,
+#ifdef FEATURE_SOUND
     &music_opl_module,
 #endif
     NULL,
@@ -101,10 +104,10 @@ static boolean SndDeviceInList(snddevice_t device, snddevice_t *list,
     return false;
 }
 
-// Find and initialize a sound_module_t appropriate for the setting
-// in snd_sfxdevice.
+// Find and initialize a sound_module_t appropriate for the given
+// sound device.
 
-static void InitSfxModule(boolean use_sfx_prefix)
+static void InitSfxModuleForDevice(snddevice_t device, boolean use_sfx_prefix)
 {
     int i;
 
@@ -115,7 +118,7 @@ static void InitSfxModule(boolean use_sfx_prefix)
         // Is the sfx device in the list of devices supported by
         // this module?
 
-        if (SndDeviceInList(snd_sfxdevice, 
+        if (SndDeviceInList(device, 
                             sound_modules[i]->sound_devices,
                             sound_modules[i]->num_sound_devices))
         {
@@ -130,6 +133,20 @@ static void InitSfxModule(boolean use_sfx_prefix)
     }
 }
 
+// Initialize the sound_module_t for the setting in snd_sfxdevice.
+
+static void InitSfxModule(boolean use_sfx_prefix)
+{
+    InitSfxModuleForDevice(snd_sfxdevice, use_sfx_prefix);
+
+    // Sound cards without PCM support can still beep.
+
+    if (sound_module == NULL && snd_sfxdevice != SNDDEVICE_NONE)
+    {
+        InitSfxModuleForDevice(SNDDEVICE_PCSPEAKER, use_sfx_prefix);
+    }
+}
+
 // Initialize music according to snd_musicdevice.
 
 static void InitMusicModule(void)
@@ -214,6 +214,10 @@ typedef struct
     void (*Poll)(void);
 } music_module_t;
 
+// Mix music into the digital sound output.
+
+boolean I_PCM_HookMusic(void (*render)(int32_t *buf, unsigned int nframes));
+
 void I_InitMusic(void);
 void I_ShutdownMusic(void);
 void I_SetMusicVolume(int volume);
@@ -65,6 +65,11 @@ int I_GetTimeMS(void)
     return ticks - basetime;
 }
 
+unsigned int I_GetTimeUS(void)
+{
+    return DG_GetTicksUs();
+}
+
 // Sleep for a specified number of ms
 
 void I_Sleep(int ms)
@@ -176,5 +176,6 @@ struct FB_ScreenInfo
 };
 
 extern struct FB_ScreenInfo s_Fb;
+extern int fb_scaling;
 
 #endif
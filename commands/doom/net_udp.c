@@ -0,0 +1,683 @@
+//
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Peer to peer network games over the barebox UDP stack.
+//
+//     Like Vanilla's -net, every node sends its ticcmds to all
+//     other nodes and runs a tic once it has everybody's command
+//     for it, there is no server. Each packet carries all tics the
+//     receiver hasn't acknowledged yet, so a lost packet is made up
+//     for by the next one, and acknowledges the tics received from
+//     it in turn.
+//
+//     Tics are written straight into the connection's packet
+//     buffer, and parsed out of the receive buffer in the UDP
+//     handler, which runs whenever the network is polled.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <common.h>
+#include <clock.h>
+#include <malloc.h>
+#include <net.h>
+#include <linux/err.h>
+
+#include "doomdef.h"
+#include "d_loop.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_misc.h"
+#include "net_client.h"
+#include "net_udp.h"
+
+// Vanilla's IPX port number, as good as any.
+
+#define NET_UDP_DEFAULT_PORT    5029
+
+#define NET_UDP_MAGIC           0x44554450      // "DUDP"
+
+// Most tics sent in one packet.
+
+#define NET_UDP_MAXTICS         16
+
+// Send again if a peer wasn't sent anything for this long.
+
+#define NET_UDP_RESEND          (50 * MSECOND)
+
+#define NET_UDP_TICCMD_SIZE     8
+
+typedef enum
+{
+    // Game settings, from player 1 to everybody else
+    NET_UDP_START,
+
+    // Game settings received
+    NET_UDP_START_ACK,
+
+    // Ticcmds, ack: next tic wanted from the receiver
+    NET_UDP_GAMEDATA,
+
+    NET_UDP_QUIT,
+} net_udp_type_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint8_t type;
+    uint8_t player;
+    uint8_t num_players;
+    uint8_t count;
+    uint32_t ack;
+    uint32_t tic;
+} PACKEDATTR net_udp_header_t;
+
+// Game settings, as sent in a START packet.
+
+typedef struct
+{
+    sha1_digest_t wad_sha1sum;
+    uint8_t episode;
+    uint8_t map;
+    uint8_t skill;
+    uint8_t deathmatch;
+    uint8_t nomonsters;
+    uint8_t fast_monsters;
+    uint8_t respawn_monsters;
+    uint8_t lowres_turn;
+    int8_t loadgame;
+    uint8_t gameversion;
+    uint16_t timelimit;
+} PACKEDATTR net_udp_settings_t;
+
+typedef struct
+{
+    struct net_connection *con;
+    IPaddr_t ip;
+
+    // Has the game settings, player 1 only.
+    boolean ready;
+
+    // Sent a QUIT packet.
+    boolean quit;
+
+    // Next tic we need from this peer, and next tic
+    // it needs from us.
+    int recvtic;
+    int acktic;
+
+    uint64_t lastsend;
+
+    ticcmd_t cmds[BACKUPTICS];
+} net_udp_peer_t;
+
+static net_udp_peer_t *peers[NET_MAXPLAYERS];
+static int num_players;
+static int consoleplayer;
+
+// Our own ticcmds, kept for resending.
+
+static ticcmd_t localcmds[BACKUPTICS];
+static int localtic;
+
+// Next complete tic to hand to the loop code.
+
+static int completetic;
+
+static boolean started;
+static net_gamesettings_t start_settings;
+static sha1_digest_t local_wad_sha1sum;
+
+static void NET_UDP_WriteTiccmd(byte *p, ticcmd_t *cmd)
+{
+    p[0] = cmd->forwardmove;
+    p[1] = cmd->sidemove;
+    p[2] = cmd->angleturn >> 8;
+    p[3] = cmd->angleturn & 0xff;
+    p[4] = cmd->chatchar;
+    p[5] = cmd->buttons;
+    p[6] = cmd->consistancy;
+    p[7] = 0;
+}
+
+static void NET_UDP_ReadTiccmd(ticcmd_t *cmd, const byte *p)
+{
+    memset(cmd, 0, sizeof(*cmd));
+
+    cmd->forwardmove = (signed char) p[0];
+    cmd->sidemove = (signed char) p[1];
+    cmd->angleturn = (short) ((p[2] << 8) | p[3]);
+    cmd->chatchar = p[4];
+    cmd->buttons = p[5];
+    cmd->consistancy = p[6];
+}
+
+static net_udp_header_t *NET_UDP_Header(net_udp_peer_t *peer, int type)
+{
+    net_udp_header_t *hdr = net_udp_get_payload(peer->con);
+
+    hdr->magic = htonl(NET_UDP_MAGIC);
+    hdr->type = type;
+    hdr->player = consoleplayer;
+    hdr->num_players = num_players;
+    hdr->count = 0;
+    hdr->ack = htonl(peer->recvtic);
+    hdr->tic = 0;
+
+    return hdr;
+}
+
+static void NET_UDP_Send(net_udp_peer_t *peer, int len)
+{
+    net_udp_send(peer->con, sizeof(net_udp_header_t) + len);
+    peer->lastsend = get_time_ns();
+}
+
+//
+// Send all tics the peer hasn't acknowledged yet.
+//
+
+static void NET_UDP_SendTics(net_udp_peer_t *peer)
+{
+    net_udp_header_t *hdr;
+    byte *p;
+    int count, i;
+
+    hdr = NET_UDP_Header(peer, NET_UDP_GAMEDATA);
+
+    count = localtic - peer->acktic;
+
+    if (count > NET_UDP_MAXTICS)
+    {
+        count = NET_UDP_MAXTICS;
+    }
+
+    hdr->tic = htonl(peer->acktic);
+    hdr->count = count;
+
+    p = (byte *) (hdr + 1);
+
+    for (i = 0; i < count; ++i)
+    {
+        NET_UDP_WriteTiccmd(p, &localcmds[(peer->acktic + i) % BACKUPTICS]);
+        p += NET_UDP_TICCMD_SIZE;
+    }
+
+    NET_UDP_Send(peer, count * NET_UDP_TICCMD_SIZE);
+}
+
+static void NET_UDP_SendStart(net_udp_peer_t *peer)
+{
+    net_udp_settings_t *s;
+
+    s = (net_udp_settings_t *) (NET_UDP_Header(peer, NET_UDP_START) + 1);
+
+    memcpy(s->wad_sha1sum, local_wad_sha1sum, sizeof(sha1_digest_t));
+    s->episode = start_settings.episode;
+    s->map = start_settings.map;
+    s->skill = start_settings.skill;
+    s->deathmatch = start_settings.deathmatch;
+    s->nomonsters = start_settings.nomonsters;
+    s->fast_monsters = start_settings.fast_monsters;
+    s->respawn_monsters = start_settings.respawn_monsters;
+    s->lowres_turn = start_settings.lowres_turn;
+    s->loadgame = start_settings.loadgame;
+    s->gameversion = start_settings.gameversion;
+    s->timelimit = htons(start_settings.timelimit);
+
+    NET_UDP_Send(peer, sizeof(*s));
+}
+
+static void NET_UDP_ReceiveStart(net_udp_peer_t *peer, const byte *data,
+                                 unsigned int len)
+{
+    const net_udp_settings_t *s = (const net_udp_settings_t *) data;
+
+    if (len < sizeof(*s))
+    {
+        return;
+    }
+
+    if (!started)
+    {
+        if (memcmp(s->wad_sha1sum, local_wad_sha1sum,
+                   sizeof(sha1_digest_t)) != 0)
+        {
+            printf("NET_UDP: WARNING: player 1 has different WADs loaded, "
+                   "the game will probably go out of sync\n");
+        }
+
+        start_settings.episode = s->episode;
+        start_settings.map = s->map;
+        start_settings.skill = s->skill;
+        start_settings.deathmatch = s->deathmatch;
+        start_settings.nomonsters = s->nomonsters;
+        start_settings.fast_monsters = s->fast_monsters;
+        start_settings.respawn_monsters = s->respawn_monsters;
+        start_settings.lowres_turn = s->lowres_turn;
+        start_settings.loadgame = s->loadgame;
+        start_settings.gameversion = s->gameversion;
+        start_settings.timelimit = ntohs(s->timelimit);
+
+        started = true;
+    }
+
+    // Answer every START, the last answer may have been lost.
+
+    NET_UDP_Header(peer, NET_UDP_START_ACK);
+    NET_UDP_Send(peer, 0);
+}
+
+static void NET_UDP_ReceiveTics(net_udp_peer_t *peer, net_udp_header_t *hdr,
+                                const byte *data, unsigned int len)
+{
+    int tic, ack, i;
+
+    ack = ntohl(hdr->ack);
+
+    if (ack > peer->acktic && ack <= localtic)
+    {
+        peer->acktic = ack;
+    }
+
+    if (len < hdr->count * NET_UDP_TICCMD_SIZE)
+    {
+        return;
+    }
+
+    tic = ntohl(hdr->tic);
+
+    for (i = 0; i < hdr->count; ++i, ++tic)
+    {
+        // The packet starts at our last ack, but it may be
+        // older than one already received.
+
+        if (tic < peer->recvtic)
+        {
+            continue;
+        }
+
+        if (tic > peer->recvtic)
+        {
+            break;
+        }
+
+        NET_UDP_ReadTiccmd(&peer->cmds[tic % BACKUPTICS],
+                           data + i * NET_UDP_TICCMD_SIZE);
+        ++peer->recvtic;
+    }
+}
+
+static void NET_UDP_Handler(void *ctx, char *pkt, unsigned int len)
+{
+    net_udp_header_t *hdr;
+    net_udp_peer_t *peer;
+    struct iphdr *ip;
+    unsigned int datalen;
+
+    ip = net_eth_to_iphdr(pkt);
+    hdr = (net_udp_header_t *) net_eth_to_udp_payload(pkt);
+    datalen = net_eth_to_udplen(pkt);
+
+    if (datalen < sizeof(*hdr) || ntohl(hdr->magic) != NET_UDP_MAGIC
+     || hdr->player >= num_players || hdr->num_players != num_players)
+    {
+        return;
+    }
+
+    peer = peers[hdr->player];
+
+    if (peer == NULL || net_read_ip(&ip->saddr) != peer->ip)
+    {
+        return;
+    }
+
+    datalen -= sizeof(*hdr);
+
+    switch (hdr->type)
+    {
+        case NET_UDP_START:
+            if (hdr->player == 0)
+            {
+                NET_UDP_ReceiveStart(peer, (byte *) (hdr + 1), datalen);
+            }
+            break;
+
+        case NET_UDP_START_ACK:
+            peer->ready = true;
+            break;
+
+        case NET_UDP_GAMEDATA:
+            // Only sent once the game settings arrived.
+            peer->ready = true;
+            NET_UDP_ReceiveTics(peer, hdr, (byte *) (hdr + 1), datalen);
+            break;
+
+        case NET_UDP_QUIT:
+            if (!peer->quit)
+            {
+                printf("NET_UDP: player %i left the game\n", hdr->player + 1);
+            }
+            peer->quit = true;
+            break;
+    }
+}
+
+//
+// Hand all tics received from every player to the loop code.
+//
+
+static void NET_UDP_CompleteTics(void)
+{
+    ticcmd_t cmds[NET_MAXPLAYERS];
+    boolean ingame[NET_MAXPLAYERS];
+    net_udp_peer_t *peer;
+    int i;
+
+    for (;;)
+    {
+        memset(cmds, 0, sizeof(cmds));
+        memset(ingame, 0, sizeof(ingame));
+
+        for (i = 0; i < num_players; ++i)
+        {
+            peer = peers[i];
+
+            if (peer == NULL)
+            {
+                // Our own command is filled in by the loop code.
+                ingame[i] = true;
+                continue;
+            }
+
+            if (peer->recvtic > completetic)
+            {
+                cmds[i] = peer->cmds[completetic % BACKUPTICS];
+                ingame[i] = true;
+            }
+            else if (!peer->quit)
+            {
+                return;
+            }
+        }
+
+        D_ReceiveTic(cmds, ingame);
+        ++completetic;
+    }
+}
+
+boolean NET_UDP_Init(net_connect_data_t *data)
+{
+    net_udp_peer_t *peer;
+    uint16_t port;
+    IPaddr_t ip;
+    int i, p, player;
+
+    //!
+    // @arg <n> <address> [<address>...]
+    // @category net
+    //
+    // Play as player n in a network game with the peers at the
+    // given addresses, listed in order of their player numbers,
+    // as with Vanilla's -net. Every node must list the others.
+    //
+
+    i = M_CheckParmWithArgs("-net", 2);
+
+    if (i <= 0)
+    {
+        return false;
+    }
+
+    //!
+    // @arg <n>
+    // @category net
+    //
+    // Use the specified UDP port for -net, default 5029.
+    //
+
+    p = M_CheckParmWithArgs("-port", 1);
+    port = p > 0 ? atoi(myargv[p + 1]) : NET_UDP_DEFAULT_PORT;
+
+    consoleplayer = atoi(myargv[i + 1]) - 1;
+
+    for (p = i + 2, num_players = 1; p < myargc && myargv[p][0] != '-'; ++p)
+    {
+        ++num_players;
+    }
+
+    if (num_players > data->max_players || num_players > NET_MAXPLAYERS)
+    {
+        I_Error("NET_UDP: at most %i players are supported",
+                data->max_players);
+    }
+
+    if (consoleplayer < 0 || consoleplayer >= num_players)
+    {
+        I_Error("NET_UDP: player number must be 1-%i", num_players);
+    }
+
+    memcpy(local_wad_sha1sum, data->wad_sha1sum, sizeof(sha1_digest_t));
+
+    // Peers are listed in player order, with ourselves left out.
+
+    player = 0;
+
+    for (p = i + 2; p < i + 1 + num_players; ++p, ++player)
+    {
+        if (player == consoleplayer)
+        {
+            ++player;
+        }
+
+        if (resolv(myargv[p], &ip) != 0)
+        {
+            I_Error("NET_UDP: unable to resolve '%s'", myargv[p]);
+        }
+
+        peer = calloc(1, sizeof(*peer));
+
+        if (peer == NULL)
+        {
+            I_Error("NET_UDP: out of memory");
+        }
+
+        peer->ip = ip;
+        peer->con = net_udp_new(ip, port, NET_UDP_Handler, NULL);
+
+        if (IS_ERR(peer->con))
+        {
+            I_Error("NET_UDP: unable to reach %s: %s", myargv[p],
+                    strerror(-PTR_ERR(peer->con)));
+        }
+
+        // Only the first connection bound to the port sees
+        // packets, the handler tells peers apart.
+
+        net_udp_bind(peer->con, port);
+
+        peers[player] = peer;
+    }
+
+    net_client_connected = true;
+
+    printf("NET_UDP: player %i of %i, port %i\n",
+           consoleplayer + 1, num_players, port);
+
+    return true;
+}
+
+//
+// Agree on the game settings. Player 1's are used, it sends them
+// to everybody else until all have acknowledged.
+//
+
+void NET_UDP_StartGame(net_gamesettings_t *settings)
+{
+    net_udp_peer_t *peer;
+    boolean waiting;
+    uint64_t lastsend = 0;
+    int i;
+
+    start_settings = *settings;
+
+    if (consoleplayer == 0)
+    {
+        started = true;
+    }
+
+    printf("NET_UDP: waiting for the other players, ctrl-c to abort\n");
+
+    do
+    {
+        net_poll();
+
+        if (ctrlc())
+        {
+            I_Error("NET_UDP: aborted");
+        }
+
+        waiting = !started;
+
+        if (consoleplayer == 0)
+        {
+            for (i = 0; i < num_players; ++i)
+            {
+                peer = peers[i];
+
+                if (peer == NULL || peer->ready)
+                {
+                    continue;
+                }
+
+                waiting = true;
+
+                if (is_timeout(lastsend, 250 * MSECOND))
+                {
+                    NET_UDP_SendStart(peer);
+                }
+            }
+
+            if (is_timeout(lastsend, 250 * MSECOND))
+            {
+                lastsend = get_time_ns();
+            }
+        }
+    } while (waiting);
+
+    settings->episode = start_settings.episode;
+    settings->map = start_settings.map;
+    settings->skill = start_settings.skill;
+    settings->deathmatch = start_settings.deathmatch;
+    settings->nomonsters = start_settings.nomonsters;
+    settings->fast_monsters = start_settings.fast_monsters;
+    settings->respawn_monsters = start_settings.respawn_monsters;
+    settings->lowres_turn = start_settings.lowres_turn;
+    settings->loadgame = start_settings.loadgame;
+    settings->gameversion = start_settings.gameversion;
+    settings->timelimit = start_settings.timelimit;
+
+    settings->consoleplayer = consoleplayer;
+    settings->num_players = num_players;
+
+    // Without a server adjusting the clocks, sync like Vanilla.
+
+    settings->new_sync = 0;
+    settings->ticdup = 1;
+}
+
+void NET_UDP_SendTiccmd(ticcmd_t *cmd, int maketic)
+{
+    int i;
+
+    localcmds[maketic % BACKUPTICS] = *cmd;
+    localtic = maketic + 1;
+
+    for (i = 0; i < num_players; ++i)
+    {
+        if (peers[i] != NULL && !peers[i]->quit)
+        {
+            NET_UDP_SendTics(peers[i]);
+        }
+    }
+}
+
+//
+// Called from NetUpdate: poll the network directly instead of
+// waiting for the rate limited network poller, and keep resending
+// to peers that didn't acknowledge everything.
+//
+
+void NET_UDP_Run(void)
+{
+    net_udp_peer_t *peer;
+    int i;
+
+    if (!net_client_connected)
+    {
+        return;
+    }
+
+    net_poll();
+
+    for (i = 0; i < num_players; ++i)
+    {
+        peer = peers[i];
+
+        if (peer != NULL && !peer->quit
+         && is_timeout(peer->lastsend, NET_UDP_RESEND))
+        {
+            NET_UDP_SendTics(peer);
+        }
+    }
+
+    NET_UDP_CompleteTics();
+}
+
+void NET_UDP_Shutdown(void)
+{
+    net_udp_peer_t *peer;
+    int i, n;
+
+    if (!net_client_connected)
+    {
+        return;
+    }
+
+    for (i = 0; i < num_players; ++i)
+    {
+        peer = peers[i];
+
+        if (peer == NULL)
+        {
+            continue;
+        }
+
+        // Nothing acknowledges QUIT, send it a few times.
+
+        for (n = 0; n < 3 && !peer->quit; ++n)
+        {
+            NET_UDP_Header(peer, NET_UDP_QUIT);
+            NET_UDP_Send(peer, 0);
+        }
+
+        net_unregister(peer->con);
+        free(peer);
+        peers[i] = NULL;
+    }
+
+    net_client_connected = false;
+}
+
@@ -0,0 +1,30 @@
+//
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Peer to peer network games over the barebox UDP stack
+//
+
+#ifndef NET_UDP_H
+#define NET_UDP_H
+
+#include "net_defs.h"
+
+boolean NET_UDP_Init(net_connect_data_t *data);
+void NET_UDP_StartGame(net_gamesettings_t *settings);
+void NET_UDP_SendTiccmd(ticcmd_t *cmd, int maketic);
+void NET_UDP_Run(void);
+void NET_UDP_Shutdown(void);
+
+#endif /* #ifndef NET_UDP_H */
+
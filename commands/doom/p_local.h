@@ -173,7 +173,9 @@ extern fixed_t		lowfloor;
 
 void 	P_LineOpening (line_t* linedef);
 
-boolean P_BlockLinesIterator (int x, int y, boolean(*func)(line_t*) );
+int 	P_BoxOnBlockLineSide (fixed_t* tmbox, blockline_t* bl);
+
+boolean P_BlockLinesIterator (int x, int y, boolean(*func)(blockline_t*) );
 boolean P_BlockThingsIterator (int x, int y, boolean(*func)(mobj_t*) );
 
 #define PT_ADDLINES		1
@@ -266,6 +268,9 @@ extern int		bmapheight;	// in mapblocks
 extern fixed_t		bmaporgx;
 extern fixed_t		bmaporgy;	// origin of block map
 extern mobj_t**		blocklinks;	// for thing chains
+extern blockline_t*	blocklines;	// line geometry per mapblock
+extern int*		blocklinesofs;	// [bmapwidth*bmapheight+1] into blocklines
+extern int*		blocklinesvalid;	// [numlines] validcount marks
 
 
 
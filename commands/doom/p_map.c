@@ -202,18 +202,21 @@ static void SpechitOverrun(line_t *ld);
 // PIT_CheckLine
 // Adjusts tmfloorz and tmceilingz as lines are contacted
 //
-static boolean PIT_CheckLine (line_t* ld)
+static boolean PIT_CheckLine (blockline_t* bl)
 {
-    if (tmbbox[BOXRIGHT] <= ld->bbox[BOXLEFT]
-	|| tmbbox[BOXLEFT] >= ld->bbox[BOXRIGHT]
-	|| tmbbox[BOXTOP] <= ld->bbox[BOXBOTTOM]
-	|| tmbbox[BOXBOTTOM] >= ld->bbox[BOXTOP] )
+    line_t*	ld;
+
+    if (tmbbox[BOXRIGHT] <= bl->bbox[BOXLEFT]
+	|| tmbbox[BOXLEFT] >= bl->bbox[BOXRIGHT]
+	|| tmbbox[BOXTOP] <= bl->bbox[BOXBOTTOM]
+	|| tmbbox[BOXBOTTOM] >= bl->bbox[BOXTOP] )
 	return true;
 
-    if (P_BoxOnLineSide (tmbbox, ld) != -1)
+    if (P_BoxOnBlockLineSide (tmbbox, bl) != -1)
 	return true;
 		
     // A line has been hit
+    ld = &lines[bl->linenum];
     
     // The moving thing's destination position will cross
     // the given line.
@@ -54,40 +54,44 @@ P_AproxDistance
 
 
 //
-// P_PointOnLineSide
-// Returns 0 or 1
+// PointOnLineSide
+// Side test against a line given by its first vertex
+// and its precalculated v2 - v1.
 //
-int
-P_PointOnLineSide
+static int
+PointOnLineSide
 ( fixed_t	x,
   fixed_t	y,
-  line_t*	line )
+  fixed_t	lx,
+  fixed_t	ly,
+  fixed_t	ldx,
+  fixed_t	ldy )
 {
     fixed_t	dx;
     fixed_t	dy;
     fixed_t	left;
     fixed_t	right;
 	
-    if (!line->dx)
+    if (!ldx)
     {
-	if (x <= line->v1->x)
-	    return line->dy > 0;
+	if (x <= lx)
+	    return ldy > 0;
 	
-	return line->dy < 0;
+	return ldy < 0;
     }
-    if (!line->dy)
+    if (!ldy)
     {
-	if (y <= line->v1->y)
-	    return line->dx < 0;
+	if (y <= ly)
+	    return ldx < 0;
 	
-	return line->dx > 0;
+	return ldx > 0;
     }
 	
-    dx = (x - line->v1->x);
-    dy = (y - line->v1->y);
+    dx = (x - lx);
+    dy = (y - ly);
 	
-    left = FixedMul ( line->dy>>FRACBITS , dx );
-    right = FixedMul ( dy , line->dx>>FRACBITS );
+    left = FixedMul ( ldy>>FRACBITS , dx );
+    right = FixedMul ( dy , ldx>>FRACBITS );
 	
     if (right < left)
 	return 0;		// front side
@@ -95,26 +99,45 @@ P_PointOnLineSide
 }
 
 
+//
+// P_PointOnLineSide
+// Returns 0 or 1
+//
+int
+P_PointOnLineSide
+( fixed_t	x,
+  fixed_t	y,
+  line_t*	line )
+{
+    return PointOnLineSide (x, y, line->v1->x, line->v1->y,
+			    line->dx, line->dy);
+}
+
+
 
 //
-// P_BoxOnLineSide
+// BoxOnLineSide
 // Considers the line to be infinite
 // Returns side 0 or 1, -1 if box crosses the line.
 //
-int
-P_BoxOnLineSide
+static int
+BoxOnLineSide
 ( fixed_t*	tmbox,
-  line_t*	ld )
+  slopetype_t	slopetype,
+  fixed_t	lx,
+  fixed_t	ly,
+  fixed_t	ldx,
+  fixed_t	ldy )
 {
     int		p1 = 0;
     int		p2 = 0;
 	
-    switch (ld->slopetype)
+    switch (slopetype)
     {
       case ST_HORIZONTAL:
-	p1 = tmbox[BOXTOP] > ld->v1->y;
-	p2 = tmbox[BOXBOTTOM] > ld->v1->y;
-	if (ld->dx < 0)
+	p1 = tmbox[BOXTOP] > ly;
+	p2 = tmbox[BOXBOTTOM] > ly;
+	if (ldx < 0)
 	{
 	    p1 ^= 1;
 	    p2 ^= 1;
@@ -122,9 +145,9 @@ P_BoxOnLineSide
 	break;
 	
       case ST_VERTICAL:
-	p1 = tmbox[BOXRIGHT] < ld->v1->x;
-	p2 = tmbox[BOXLEFT] < ld->v1->x;
-	if (ld->dy < 0)
+	p1 = tmbox[BOXRIGHT] < lx;
+	p2 = tmbox[BOXLEFT] < lx;
+	if (ldy < 0)
 	{
 	    p1 ^= 1;
 	    p2 ^= 1;
@@ -132,13 +155,13 @@ P_BoxOnLineSide
 	break;
 	
       case ST_POSITIVE:
-	p1 = P_PointOnLineSide (tmbox[BOXLEFT], tmbox[BOXTOP], ld);
-	p2 = P_PointOnLineSide (tmbox[BOXRIGHT], tmbox[BOXBOTTOM], ld);
+	p1 = PointOnLineSide (tmbox[BOXLEFT], tmbox[BOXTOP], lx, ly, ldx, ldy);
+	p2 = PointOnLineSide (tmbox[BOXRIGHT], tmbox[BOXBOTTOM], lx, ly, ldx, ldy);
 	break;
 	
       case ST_NEGATIVE:
-	p1 = P_PointOnLineSide (tmbox[BOXRIGHT], tmbox[BOXTOP], ld);
-	p2 = P_PointOnLineSide (tmbox[BOXLEFT], tmbox[BOXBOTTOM], ld);
+	p1 = PointOnLineSide (tmbox[BOXRIGHT], tmbox[BOXTOP], lx, ly, ldx, ldy);
+	p2 = PointOnLineSide (tmbox[BOXLEFT], tmbox[BOXBOTTOM], lx, ly, ldx, ldy);
 	break;
     }
 
@@ -148,6 +171,34 @@ P_BoxOnLineSide
 }
 
 
+//
+// P_BoxOnLineSide
+//
+int
+P_BoxOnLineSide
+( fixed_t*	tmbox,
+  line_t*	ld )
+{
+    return BoxOnLineSide (tmbox, ld->slopetype, ld->v1->x, ld->v1->y,
+			  ld->dx, ld->dy);
+}
+
+
+//
+// P_BoxOnBlockLineSide
+// Same as P_BoxOnLineSide, but only uses the
+// geometry cached in the blockmap.
+//
+int
+P_BoxOnBlockLineSide
+( fixed_t*	tmbox,
+  blockline_t*	bl )
+{
+    return BoxOnLineSide (tmbox, bl->slopetype, bl->x, bl->y,
+			  bl->dx, bl->dy);
+}
+
+
 //
 // P_PointOnDivlineSide
 // Returns 0 or 1.
@@ -467,11 +518,11 @@ boolean
 P_BlockLinesIterator
 ( int			x,
   int			y,
-  boolean(*func)(line_t*) )
+  boolean(*func)(blockline_t*) )
 {
     int			offset;
-    short*		list;
-    line_t*		ld;
+    blockline_t*	bl;
+    blockline_t*	end;
 	
     if (x<0
 	|| y<0
@@ -482,19 +533,18 @@ P_BlockLinesIterator
     }
     
     offset = y*bmapwidth+x;
-	
-    offset = *(blockmap+offset);
 
-    for ( list = blockmaplump+offset ; *list != -1 ; list++)
-    {
-	ld = &lines[*list];
+    bl = blocklines + blocklinesofs[offset];
+    end = blocklines + blocklinesofs[offset+1];
 
-	if (ld->validcount == validcount)
+    for ( ; bl < end ; bl++)
+    {
+	if (blocklinesvalid[bl->linenum] == validcount)
 	    continue; 	// line has already been checked
 
-	ld->validcount = validcount;
+	blocklinesvalid[bl->linenum] = validcount;
 		
-	if ( !func(ld) )
+	if ( !func(bl) )
 	    return false;
     }
     return true;	// everything was checked
@@ -556,12 +606,13 @@ static void InterceptsOverrun(int num_intercepts, intercept_t *intercept);
 // Returns true if earlyout and a solid line hit.
 //
 static boolean
-PIT_AddLineIntercepts (line_t* ld)
+PIT_AddLineIntercepts (blockline_t* bl)
 {
     int			s1;
     int			s2;
     fixed_t		frac;
     divline_t		dl;
+    line_t*		ld;
 	
     // avoid precision problems with two routines
     if ( trace.dx > FRACUNIT*16
@@ -569,25 +620,32 @@ PIT_AddLineIntercepts (line_t* ld)
 	 || trace.dx < -FRACUNIT*16
 	 || trace.dy < -FRACUNIT*16)
     {
-	s1 = P_PointOnDivlineSide (ld->v1->x, ld->v1->y, &trace);
-	s2 = P_PointOnDivlineSide (ld->v2->x, ld->v2->y, &trace);
+	s1 = P_PointOnDivlineSide (bl->x, bl->y, &trace);
+	s2 = P_PointOnDivlineSide (bl->x+bl->dx, bl->y+bl->dy, &trace);
     }
     else
     {
-	s1 = P_PointOnLineSide (trace.x, trace.y, ld);
-	s2 = P_PointOnLineSide (trace.x+trace.dx, trace.y+trace.dy, ld);
+	s1 = PointOnLineSide (trace.x, trace.y,
+			      bl->x, bl->y, bl->dx, bl->dy);
+	s2 = PointOnLineSide (trace.x+trace.dx, trace.y+trace.dy,
+			      bl->x, bl->y, bl->dx, bl->dy);
     }
     
     if (s1 == s2)
 	return true;	// line isn't crossed
     
     // hit the line
-    P_MakeDivline (ld, &dl);
+    dl.x = bl->x;
+    dl.y = bl->y;
+    dl.dx = bl->dx;
+    dl.dy = bl->dy;
     frac = P_InterceptVector (&trace, &dl);
 
     if (frac < 0)
 	return true;	// behind source
 	
+    ld = &lines[bl->linenum];
+
     // try to early out the check
     if (earlyout
 	&& frac < FRACUNIT
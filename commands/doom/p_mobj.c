@@ -439,6 +439,16 @@ P_NightmareRespawn (mobj_t* mobj)
 //
 void P_MobjThinker (mobj_t* mobj)
 {
+    // Remember where the tic started, P_PlayerThink
+    // has already done so for players.
+    if (mobj->player == NULL || mobj != mobj->player->mo)
+    {
+	mobj->oldx = mobj->x;
+	mobj->oldy = mobj->y;
+	mobj->oldz = mobj->z;
+	mobj->interp = true;
+    }
+
     // momentum movement
     if (mobj->momx
 	|| mobj->momy
@@ -276,6 +276,14 @@ typedef struct mobj_s
 
     // Thing being chased/attacked for tracers.
     struct mobj_s*	tracer;	
+
+    // Position at the start of the current tic, for frames
+    // drawn between tics. Invalid unless interp is set.
+    fixed_t		oldx;
+    fixed_t		oldy;
+    fixed_t		oldz;
+    angle_t		oldangle;	// players only
+    boolean		interp;
     
 } mobj_t;
 
@@ -0,0 +1,256 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Background loading of the next level while the
+//	intermission screen is shown.
+//
+
+#include <string.h>
+#include <bthread.h>
+
+#include "doomdata.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "r_data.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#include "p_setup.h"
+#include "p_prefetch.h"
+
+static struct bthread *prefetcher;
+
+// Marker lump of the map to prefetch next, -1 if none.
+static int prefetch_lumpnum = -1;
+
+// Set by P_CancelPrefetch to abort the running prefetch.
+static boolean prefetch_cancel;
+
+// Set while a map is being prefetched.
+static boolean prefetch_busy;
+
+// Time the prefetcher may run before it yields to the game.
+#define PREFETCH_SLICE_MS	10
+
+//
+// P_PrefetchStopped
+// Yields to the game thread once the time slice is used up,
+// returns true if the current prefetch should be abandoned.
+//
+static boolean P_PrefetchStopped (void)
+{
+    bthread_checkpoint();
+
+    return prefetch_cancel || bthread_should_stop();
+}
+
+//
+// P_PrefetchCopyLump
+// Returns a private PU_STATIC copy of a lump if it
+// is resident, so it can be parsed across yields.
+//
+static void *P_PrefetchCopyLump (int lump)
+{
+    void*	data;
+
+    if (lumpinfo[lump].cache == NULL)
+	return NULL;
+
+    // Resident, so this only locks the lump against
+    // being purged by the allocation below.
+    W_CacheLumpNum(lump, PU_STATIC);
+
+    data = Z_Malloc(lumpinfo[lump].size, PU_STATIC, NULL);
+    memcpy(data, lumpinfo[lump].cache, lumpinfo[lump].size);
+
+    W_ReleaseLumpNum(lump);
+
+    return data;
+}
+
+static void P_PrefetchTextures (int lump)
+{
+    mapsidedef_t*	msd;
+    int			numsides;
+    int			i;
+
+    msd = P_PrefetchCopyLump(lump);
+    if (!msd)
+	return;
+
+    numsides = lumpinfo[lump].size / sizeof(mapsidedef_t);
+
+    for (i=0 ; i<numsides ; i++)
+    {
+	R_PrefetchTexture(R_CheckTextureNumForName(msd[i].toptexture));
+	R_PrefetchTexture(R_CheckTextureNumForName(msd[i].midtexture));
+	R_PrefetchTexture(R_CheckTextureNumForName(msd[i].bottomtexture));
+
+	if (P_PrefetchStopped())
+	    break;
+    }
+
+    Z_Free(msd);
+}
+
+static void P_PrefetchFlat (char *pic)
+{
+    char	name[9];
+
+    memcpy(name, pic, 8);
+    name[8] = 0;
+
+    W_PrefetchLump(W_CheckNumForName(name));
+}
+
+static void P_PrefetchFlats (int lump)
+{
+    mapsector_t*	ms;
+    int			numsectors;
+    int			i;
+
+    ms = P_PrefetchCopyLump(lump);
+    if (!ms)
+	return;
+
+    numsectors = lumpinfo[lump].size / sizeof(mapsector_t);
+
+    for (i=0 ; i<numsectors ; i++)
+    {
+	P_PrefetchFlat(ms[i].floorpic);
+	P_PrefetchFlat(ms[i].ceilingpic);
+
+	if (P_PrefetchStopped())
+	    break;
+    }
+
+    Z_Free(ms);
+}
+
+//
+// P_PrefetchMap
+// Loads the map lumps first, as P_SetupLevel reads
+// all of them, then the wall textures and flats
+// the map refers to.
+//
+static void P_PrefetchMap (int lumpnum)
+{
+    int		i;
+
+    for (i=ML_THINGS ; i<=ML_BLOCKMAP ; i++)
+    {
+	W_PrefetchLump(lumpnum + i);
+
+	if (P_PrefetchStopped())
+	    return;
+    }
+
+    P_PrefetchTextures(lumpnum + ML_SIDEDEFS);
+
+    if (P_PrefetchStopped())
+	return;
+
+    P_PrefetchFlats(lumpnum + ML_SECTORS);
+}
+
+static void P_PrefetchThread (void *data)
+{
+    int		lumpnum;
+
+    while (!bthread_should_stop())
+    {
+	if (prefetch_lumpnum < 0)
+	{
+	    bthread_suspend(current);
+	    continue;
+	}
+
+	lumpnum = prefetch_lumpnum;
+	prefetch_lumpnum = -1;
+	prefetch_cancel = false;
+	prefetch_busy = true;
+
+	P_PrefetchMap(lumpnum);
+
+	prefetch_busy = false;
+    }
+}
+
+static void P_PrefetchShutdown (void)
+{
+    if (!prefetcher)
+	return;
+
+    bthread_wake(prefetcher);
+    __bthread_stop(prefetcher);
+    prefetcher = NULL;
+}
+
+//
+// P_PrefetchLevel
+// Starts loading a map and its textures into the
+// zone in the background.
+//
+void P_PrefetchLevel (int episode, int map)
+{
+    char	lumpname[16];
+    int		lumpnum;
+
+    //!
+    // Don't load the next level in the background during
+    // the intermission.
+    //
+
+    if (M_CheckParm("-noprefetch"))
+	return;
+
+    P_MapLumpName(episode, map, lumpname, sizeof lumpname);
+
+    lumpnum = W_CheckNumForName(lumpname);
+    if (lumpnum < 0)
+	return;
+
+    if (!prefetcher)
+    {
+	prefetcher = bthread_run(P_PrefetchThread, NULL, "doom-prefetch");
+	if (!prefetcher)
+	    return;
+
+	bthread_set_slice(prefetcher, PREFETCH_SLICE_MS * 1000000ULL);
+	I_AtExit(P_PrefetchShutdown, true);
+    }
+
+    prefetch_lumpnum = lumpnum;
+    prefetch_cancel = true;
+    bthread_wake(prefetcher);
+}
+
+//
+// P_CancelPrefetch
+// Called before a level is loaded, so the game
+// thread does not compete with the prefetcher.
+// Waits for the prefetcher to give up: the level's
+// renderer and thinkers yield at checkpoints, and
+// an allocation by the prefetcher then could purge
+// cached data they still use.
+//
+void P_CancelPrefetch (void)
+{
+    prefetch_lumpnum = -1;
+    prefetch_cancel = true;
+
+    while (prefetch_busy)
+	bthread_reschedule();
+}
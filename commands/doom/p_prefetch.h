@@ -0,0 +1,29 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Background loading of the next level.
+//
+
+
+#ifndef __P_PREFETCH__
+#define __P_PREFETCH__
+
+// Called by WI_Start with the level that follows.
+void P_PrefetchLevel (int episode, int map);
+
+// Called by G_DoLoadLevel.
+void P_CancelPrefetch (void);
+
+#endif
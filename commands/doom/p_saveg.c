@@ -1655,6 +1655,7 @@ void P_UnArchiveThinkers (void)
 
 	    mobj->target = NULL;
             mobj->tracer = NULL;
+            mobj->interp = false;
 	    P_SetThingPosition (mobj);
 	    mobj->info = &mobjinfo[mobj->type];
 	    mobj->floorz = mobj->subsector->sector->floorheight;
@@ -88,6 +88,10 @@ fixed_t		bmaporgx;
 fixed_t		bmaporgy;
 // for thing chains
 mobj_t**	blocklinks;		
+// line geometry per mapblock, see P_LoadBlockLines
+blockline_t*	blocklines;
+int*		blocklinesofs;
+int*		blocklinesvalid;
 
 
 // REJECT
@@ -536,6 +540,72 @@ static void P_LoadBlockMap (int lump)
 
 
 
+//
+// P_LoadBlockLines
+// Flattens the blockmap line lists into one array
+// of blockline_t, so the blockmap iterators do not
+// have to chase line_t and vertex pointers.
+// Must be called after P_LoadLineDefs.
+//
+static void P_LoadBlockLines (void)
+{
+    int			i;
+    int			count;
+    int			numblocks;
+    short*		list;
+    line_t*		ld;
+    blockline_t*	bl;
+
+    numblocks = bmapwidth * bmapheight;
+    blocklinesofs = Z_Malloc((numblocks + 1) * sizeof(*blocklinesofs),
+			     PU_LEVEL, 0);
+
+    // Count the entries first, keeping the original
+    // order so iteration matches vanilla behaviour.
+
+    count = 0;
+    for (i=0 ; i<numblocks ; i++)
+    {
+	blocklinesofs[i] = count;
+
+	for (list = blockmaplump + blockmap[i] ; *list != -1 ; list++)
+	{
+	    if (*list >= 0 && *list < numlines)
+		count++;
+	}
+    }
+    blocklinesofs[numblocks] = count;
+
+    blocklines = Z_Malloc(count * sizeof(*blocklines), PU_LEVEL, 0);
+
+    bl = blocklines;
+    for (i=0 ; i<numblocks ; i++)
+    {
+	for (list = blockmaplump + blockmap[i] ; *list != -1 ; list++)
+	{
+	    if (*list < 0 || *list >= numlines)
+		continue;
+
+	    ld = &lines[*list];
+
+	    memcpy(bl->bbox, ld->bbox, sizeof(bl->bbox));
+	    bl->x = ld->v1->x;
+	    bl->y = ld->v1->y;
+	    bl->dx = ld->dx;
+	    bl->dy = ld->dy;
+	    bl->slopetype = ld->slopetype;
+	    bl->linenum = *list;
+	    bl++;
+	}
+    }
+
+    blocklinesvalid = Z_Malloc(numlines * sizeof(*blocklinesvalid),
+			       PU_LEVEL, 0);
+    memset(blocklinesvalid, 0, numlines * sizeof(*blocklinesvalid));
+}
+
+
+
 //
 // P_GroupLines
 // Builds sector line lists and subsector sector numbers.
@@ -736,6 +806,34 @@ static void P_LoadReject(int lumpnum)
     }
 }
 
+//
+// P_MapLumpName
+// Formats the name of the marker lump of a map.
+//
+void
+P_MapLumpName
+( int		episode,
+  int		map,
+  char*		lumpname,
+  size_t	len )
+{
+    if ( gamemode == commercial)
+    {
+	if (map<10)
+	    DEH_snprintf(lumpname, len, "map0%i", map);
+	else
+	    DEH_snprintf(lumpname, len, "map%i", map);
+    }
+    else
+    {
+	lumpname[0] = 'E';
+	lumpname[1] = '0' + episode;
+	lumpname[2] = 'M';
+	lumpname[3] = '0' + map;
+	lumpname[4] = 0;
+    }
+}
+
 //
 // P_SetupLevel
 //
@@ -771,21 +869,7 @@ P_SetupLevel
     P_InitThinkers ();
 	   
     // find map name
-    if ( gamemode == commercial)
-    {
-	if (map<10)
-	    DEH_snprintf(lumpname, sizeof lumpname, "map0%i", map);
-	else
-	    DEH_snprintf(lumpname, sizeof lumpname, "map%i", map);
-    }
-    else
-    {
-	lumpname[0] = 'E';
-	lumpname[1] = '0' + episode;
-	lumpname[2] = 'M';
-	lumpname[3] = '0' + map;
-	lumpname[4] = 0;
-    }
+    P_MapLumpName (episode, map, lumpname, sizeof lumpname);
 
     lumpnum = W_GetNumForName (lumpname);
 	
@@ -798,6 +882,7 @@ P_SetupLevel
     P_LoadSideDefs (lumpnum+ML_SIDEDEFS);
 
     P_LoadLineDefs (lumpnum+ML_LINEDEFS);
+    P_LoadBlockLines ();
     P_LoadSubsectors (lumpnum+ML_SSECTORS);
     P_LoadNodes (lumpnum+ML_NODES);
     P_LoadSegs (lumpnum+ML_SEGS);
@@ -23,6 +23,14 @@
 
 
 
+// Name of the marker lump of a map, ExMy or MAPxx.
+void
+P_MapLumpName
+( int		episode,
+  int		map,
+  char*		lumpname,
+  size_t	len );
+
 // NOT called by W_Ticker. Fixme.
 void
 P_SetupLevel
@@ -124,6 +124,9 @@ EV_Teleport
 
 		thing->angle = m->angle;
 		thing->momx = thing->momy = thing->momz = 0;
+
+		// don't draw it sliding across the map
+		thing->interp = false;
 		return 1;
 	    }	
 	}
@@ -18,6 +18,8 @@
 //
 
 
+#include <bthread.h>
+
 #include "z_zone.h"
 #include "p_local.h"
 
@@ -28,6 +30,10 @@
 
 int	leveltime;
 
+// leveltime before the most recent tic, the same if it didn't
+// run the level, e.g. while paused.
+int	oldleveltime;
+
 //
 // THINKERS
 // All thinkers should be allocated by Z_Malloc
@@ -81,13 +87,24 @@ void P_RemoveThinker (thinker_t* thinker)
 //
 // P_RunThinkers
 //
+// Thinkers run between yield checkpoints.
+#define THINKERS_PER_CHECKPOINT	64
+
 static void P_RunThinkers (void)
 {
     thinker_t*	currentthinker;
+    int		count;
 
+    count = 0;
     currentthinker = thinkercap.next;
     while (currentthinker != &thinkercap)
     {
+	if (++count == THINKERS_PER_CHECKPOINT)
+	{
+	    bthread_checkpoint();
+	    count = 0;
+	}
+
 	if ( currentthinker->function.acv == (actionf_v)(-1) )
 	{
 	    // time to remove it
@@ -113,6 +130,8 @@ static void P_RunThinkers (void)
 void P_Ticker (void)
 {
     int		i;
+
+    oldleveltime = leveltime;
     
     // run the tic
     if (paused)
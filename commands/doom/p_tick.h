@@ -28,6 +28,8 @@
 // Carries out all thinking of monsters and players.
 void P_Ticker (void);
 
+extern int oldleveltime;
+
 
 
 #endif
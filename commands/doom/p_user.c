@@ -231,6 +231,16 @@ void P_PlayerThink (player_t* player)
     ticcmd_t*		cmd;
     weapontype_t	newweapon;
 	
+    // Remember where the tic started. A body that has just been
+    // spawned or teleported has no view height worked out yet.
+    player->oldviewz = player->mo->interp ?
+	player->viewz : player->mo->z + player->viewheight;
+    player->mo->oldx = player->mo->x;
+    player->mo->oldy = player->mo->y;
+    player->mo->oldz = player->mo->z;
+    player->mo->oldangle = player->mo->angle;
+    player->mo->interp = true;
+
     // fixme: do this in the cheat code
     if (player->cheats & CF_NOCLIP)
 	player->mo->flags |= MF_NOCLIP;
@@ -19,6 +19,8 @@
 
 
 
+#include <bthread.h>
+
 #include "doomdef.h"
 
 #include "m_bbox.h"
@@ -492,6 +494,10 @@ static void R_Subsector (int num)
 		 numsubsectors);
 #endif
 
+    // Let background services run if the frame takes long.
+    // Nothing from the zone is held between subsectors.
+    bthread_checkpoint();
+
     sscount++;
     sub = &subsectors[num];
     frontsector = sub->sector;
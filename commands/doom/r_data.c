@@ -787,6 +787,27 @@ int	R_TextureNumForName (char* name)
 
 
 
+//
+// R_PrefetchTexture
+// Loads the patches of a texture into the
+// cache in the background, see P_PrefetchLevel.
+//
+void R_PrefetchTexture (int texnum)
+{
+    texture_t*	texture;
+    int		j;
+
+    if (texnum <= 0 || texnum >= numtextures)
+	return;
+
+    texture = textures[texnum];
+
+    for (j=0 ; j<texture->patchcount ; j++)
+	W_PrefetchLump (texture->patches[j].patch);
+}
+
+
+
 //
 // R_PrecacheLevel
 // Preloads all relevant graphics for the level.
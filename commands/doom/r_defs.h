@@ -212,6 +212,30 @@ typedef struct line_s
 
 
 
+//
+// Compact copy of a LineDef as referenced from a mapblock.
+// The blockmap iterators walk arrays of these, so move
+// clipping and traces can reject a line without touching
+// the line_t or its vertexes.
+//
+typedef struct
+{
+    fixed_t	bbox[4];
+
+    // v1 and v2 - v1.
+    fixed_t	x;
+    fixed_t	y;
+    fixed_t	dx;
+    fixed_t	dy;
+
+    slopetype_t	slopetype;
+
+    // Index into lines[].
+    int		linenum;
+} blockline_t;
+
+
+
 
 //
 // A SubSector.
@@ -0,0 +1,222 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Detail and view size governor.
+//
+//	The time R_RenderPlayerView takes is averaged over the last
+//	frames. When it is over budget for the target frame rate, the
+//	governor steps down from the menu settings: first to low
+//	detail, then one view size at a time. It steps back up only
+//	after the view has rendered well under budget for a while,
+//	and waits twice as long each time a step up has to be undone
+//	right away, so it settles instead of going back and forth.
+//
+
+#include <string.h>
+
+#include "doomdef.h"
+#include "m_menu.h"
+#include "r_main.h"
+#include "r_governor.h"
+
+// Share of each frame the view may take, the rest is left for the
+// status bar, menus and getting the frame on screen.
+#define GOV_RENDER_SHARE	75
+
+// Step back up only when the view takes less than this
+// share of its budget.
+#define GOV_RAISE_SHARE		60
+
+// Smallest view size the governor shrinks to.
+#define GOV_MIN_BLOCKS		5
+
+// Frames ignored after a change, while the new size settles.
+#define GOV_SETTLE_FRAMES	8
+
+// Frames under budget before stepping back up.
+#define GOV_RAISE_FRAMES	70
+#define GOV_RAISE_FRAMES_MAX	(GOV_RAISE_FRAMES * 16)
+
+int governor_target_fps;
+int governor_level;
+int governor_detail;
+int governor_screenblocks;
+int governor_render_us;
+uint32_t governor_history[GOVERNOR_HISTORY];
+int governor_history_pos;
+
+// Settings the levels are counted from.
+static int menu_blocks;
+static int menu_detail;
+static int last_target_fps;
+
+static int settle_frames;
+static int fast_frames;
+static int raise_frames;
+
+// Frames since the last step up.
+static int raised_frames;
+
+static int MaxLevel(void)
+{
+    int level;
+
+    level = menu_blocks - GOV_MIN_BLOCKS;
+
+    if (level < 0)
+    {
+        level = 0;
+    }
+
+    if (menu_detail == 0)
+    {
+        ++level;
+    }
+
+    return level;
+}
+
+static void SetLevel(int level)
+{
+    int blocks;
+    int detail;
+
+    governor_level = level;
+
+    blocks = menu_blocks;
+    detail = menu_detail;
+
+    // Low detail first, it keeps the view size.
+
+    if (level > 0 && detail == 0)
+    {
+        detail = 1;
+        --level;
+    }
+
+    blocks -= level;
+
+    if (blocks != governor_screenblocks || detail != governor_detail)
+    {
+        governor_screenblocks = blocks;
+        governor_detail = detail;
+        R_SetViewSize(blocks, detail);
+    }
+
+    settle_frames = GOV_SETTLE_FRAMES;
+    fast_frames = 0;
+}
+
+static void ResetGovernor(void)
+{
+    menu_blocks = screenblocks;
+    menu_detail = detailLevel;
+    last_target_fps = governor_target_fps;
+
+    governor_level = 0;
+    governor_screenblocks = screenblocks;
+    governor_detail = detailLevel;
+
+    raise_frames = GOV_RAISE_FRAMES;
+    raised_frames = GOV_RAISE_FRAMES_MAX;
+    settle_frames = GOV_SETTLE_FRAMES;
+    fast_frames = 0;
+}
+
+void R_InitGovernor (void)
+{
+    memset(governor_history, 0, sizeof(governor_history));
+    governor_history_pos = 0;
+    governor_render_us = 0;
+
+    ResetGovernor();
+}
+
+void R_UpdateGovernor (int render_us)
+{
+    int budget;
+
+    governor_history[governor_history_pos] = render_us;
+    governor_history_pos = (governor_history_pos + 1) % GOVERNOR_HISTORY;
+
+    // Start over from the menu settings when they or the target
+    // change. The menu applies its own settings.
+
+    if (screenblocks != menu_blocks || detailLevel != menu_detail)
+    {
+        ResetGovernor();
+    }
+    else if (governor_target_fps != last_target_fps)
+    {
+        if (governor_level > 0)
+        {
+            SetLevel(0);
+        }
+
+        ResetGovernor();
+    }
+
+    if (settle_frames > 0)
+    {
+        --settle_frames;
+        governor_render_us = render_us;
+        return;
+    }
+
+    governor_render_us += (render_us - governor_render_us) / 8;
+
+    if (governor_target_fps <= 0)
+    {
+        return;
+    }
+
+    budget = 1000000 / governor_target_fps * GOV_RENDER_SHARE / 100;
+
+    if (raised_frames < GOV_RAISE_FRAMES_MAX)
+    {
+        ++raised_frames;
+    }
+
+    if (governor_render_us > budget)
+    {
+        fast_frames = 0;
+
+        if (governor_level < MaxLevel())
+        {
+            // The last step up didn't hold, wait longer next time.
+
+            if (raised_frames < raise_frames
+             && raise_frames < GOV_RAISE_FRAMES_MAX)
+            {
+                raise_frames *= 2;
+            }
+
+            SetLevel(governor_level + 1);
+        }
+    }
+    else if (governor_level > 0
+          && governor_render_us < budget * GOV_RAISE_SHARE / 100)
+    {
+        if (++fast_frames >= raise_frames)
+        {
+            SetLevel(governor_level - 1);
+            raised_frames = 0;
+        }
+    }
+    else
+    {
+        fast_frames = 0;
+    }
+}
@@ -0,0 +1,47 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Detail and view size governor, holds a target frame rate.
+//
+
+
+#ifndef __R_GOVERNOR__
+#define __R_GOVERNOR__
+
+#include "doomtype.h"
+
+// Number of view render times kept in governor_history.
+#define GOVERNOR_HISTORY	16
+
+// Frame rate to hold, 0 to leave detail and view size alone.
+extern int governor_target_fps;
+
+// Steps taken down from the menu settings, and what is used now.
+extern int governor_level;
+extern int governor_detail;
+extern int governor_screenblocks;
+
+// Averaged and recent R_RenderPlayerView times in microseconds.
+// governor_history is a ring, governor_history_pos the oldest entry.
+extern int governor_render_us;
+extern uint32_t governor_history[GOVERNOR_HISTORY];
+extern int governor_history_pos;
+
+void R_InitGovernor (void);
+
+// Called with the time the last view took to render.
+void R_UpdateGovernor (int render_us);
+
+#endif
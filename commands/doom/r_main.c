@@ -27,15 +27,19 @@
 
 
 #include "doomdef.h"
+#include "doomstat.h"
 #include "d_loop.h"
+#include "i_timer.h"
 
 #include "m_bbox.h"
 #include "m_menu.h"
+#include "p_tick.h"
 
 #include "r_local.h"
 #include "r_sky.h"
 #include "r_bsp.h"
 #include "r_main.h"
+#include "r_governor.h"
 
 
 
@@ -104,7 +108,11 @@ lighttable_t*		scalelightfixed[MAXLIGHTSCALE];
 lighttable_t*		zlight[LIGHTLEVELS][MAXLIGHTZ];
 
 // bumped light from gun blasts
-int			extralight;			
+int			extralight;
+
+// How far into the next tic the frame is drawn, FRACUNIT
+// when not interpolating.
+fixed_t			fractionaltic = FRACUNIT;			
 
 
 
@@ -777,6 +785,7 @@ void R_Init (void)
     printf (".");
 
     R_SetViewSize (screenblocks, detailLevel);
+    R_InitGovernor ();
     R_InitPlanes ();
     printf (".");
     R_InitLightTables ();
@@ -819,20 +828,57 @@ R_PointInSubsector
 
 
 
+//
+// R_InterpolateFixed
+// Value between where it was at the start of the tic and now.
+//
+fixed_t R_InterpolateFixed (fixed_t oldvalue, fixed_t value)
+{
+    return oldvalue + FixedMul(value - oldvalue, fractionaltic);
+}
+
+angle_t R_InterpolateAngle (angle_t oldangle, angle_t angle)
+{
+    // turn the short way round
+    return oldangle + FixedMul((int) (angle - oldangle), fractionaltic);
+}
+
+
+
 //
 // R_SetupFrame
 //
 static void R_SetupFrame (player_t* player)
 {		
     int		i;
+    mobj_t*	mo;
     
+    mo = player->mo;
+
+    // only interpolate while the level runs, not while paused
+    fractionaltic = D_GetFractionalTic();
+
+    if (leveltime == oldleveltime)
+	fractionaltic = FRACUNIT;
+
     viewplayer = player;
-    viewx = player->mo->x;
-    viewy = player->mo->y;
-    viewangle = player->mo->angle + viewangleoffset;
     extralight = player->extralight;
 
-    viewz = player->viewz;
+    if (fractionaltic < FRACUNIT && mo->interp)
+    {
+	viewx = R_InterpolateFixed(mo->oldx, mo->x);
+	viewy = R_InterpolateFixed(mo->oldy, mo->y);
+	viewangle = R_InterpolateAngle(mo->oldangle, mo->angle)
+		  + viewangleoffset;
+	viewz = R_InterpolateFixed(player->oldviewz, player->viewz);
+    }
+    else
+    {
+	viewx = mo->x;
+	viewy = mo->y;
+	viewangle = mo->angle + viewangleoffset;
+	viewz = player->viewz;
+    }
     
     viewsin = finesine[viewangle>>ANGLETOFINESHIFT];
     viewcos = finecosine[viewangle>>ANGLETOFINESHIFT];
@@ -864,6 +910,10 @@ static void R_SetupFrame (player_t* player)
 //
 void R_RenderPlayerView (player_t* player)
 {	
+    unsigned int start;
+
+    start = I_GetTimeUS();
+
     R_SetupFrame (player);
 
     // Clear buffers.
@@ -890,4 +940,6 @@ void R_RenderPlayerView (player_t* player)
 
     // Check for new console commands.
     NetUpdate ();				
+
+    R_UpdateGovernor (I_GetTimeUS() - start);
 }
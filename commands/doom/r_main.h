@@ -46,6 +46,8 @@ extern fixed_t		projection;
 
 extern int		validcount;
 
+extern fixed_t		fractionaltic;
+
 extern int		linecount;
 extern int		loopcount;
 
@@ -131,6 +133,9 @@ R_PointToDist
 
 fixed_t R_ScaleFromGlobalAngle (angle_t visangle);
 
+fixed_t R_InterpolateFixed (fixed_t oldvalue, fixed_t value);
+angle_t R_InterpolateAngle (angle_t oldangle, angle_t angle);
+
 subsector_t*
 R_PointInSubsector
 ( fixed_t	x,
@@ -20,6 +20,7 @@
 
 
 #include <stdlib.h>
+#include <bthread.h>
 
 #include "i_system.h"
 #include "z_zone.h"
@@ -381,6 +382,8 @@ void R_DrawPlanes (void)
 
     for (pl = visplanes ; pl < lastvisplane ; pl++)
     {
+	bthread_checkpoint();
+
 	if (pl->minx > pl->maxx)
 	    continue;
 
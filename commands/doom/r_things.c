@@ -470,10 +470,27 @@ static void R_ProjectSprite (mobj_t* thing)
     
     angle_t		ang;
     fixed_t		iscale;
+
+    fixed_t		x;
+    fixed_t		y;
+    fixed_t		z;
+
+    if (fractionaltic < FRACUNIT && thing->interp)
+    {
+	x = R_InterpolateFixed(thing->oldx, thing->x);
+	y = R_InterpolateFixed(thing->oldy, thing->y);
+	z = R_InterpolateFixed(thing->oldz, thing->z);
+    }
+    else
+    {
+	x = thing->x;
+	y = thing->y;
+	z = thing->z;
+    }
     
     // transform the origin point
-    tr_x = thing->x - viewx;
-    tr_y = thing->y - viewy;
+    tr_x = x - viewx;
+    tr_y = y - viewy;
 	
     gxt = FixedMul(tr_x,viewcos); 
     gyt = -FixedMul(tr_y,viewsin);
@@ -511,7 +528,7 @@ static void R_ProjectSprite (mobj_t* thing)
     if (sprframe->rotate)
     {
 	// choose a different rotation based on player view
-	ang = R_PointToAngle (thing->x, thing->y);
+	ang = R_PointToAngle (x, y);
 	rot = (ang-thing->angle+(unsigned)(ANG45/2)*9)>>29;
 	lump = sprframe->lump[rot];
 	flip = (boolean)sprframe->flip[rot];
@@ -542,10 +559,10 @@ static void R_ProjectSprite (mobj_t* thing)
     vis = R_NewVisSprite ();
     vis->mobjflags = thing->flags;
     vis->scale = xscale<<detailshift;
-    vis->gx = thing->x;
-    vis->gy = thing->y;
-    vis->gz = thing->z;
-    vis->gzt = thing->z + spritetopoffset[lump];
+    vis->gx = x;
+    vis->gy = y;
+    vis->gz = z;
+    vis->gzt = z + spritetopoffset[lump];
     vis->texturemid = vis->gzt - viewz;
     vis->x1 = x1 < 0 ? 0 : x1;
     vis->x2 = x2 >= viewwidth ? viewwidth-1 : x2;	
@@ -1,6 +1,7 @@
 #ifndef DOOMSTDLIB_H_
 #define DOOMSTDLIB_H_
 
+#include_next <stdlib.h>
 #include <linux/kernel.h>
 #include <asm/setjmp.h>
 #define strtol(...) simple_strtol(__VA_ARGS__)
@@ -17,36 +17,32 @@
 
 
 #include <stdlib.h>
+#include <bthread.h>
 
 #include "config.h"
 
 #include "doomtype.h"
-#include "m_argv.h"
 
 #include "w_file.h"
 
 extern wad_file_class_t stdc_wad_file;
+extern wad_file_class_t net_wad_file;
 
 static wad_file_class_t *wad_file_classes[] = 
 {
+    // WADs on TFTP and NFS are read through a local block cache.
+    &net_wad_file,
     &stdc_wad_file,
 };
 
 wad_file_t *W_OpenFile(char *path)
 {
     wad_file_t *result;
+#ifdef CONFIG_ZLIB
+    wad_file_t *gz;
+#endif
     int i;
 
-    //!
-    // Use the OS's virtual memory subsystem to map WAD files
-    // directly into memory.
-    //
-
-    if (!M_CheckParm("-mmap"))
-    {
-        return stdc_wad_file.OpenFile(path);
-    }
-
     // Try all classes in order until we find one that works
 
     result = NULL;
@@ -61,6 +57,22 @@ wad_file_t *W_OpenFile(char *path)
         }
     }
 
+#ifdef CONFIG_ZLIB
+    // Compressed WADs are recognized by their header and
+    // decompressed on demand, reading through the class that
+    // opened the file.
+
+    if (result != NULL)
+    {
+        gz = W_Gzip_OpenWad(result, path);
+
+        if (gz != NULL)
+        {
+            result = gz;
+        }
+    }
+#endif
+
     return result;
 }
 
@@ -69,9 +81,26 @@ void W_CloseFile(wad_file_t *wad)
     wad->file_class->CloseFile(wad);
 }
 
+// Set while a read is in progress. Reads from network or block
+// storage may reschedule to other bthreads, e.g. the level
+// prefetcher, which must then not seek the same file underneath us.
+
+static boolean read_in_progress = false;
+
 size_t W_Read(wad_file_t *wad, unsigned int offset,
               void *buffer, size_t buffer_len)
 {
-    return wad->file_class->Read(wad, offset, buffer, buffer_len);
+    size_t result;
+
+    while (read_in_progress)
+    {
+        bthread_reschedule();
+    }
+
+    read_in_progress = true;
+    result = wad->file_class->Read(wad, offset, buffer, buffer_len);
+    read_in_progress = false;
+
+    return result;
 }
 
@@ -74,4 +74,9 @@ void W_CloseFile(wad_file_t *wad);
 size_t W_Read(wad_file_t *wad, unsigned int offset,
               void *buffer, size_t buffer_len);
 
+// Open the gzip compressed WAD in a file already opened by
+// another class. Returns NULL if it isn't one.
+
+wad_file_t *W_Gzip_OpenWad(wad_file_t *base, char *path);
+
 #endif /* #ifndef __W_FILE__ */
@@ -0,0 +1,555 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	WAD I/O functions for gzip compressed WAD files.
+//
+//	Deflate streams can't be seeked, so on open the whole file
+//	is inflated once to build an index of access points, each
+//	holding the 32K of history needed to resume inflating at a
+//	deflate block boundary. Reads then only inflate from the
+//	closest access point, so only the lumps actually used are
+//	decompressed and the uncompressed WAD is never held in memory.
+//
+//	The compressed data is read through the class that opened the
+//	file, so compressed WADs on TFTP and NFS use its block cache.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <filetype.h>
+#include <linux/zlib.h>
+
+#include "i_system.h"
+#include "m_misc.h"
+#include "w_file.h"
+#include "z_zone.h"
+
+// Uncompressed distance between access points.
+#define GZIP_SPAN	(1024 * 1024)
+
+// Deflate history size.
+#define GZIP_WINSIZE	32768
+
+#define GZIP_CHUNK	16384
+
+typedef struct
+{
+    // Offset in the uncompressed data.
+    unsigned int out;
+
+    // Offset of the first byte in the compressed file that is
+    // not yet consumed, and the number of unused bits of the
+    // byte before it.
+    unsigned int in;
+    int bits;
+
+    byte window[GZIP_WINSIZE];
+} gzip_point_t;
+
+typedef struct
+{
+    wad_file_t wad;
+
+    // File holding the compressed data, and the offset in it
+    // the next W_Gzip_ReadBase continues at.
+    wad_file_t *base;
+    unsigned int in_pos;
+
+    gzip_point_t *points;
+    int numpoints;
+
+    z_stream strm;
+
+    // Current position of strm in the uncompressed data, so that
+    // sequential reads continue inflating instead of seeking.
+    // UINT_MAX if strm is not valid.
+    unsigned int strm_out;
+
+    byte inbuf[GZIP_CHUNK];
+    byte discard[GZIP_CHUNK];
+} gzip_wad_file_t;
+
+extern wad_file_class_t gzip_wad_file;
+
+//
+// Read from the compressed file. This runs inside W_Read, so
+// call the base class directly instead of going through it again.
+//
+
+static size_t W_Gzip_ReadBase(gzip_wad_file_t *gz, void *buffer, size_t len)
+{
+    len = gz->base->file_class->Read(gz->base, gz->in_pos, buffer, len);
+    gz->in_pos += len;
+
+    return len;
+}
+
+static int W_Gzip_Fill(gzip_wad_file_t *gz)
+{
+    size_t len;
+
+    len = W_Gzip_ReadBase(gz, gz->inbuf, GZIP_CHUNK);
+
+    if (len == 0)
+    {
+        return -1;
+    }
+
+    gz->strm.next_in = gz->inbuf;
+    gz->strm.avail_in = len;
+
+    return 0;
+}
+
+//
+// Next byte of the compressed file, or -1.
+//
+
+static int W_Gzip_Byte(gzip_wad_file_t *gz)
+{
+    if (gz->strm.avail_in == 0 && W_Gzip_Fill(gz) < 0)
+    {
+        return -1;
+    }
+
+    --gz->strm.avail_in;
+
+    return *gz->strm.next_in++;
+}
+
+//
+// Parse the gzip member header, returns the offset of the
+// deflate stream or -1. The optional fields have no length
+// limit, so they are skipped as they are read.
+//
+
+static int W_Gzip_ParseHeader(gzip_wad_file_t *gz)
+{
+    byte header[10];
+    int flags;
+    int len;
+    int c;
+    int i;
+
+    gz->in_pos = 0;
+    gz->strm.avail_in = 0;
+
+    for (i = 0; i < 10; ++i)
+    {
+        c = W_Gzip_Byte(gz);
+
+        if (c < 0)
+        {
+            return -1;
+        }
+
+        header[i] = c;
+    }
+
+    if (header[0] != 0x1f || header[1] != 0x8b || header[2] != 0x08)
+    {
+        return -1;
+    }
+
+    flags = header[3];
+
+    // FEXTRA
+
+    if (flags & 0x04)
+    {
+        len = W_Gzip_Byte(gz);
+        c = W_Gzip_Byte(gz);
+
+        if (len < 0 || c < 0)
+        {
+            return -1;
+        }
+
+        for (len |= c << 8; len > 0; --len)
+        {
+            if (W_Gzip_Byte(gz) < 0)
+            {
+                return -1;
+            }
+        }
+    }
+
+    // FNAME, FCOMMENT
+
+    for (i = 0x08; i <= 0x10; i <<= 1)
+    {
+        if (!(flags & i))
+        {
+            continue;
+        }
+
+        do
+        {
+            c = W_Gzip_Byte(gz);
+
+            if (c < 0)
+            {
+                return -1;
+            }
+        } while (c != 0);
+    }
+
+    // FHCRC
+
+    if (flags & 0x02)
+    {
+        if (W_Gzip_Byte(gz) < 0 || W_Gzip_Byte(gz) < 0)
+        {
+            return -1;
+        }
+    }
+
+    return gz->in_pos - gz->strm.avail_in;
+}
+
+static void W_Gzip_AddPoint(gzip_wad_file_t *gz, int bits,
+                            unsigned int in, unsigned int out,
+                            unsigned int left, byte *window)
+{
+    gzip_point_t *point;
+
+    gz->points = realloc(gz->points,
+                         (gz->numpoints + 1) * sizeof(*gz->points));
+
+    if (gz->points == NULL)
+    {
+        I_Error("Couldn't realloc gzip index");
+    }
+
+    point = &gz->points[gz->numpoints++];
+
+    point->bits = bits;
+    point->in = in;
+    point->out = out;
+
+    // window is used as a ring, left is how much of it has not
+    // been written since it last wrapped.
+
+    if (left)
+    {
+        memcpy(point->window, window + GZIP_WINSIZE - left, left);
+    }
+
+    if (left < GZIP_WINSIZE)
+    {
+        memcpy(point->window + left, window, GZIP_WINSIZE - left);
+    }
+}
+
+//
+// Inflate the whole stream once, recording an access point at
+// the first deflate block boundary after every GZIP_SPAN bytes.
+//
+
+static boolean W_Gzip_BuildIndex(gzip_wad_file_t *gz, int start)
+{
+    z_stream *strm = &gz->strm;
+    unsigned int totin, totout, last;
+    byte *window;
+    int ret;
+
+    window = Z_Malloc(GZIP_WINSIZE, PU_STATIC, NULL);
+    memset(window, 0, GZIP_WINSIZE);
+
+    gz->in_pos = start;
+
+    zlib_inflateInit2(strm, -MAX_WBITS);
+    strm->avail_in = 0;
+    strm->avail_out = 0;
+
+    totin = start;
+    totout = last = 0;
+    ret = Z_OK;
+
+    // Raw inflate doesn't stop before the first block.
+
+    W_Gzip_AddPoint(gz, 0, totin, 0, GZIP_WINSIZE, window);
+
+    do
+    {
+        if (strm->avail_in == 0 && W_Gzip_Fill(gz) < 0)
+        {
+            break;
+        }
+
+        do
+        {
+            if (strm->avail_out == 0)
+            {
+                strm->avail_out = GZIP_WINSIZE;
+                strm->next_out = window;
+            }
+
+            // Stop at the end of each deflate block, so that
+            // we can add an access point there.
+
+            totin += strm->avail_in;
+            totout += strm->avail_out;
+            ret = zlib_inflate(strm, Z_BLOCK);
+            totin -= strm->avail_in;
+            totout -= strm->avail_out;
+
+            if (ret == Z_NEED_DICT || ret < 0)
+            {
+                break;
+            }
+
+            if (ret == Z_STREAM_END)
+            {
+                break;
+            }
+
+            // Bit 7 of data_type: at a block boundary,
+            // bit 6: last block.
+
+            if ((strm->data_type & 128) && !(strm->data_type & 64)
+             && totout - last > GZIP_SPAN)
+            {
+                W_Gzip_AddPoint(gz, strm->data_type & 7, totin,
+                                totout, strm->avail_out, window);
+                last = totout;
+            }
+        } while (strm->avail_in != 0);
+    } while (ret != Z_STREAM_END && ret >= 0 && ret != Z_NEED_DICT);
+
+    zlib_inflateEnd(strm);
+    Z_Free(window);
+
+    if (ret != Z_STREAM_END)
+    {
+        return false;
+    }
+
+    gz->wad.length = totout;
+
+    return true;
+}
+
+//
+// Position the stream at the access point before offset.
+//
+
+static boolean W_Gzip_Seek(gzip_wad_file_t *gz, unsigned int offset)
+{
+    z_stream *strm = &gz->strm;
+    gzip_point_t *point;
+    int i;
+
+    point = &gz->points[0];
+
+    for (i = 1; i < gz->numpoints && gz->points[i].out <= offset; ++i)
+    {
+        point = &gz->points[i];
+    }
+
+    // Keep inflating from where the last read stopped, unless
+    // the access point is closer.
+
+    if (gz->strm_out != UINT_MAX && gz->strm_out <= offset
+     && gz->strm_out >= point->out)
+    {
+        return true;
+    }
+
+    gz->in_pos = point->in - (point->bits ? 1 : 0);
+
+    zlib_inflateInit2(strm, -MAX_WBITS);
+    strm->avail_in = 0;
+
+    if (point->bits)
+    {
+        byte c;
+
+        if (W_Gzip_ReadBase(gz, &c, 1) != 1)
+        {
+            gz->strm_out = UINT_MAX;
+            return false;
+        }
+
+        zlib_inflatePrime(strm, point->bits, c >> (8 - point->bits));
+    }
+
+    zlib_inflateSetDictionary(strm, point->window, GZIP_WINSIZE);
+
+    gz->strm_out = point->out;
+
+    return true;
+}
+
+//
+// Inflate len bytes into buffer, or discard them if buffer is NULL.
+//
+
+static size_t W_Gzip_Inflate(gzip_wad_file_t *gz, byte *buffer, size_t len)
+{
+    z_stream *strm = &gz->strm;
+    size_t done = 0;
+    size_t now;
+    int ret;
+
+    while (done < len)
+    {
+        if (strm->avail_in == 0 && W_Gzip_Fill(gz) < 0)
+        {
+            break;
+        }
+
+        if (buffer != NULL)
+        {
+            now = len - done;
+            strm->next_out = buffer + done;
+        }
+        else
+        {
+            now = len - done;
+
+            if (now > sizeof(gz->discard))
+            {
+                now = sizeof(gz->discard);
+            }
+
+            strm->next_out = gz->discard;
+        }
+
+        strm->avail_out = now;
+
+        ret = zlib_inflate(strm, Z_NO_FLUSH);
+
+        done += now - strm->avail_out;
+
+        if (ret != Z_OK && ret != Z_BUF_ERROR)
+        {
+            break;
+        }
+    }
+
+    if (done < len)
+    {
+        // Stream ended or is corrupt, seek again next time.
+
+        gz->strm_out = UINT_MAX;
+    }
+    else
+    {
+        gz->strm_out += done;
+    }
+
+    return done;
+}
+
+//
+// Open the compressed WAD in base, which is then closed along
+// with it. Returns NULL and leaves base alone if it isn't one.
+//
+
+wad_file_t *W_Gzip_OpenWad(wad_file_t *base, char *path)
+{
+    gzip_wad_file_t *result;
+    byte header[64];
+    enum filetype ft;
+    size_t len;
+    int start;
+
+    len = base->file_class->Read(base, 0, header, sizeof(header));
+    ft = file_detect_type(header, len);
+
+    if (ft != filetype_gzip)
+    {
+        if (file_is_compressed_file(ft))
+        {
+            printf("%s: %s is not seekable, only gzip compressed "
+                   "WADs are supported\n", path, file_type_to_string(ft));
+        }
+
+        return NULL;
+    }
+
+    result = Z_Malloc(sizeof(gzip_wad_file_t), PU_STATIC, 0);
+    memset(result, 0, sizeof(gzip_wad_file_t));
+    result->wad.file_class = &gzip_wad_file;
+    result->wad.mapped = NULL;
+    result->base = base;
+    result->strm.workspace = Z_Malloc(zlib_inflate_workspacesize(),
+                                      PU_STATIC, 0);
+    result->strm_out = UINT_MAX;
+
+    printf("indexing compressed %s\n", path);
+
+    start = W_Gzip_ParseHeader(result);
+
+    if (start < 0 || !W_Gzip_BuildIndex(result, start)
+     || result->numpoints == 0)
+    {
+        printf("%s: corrupt gzip stream\n", path);
+        free(result->points);
+        Z_Free(result->strm.workspace);
+        Z_Free(result);
+        return NULL;
+    }
+
+    return &result->wad;
+}
+
+static void W_Gzip_CloseFile(wad_file_t *wad)
+{
+    gzip_wad_file_t *gz;
+
+    gz = (gzip_wad_file_t *) wad;
+
+    W_CloseFile(gz->base);
+    free(gz->points);
+    Z_Free(gz->strm.workspace);
+    Z_Free(gz);
+}
+
+// Read data from the specified position in the file into the
+// provided buffer.  Returns the number of bytes read.
+
+static size_t W_Gzip_Read(wad_file_t *wad, unsigned int offset,
+                   void *buffer, size_t buffer_len)
+{
+    gzip_wad_file_t *gz;
+    unsigned int skip;
+
+    gz = (gzip_wad_file_t *) wad;
+
+    if (!W_Gzip_Seek(gz, offset))
+    {
+        return 0;
+    }
+
+    skip = offset - gz->strm_out;
+
+    if (skip > 0 && W_Gzip_Inflate(gz, NULL, skip) < skip)
+    {
+        return 0;
+    }
+
+    return W_Gzip_Inflate(gz, buffer, buffer_len);
+}
+
+
+wad_file_class_t gzip_wad_file =
+{
+    // Opened by W_Gzip_OpenWad on top of another class.
+    NULL,
+    W_Gzip_CloseFile,
+    W_Gzip_Read,
+};
@@ -0,0 +1,333 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	WAD I/O functions for WADs on network filesystems.
+//
+//	Lumps are read into a sparse cache of fixed size blocks,
+//	a bitmap records which blocks are present. On NFS, missing
+//	blocks are read with one seek per contiguous range, and the
+//	range is extended by a read-ahead window, so the lumps that
+//	follow in the WAD arrive in the same transfer. TFTP can't
+//	seek at all, so the file is streamed once front to back and
+//	every block passed is kept for later reads.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <libfile.h>
+#include <linux/bitops.h>
+#include <linux/stat.h>
+#include <sys/mount.h>
+
+#include "i_system.h"
+#include "w_file.h"
+#include "z_zone.h"
+
+#define NET_BLOCKSIZE	8192
+
+// Number of blocks read beyond the requested range.
+#define NET_READAHEAD	16
+
+typedef struct
+{
+    wad_file_t wad;
+    int fd;
+
+    // File can only be read sequentially, next block to stream.
+    boolean stream;
+    int stream_block;
+
+    byte **blocks;
+    unsigned long *valid;
+    int numblocks;
+} net_wad_file_t;
+
+extern wad_file_class_t net_wad_file;
+
+// From <fs.h>, whose FILE clashes with ours.
+#define FILE_SIZE_STREAM	((loff_t) -1)
+
+static void W_Net_Grow(net_wad_file_t *nw, int numblocks)
+{
+    int longs;
+
+    longs = BITS_TO_LONGS(numblocks);
+
+    nw->blocks = realloc(nw->blocks, numblocks * sizeof(*nw->blocks));
+    nw->valid = realloc(nw->valid, longs * sizeof(*nw->valid));
+
+    if (nw->blocks == NULL || nw->valid == NULL)
+    {
+        I_Error("Couldn't realloc network WAD cache");
+    }
+
+    memset(nw->blocks + nw->numblocks, 0,
+           (numblocks - nw->numblocks) * sizeof(*nw->blocks));
+    memset(nw->valid + BITS_TO_LONGS(nw->numblocks), 0,
+           (longs - BITS_TO_LONGS(nw->numblocks)) * sizeof(*nw->valid));
+
+    nw->numblocks = numblocks;
+}
+
+//
+// Read the next block from the current file position,
+// returns the number of bytes read or -1 on error.
+//
+
+static int W_Net_ReadBlock(net_wad_file_t *nw, int block)
+{
+    int len;
+
+    if (nw->blocks[block] == NULL)
+    {
+        nw->blocks[block] = malloc(NET_BLOCKSIZE);
+
+        if (nw->blocks[block] == NULL)
+        {
+            I_Error("Couldn't allocate network WAD cache");
+        }
+    }
+
+    len = read_full(nw->fd, nw->blocks[block], NET_BLOCKSIZE);
+
+    if (len < 0)
+    {
+        return -1;
+    }
+
+    set_bit(block, nw->valid);
+
+    return len;
+}
+
+//
+// TFTP: keep streaming until block last is cached.
+//
+
+static boolean W_Net_Stream(net_wad_file_t *nw, int last)
+{
+    int len;
+
+    while (nw->stream_block <= last)
+    {
+        len = W_Net_ReadBlock(nw, nw->stream_block);
+
+        if (len <= 0)
+        {
+            return false;
+        }
+
+        ++nw->stream_block;
+    }
+
+    return true;
+}
+
+//
+// NFS: read each missing range in blocks first..last, together
+// with the read-ahead window after it.
+//
+
+static boolean W_Net_Fetch(net_wad_file_t *nw, int first, int last)
+{
+    int block, end, limit;
+
+    block = find_next_zero_bit(nw->valid, last + 1, first);
+
+    while (block <= last)
+    {
+        limit = last + 1 + NET_READAHEAD;
+
+        if (limit > nw->numblocks)
+        {
+            limit = nw->numblocks;
+        }
+
+        end = find_next_bit(nw->valid, limit, block);
+
+        if (lseek(nw->fd, (loff_t) block * NET_BLOCKSIZE, SEEK_SET) < 0)
+        {
+            return false;
+        }
+
+        for (; block < end; ++block)
+        {
+            if (W_Net_ReadBlock(nw, block) <= 0)
+            {
+                return false;
+            }
+        }
+
+        block = find_next_zero_bit(nw->valid, last + 1, end);
+    }
+
+    return true;
+}
+
+static void W_Net_CloseFile(wad_file_t *wad);
+
+static wad_file_t *W_Net_OpenFile(char *path)
+{
+    net_wad_file_t *result;
+    struct stat s;
+    int fd, len;
+
+    if (!is_tftp_fs(path) && !is_nfs_fs(path))
+    {
+        return NULL;
+    }
+
+    fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    result = Z_Malloc(sizeof(net_wad_file_t), PU_STATIC, 0);
+    memset(result, 0, sizeof(net_wad_file_t));
+    result->wad.file_class = &net_wad_file;
+    result->wad.mapped = NULL;
+    result->fd = fd;
+    result->stream = is_tftp_fs(path);
+
+    if (fstat(fd, &s) < 0 || s.st_size == FILE_SIZE_STREAM)
+    {
+        // TFTP server didn't tell the size, fetch it all now.
+        // A WAD cut short by an error would only fail later.
+
+        result->stream = true;
+
+        do
+        {
+            W_Net_Grow(result, result->numblocks + 1);
+            len = W_Net_ReadBlock(result, result->numblocks - 1);
+
+            if (len < 0)
+            {
+                printf("%s: network WAD read failed\n", path);
+                W_Net_CloseFile(&result->wad);
+                return NULL;
+            }
+
+            result->wad.length += len;
+        } while (len == NET_BLOCKSIZE);
+
+        result->stream_block = result->numblocks;
+    }
+    else
+    {
+        result->wad.length = s.st_size;
+        W_Net_Grow(result, (s.st_size + NET_BLOCKSIZE - 1) / NET_BLOCKSIZE);
+    }
+
+    return &result->wad;
+}
+
+static void W_Net_CloseFile(wad_file_t *wad)
+{
+    net_wad_file_t *nw;
+    int i;
+
+    nw = (net_wad_file_t *) wad;
+
+    close(nw->fd);
+
+    for (i = 0; i < nw->numblocks; ++i)
+    {
+        free(nw->blocks[i]);
+    }
+
+    free(nw->blocks);
+    free(nw->valid);
+    Z_Free(nw);
+}
+
+// Read data from the specified position in the file into the
+// provided buffer.  Returns the number of bytes read.
+
+static size_t W_Net_Read(wad_file_t *wad, unsigned int offset,
+                   void *buffer, size_t buffer_len)
+{
+    net_wad_file_t *nw;
+    unsigned int pos, now;
+    int first, last;
+    boolean ok;
+    byte *dest;
+
+    nw = (net_wad_file_t *) wad;
+
+    if (offset >= wad->length)
+    {
+        return 0;
+    }
+
+    if (buffer_len > wad->length - offset)
+    {
+        buffer_len = wad->length - offset;
+    }
+
+    if (buffer_len == 0)
+    {
+        return 0;
+    }
+
+    first = offset / NET_BLOCKSIZE;
+    last = (offset + buffer_len - 1) / NET_BLOCKSIZE;
+
+    if (nw->stream)
+    {
+        ok = W_Net_Stream(nw, last);
+    }
+    else
+    {
+        ok = W_Net_Fetch(nw, first, last);
+    }
+
+    if (!ok)
+    {
+        printf("network WAD read failed at offset %u\n", offset);
+        return 0;
+    }
+
+    dest = buffer;
+
+    for (pos = offset; pos < offset + buffer_len; pos += now)
+    {
+        now = NET_BLOCKSIZE - pos % NET_BLOCKSIZE;
+
+        if (now > offset + buffer_len - pos)
+        {
+            now = offset + buffer_len - pos;
+        }
+
+        memcpy(dest, nw->blocks[pos / NET_BLOCKSIZE] + pos % NET_BLOCKSIZE,
+               now);
+        dest += now;
+    }
+
+    return buffer_len;
+}
+
+
+wad_file_class_t net_wad_file =
+{
+    W_Net_OpenFile,
+    W_Net_CloseFile,
+    W_Net_Read,
+};
+
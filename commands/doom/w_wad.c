@@ -22,6 +22,8 @@
 #include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
+#include <clock.h>
+#include <linux/math64.h>
 
 #include "doomtype.h"
 
@@ -60,9 +62,54 @@ typedef struct
 lumpinfo_t *lumpinfo;		
 unsigned int numlumps = 0;
 
-// Hash table for fast lookups
+// Hash table for fast lookups, open addressed with linear
+// probing. Slots hold the lump key, so a probe doesn't have
+// to touch lumpinfo[].
 
-static lumpinfo_t **lumphash;
+typedef struct
+{
+    uint64_t	key;
+    int		lump;
+} lumphash_t;
+
+static lumphash_t *lumphash;
+static unsigned int lumphashbits;
+
+// Lookup timing, enabled with -devparm. Each lookup is timed
+// against the lookup it replaced: strncasecmp along chains of
+// W_LumpNameHash() % numlumps, kept as lump indices next to
+// the new table while timing.
+
+static boolean lookup_stats;
+static int *lumpchainhead;
+static int *lumpchainnext;
+static uint64_t lookup_ns;
+static uint64_t lookup_scan_ns;
+static unsigned int lookup_count;
+
+// Fold a lump name into its key: up to 8 upper case
+// characters, zero padded, as a little endian integer.
+
+static uint64_t W_LumpNameKey(const char *s)
+{
+    uint64_t key = 0;
+    unsigned int i;
+
+    for (i=0; i < 8 && s[i] != '\0'; ++i)
+    {
+        key |= (uint64_t) (byte) toupper((int)s[i]) << (i * 8);
+    }
+
+    return key;
+}
+
+static unsigned int W_LumpKeyHash(uint64_t key)
+{
+    // Fibonacci hashing, the top bits of the product are
+    // well mixed for keys differing in any character.
+
+    return (key * 0x9e3779b97f4a7c15ULL) >> (64 - lumphashbits);
+}
 
 // Hash function used for lump names.
 
@@ -107,13 +154,6 @@ static void ExtendLumpInfo(int newnumlumps)
             Z_ChangeUser(newlumpinfo[i].cache, &newlumpinfo[i].cache);
         }
 
-        // We shouldn't be generating a hash table until after all WADs have
-        // been loaded, but just in case...
-        if (lumpinfo[i].next != NULL)
-        {
-            int nextlumpnum = lumpinfo[i].next - lumpinfo;
-            newlumpinfo[i].next = &newlumpinfo[nextlumpnum];
-        }
     }
 
     // All done.
@@ -159,7 +199,17 @@ wad_file_t *W_AddFile (char *filename)
 
     newnumlumps = numlumps;
 
-    if (strcasecmp(filename+strlen(filename)-3 , "wad" ) )
+    // A gzip compressed WAD is named foo.wad.gz; look at the extension
+    // in front of the .gz.
+
+    length = strlen(filename);
+
+    if (length >= 3 && !strcasecmp(filename + length - 3, ".gz"))
+    {
+        length -= 3;
+    }
+
+    if (length < 3 || strncasecmp(filename + length - 3, "wad", 3))
     {
     	// single lump file
 
@@ -219,6 +269,7 @@ wad_file_t *W_AddFile (char *filename)
 		lump_p->size = LONG(filerover->size);
 			lump_p->cache = NULL;
 		strncpy(lump_p->name, filerover->name, 8);
+		lump_p->key = W_LumpNameKey(lump_p->name);
 
 			++lump_p;
 			++filerover;
@@ -240,26 +291,33 @@ wad_file_t *W_AddFile (char *filename)
 // Returns -1 if name not found.
 //
 
-int W_CheckNumForName (char* name)
+static int W_LookupName(char *name)
 {
-    lumpinfo_t *lump_p;
+    uint64_t key;
+    int result;
     int i;
 
+    key = W_LumpNameKey(name);
+    result = -1;
+
     // Do we have a hash table yet?
 
     if (lumphash != NULL)
     {
-        int hash;
-        
+        unsigned int mask;
+        unsigned int hash;
+
         // We do! Excellent.
 
-        hash = W_LumpNameHash(name) % numlumps;
-        
-        for (lump_p = lumphash[hash]; lump_p != NULL; lump_p = lump_p->next)
+        mask = (1U << lumphashbits) - 1;
+
+        for (hash = W_LumpKeyHash(key); lumphash[hash].lump >= 0;
+             hash = (hash + 1) & mask)
         {
-            if (!strncasecmp(lump_p->name, name, 8))
+            if (lumphash[hash].key == key)
             {
-                return lump_p - lumpinfo;
+                result = lumphash[hash].lump;
+                break;
             }
         }
     } 
@@ -270,19 +328,103 @@ int W_CheckNumForName (char* name)
         // scan backwards so patch lump files take precedence
 
         for (i=numlumps-1; i >= 0; --i)
+        {
+            if (lumpinfo[i].key == key)
+            {
+                result = i;
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+// The lookup done before names were folded to keys, for comparison.
+
+static int W_ScanForName(char *name)
+{
+    int i;
+
+    if (lumpchainhead != NULL)
+    {
+        for (i = lumpchainhead[W_LumpNameHash(name) % numlumps]; i >= 0;
+             i = lumpchainnext[i])
         {
             if (!strncasecmp(lumpinfo[i].name, name, 8))
             {
                 return i;
             }
         }
+
+        return -1;
     }
 
-    // TFB. Not found.
+    for (i=numlumps-1; i >= 0; --i)
+    {
+        if (!strncasecmp(lumpinfo[i].name, name, 8))
+        {
+            return i;
+        }
+    }
 
     return -1;
 }
 
+int W_CheckNumForName (char* name)
+{
+    uint64_t start;
+    int result;
+
+    if (!lookup_stats)
+    {
+        return W_LookupName(name);
+    }
+
+    start = get_time_ns();
+    result = W_LookupName(name);
+    lookup_ns += get_time_ns() - start;
+
+    start = get_time_ns();
+    if (W_ScanForName(name) != result)
+    {
+        printf("W_CheckNumForName: %.8s differs from hash chain lookup\n",
+               name);
+    }
+    lookup_scan_ns += get_time_ns() - start;
+
+    ++lookup_count;
+
+    return result;
+}
+
+//
+// W_EnableLookupStats
+// Starts timing W_CheckNumForName.
+//
+
+void W_EnableLookupStats(void)
+{
+    lookup_stats = true;
+}
+
+//
+// W_PrintLookupStats
+// Reports the time spent looking up lump names so far.
+//
+
+void W_PrintLookupStats(void)
+{
+    if (!lookup_stats)
+    {
+        return;
+    }
+
+    printf("W_CheckNumForName: %u lookups, %u us, hash chains %u us\n",
+           lookup_count, (unsigned int) div_u64(lookup_ns, 1000),
+           (unsigned int) div_u64(lookup_scan_ns, 1000));
+}
+
 
 
 
@@ -337,6 +479,14 @@ void W_ReadLump(unsigned int lump, void *dest)
     }
 
     l = lumpinfo+lump;
+
+    // Already resident, e.g. from the level prefetcher.
+
+    if (l->cache != NULL && l->cache != dest)
+    {
+        memcpy(dest, l->cache, l->size);
+        return;
+    }
 	
     I_BeginRead ();
 	
@@ -398,11 +548,27 @@ void *W_CacheLumpNum(int lumpnum, int tag)
     }
     else
     {
-        // Not yet loaded, so load it now
+        // Not yet loaded, so load it now.  W_Read may yield to the
+        // level prefetcher: the buffer stays PU_STATIC and private
+        // until it is filled, so that allocations by the prefetcher
+        // can't purge it and it never sees a partially read lump.
 
-        lump->cache = Z_Malloc(W_LumpLength(lumpnum), tag, &lump->cache);
-	W_ReadLump (lumpnum, lump->cache);
-        result = lump->cache;
+        result = Z_Malloc(W_LumpLength(lumpnum), PU_STATIC, NULL);
+	W_ReadLump (lumpnum, result);
+
+        if (lump->cache != NULL)
+        {
+            // The prefetcher loaded it meanwhile.
+
+            Z_Free(result);
+            result = lump->cache;
+        }
+        else
+        {
+            Z_ChangeUser(result, &lump->cache);
+        }
+
+        Z_ChangeTag(result, tag);
     }
 	
     return result;
@@ -454,10 +620,60 @@ void W_ReleaseLumpName(char *name)
     W_ReleaseLumpNum(W_GetNumForName(name));
 }
 
+//
+// W_PrefetchLump
+//
+// Load a lump into the cache as PU_CACHE, unless it is resident
+// already.  This is called from the level prefetcher bthread: the
+// buffer is only published as lump->cache once it has been read
+// completely, so a W_CacheLumpNum in the game thread never sees a
+// partially filled lump.  Errors are not fatal, the lump is then
+// simply loaded on demand later.
+//
+
+void W_PrefetchLump(int lumpnum)
+{
+    lumpinfo_t *lump;
+    void *data;
+    size_t c;
+
+    if ((unsigned)lumpnum >= numlumps)
+    {
+        return;
+    }
+
+    lump = &lumpinfo[lumpnum];
+
+    if (lump->wad_file->mapped != NULL || lump->cache != NULL
+     || lump->size <= 0)
+    {
+        return;
+    }
+
+    data = Z_Malloc(lump->size, PU_STATIC, NULL);
+
+    c = W_Read(lump->wad_file, lump->position, data, lump->size);
+
+    if (c < lump->size || lump->cache != NULL)
+    {
+        // Short read, or the game thread loaded it meanwhile.
+
+        Z_Free(data);
+    }
+    else
+    {
+        Z_ChangeUser(data, &lump->cache);
+        Z_ChangeTag(data, PU_CACHE);
+    }
+}
+
 // Generate a hash table for fast lookups
 
 void W_GenerateHashTable(void)
 {
+    unsigned int size;
+    unsigned int mask;
+    unsigned int hash;
     unsigned int i;
 
     // Free the old hash table, if there is one
@@ -465,24 +681,68 @@ void W_GenerateHashTable(void)
     if (lumphash != NULL)
     {
         Z_Free(lumphash);
+        lumphash = NULL;
+    }
+
+    if (lumpchainhead != NULL)
+    {
+        Z_Free(lumpchainhead);
+        Z_Free(lumpchainnext);
+        lumpchainhead = NULL;
+        lumpchainnext = NULL;
     }
 
-    // Generate hash table
+    // Generate hash table, at most half full so that
+    // probe sequences stay short.
     if (numlumps > 0)
     {
-        lumphash = Z_Malloc(sizeof(lumpinfo_t *) * numlumps, PU_STATIC, NULL);
-        memset(lumphash, 0, sizeof(lumpinfo_t *) * numlumps);
+        for (lumphashbits = 1; (1U << lumphashbits) < numlumps * 2;
+             ++lumphashbits);
+
+        size = 1U << lumphashbits;
+        mask = size - 1;
+
+        lumphash = Z_Malloc(sizeof(lumphash_t) * size, PU_STATIC, NULL);
+
+        for (i=0; i<size; ++i)
+        {
+            lumphash[i].lump = -1;
+        }
+
+        // Later lumps replace earlier ones with the same
+        // name, so that PWADs override the IWAD.
 
         for (i=0; i<numlumps; ++i)
         {
-            unsigned int hash;
+            for (hash = W_LumpKeyHash(lumpinfo[i].key);
+                 lumphash[hash].lump >= 0
+                  && lumphash[hash].key != lumpinfo[i].key;
+                 hash = (hash + 1) & mask);
 
-            hash = W_LumpNameHash(lumpinfo[i].name) % numlumps;
+            lumphash[hash].key = lumpinfo[i].key;
+            lumphash[hash].lump = i;
+        }
 
-            // Hook into the hash table
+        // The chained table the lookup times are compared to.
+        // Later lumps are pushed in front, as before.
 
-            lumpinfo[i].next = lumphash[hash];
-            lumphash[hash] = &lumpinfo[i];
+        if (lookup_stats)
+        {
+            lumpchainhead = Z_Malloc(sizeof(int) * numlumps, PU_STATIC, NULL);
+            lumpchainnext = Z_Malloc(sizeof(int) * numlumps, PU_STATIC, NULL);
+
+            for (i=0; i<numlumps; ++i)
+            {
+                lumpchainhead[i] = -1;
+            }
+
+            for (i=0; i<numlumps; ++i)
+            {
+                hash = W_LumpNameHash(lumpinfo[i].name) % numlumps;
+
+                lumpchainnext[i] = lumpchainhead[hash];
+                lumpchainhead[hash] = i;
+            }
         }
     }
 
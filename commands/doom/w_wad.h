@@ -46,9 +46,10 @@ struct lumpinfo_s
     int		size;
     void       *cache;
 
-    // Used for hash table lookups
+    // Upper case name as a little endian integer,
+    // for lookups with a single compare.
 
-    lumpinfo_t *next;
+    uint64_t	key;
 };
 
 
@@ -69,10 +70,14 @@ void*	W_CacheLumpName (char* name, int tag);
 void    W_GenerateHashTable(void);
 
 extern unsigned int W_LumpNameHash(const char *s);
+void    W_EnableLookupStats(void);
+void    W_PrintLookupStats(void);
 
 void    W_ReleaseLumpNum(int lump);
 void    W_ReleaseLumpName(char *name);
 
+void    W_PrefetchLump(int lump);
+
 void W_CheckCorrectIWAD(GameMission_t mission);
 
 #endif
@@ -30,6 +30,8 @@
 
 #include "g_game.h"
 
+#include "p_prefetch.h"
+
 #include "r_local.h"
 #include "s_sound.h"
 
@@ -1807,6 +1809,9 @@ static void WI_initVariables(wbstartstruct_t* wbstartstruct)
 
 void WI_Start(wbstartstruct_t* wbstartstruct)
 {
+    // Load the next level while the stats are counting.
+    P_PrefetchLevel(wbstartstruct->epsd + 1, wbstartstruct->next + 1);
+
     WI_initVariables(wbstartstruct);
     WI_loadData();
 
@@ -222,6 +222,39 @@ static void fbtest_pattern_gradient(struct screen *sc, u32 unused)
 		    0xff, 0xff, 0xff);
 }
 
+static int fbtest_bench(struct screen *sc)
+{
+	int immediate, deferred;
+
+	if (!IS_ENABLED(CONFIG_FRAMEBUFFER_CONSOLE)) {
+		printf("framebuffer console support is disabled\n");
+		goto err;
+	}
+
+	immediate = fbconsole_bench(sc->info, true);
+	if (immediate < 0) {
+		printf("fbconsole: %pe\n", ERR_PTR(immediate));
+		goto err;
+	}
+
+	deferred = fbconsole_bench(sc->info, false);
+	if (deferred < 0) {
+		printf("fbconsole: %pe\n", ERR_PTR(deferred));
+		goto err;
+	}
+
+	printf("fbconsole: %d lines/s with an update per line\n", immediate);
+	printf("fbconsole: %d lines/s with delayed updates\n", deferred);
+
+	fb_close(sc);
+
+	return 0;
+err:
+	fb_close(sc);
+
+	return COMMAND_ERROR;
+}
+
 static int do_fbtest(int argc, char *argv[])
 {
 	struct screen *sc;
@@ -231,6 +264,7 @@ static int do_fbtest(int argc, char *argv[])
 	char *fbdev = "/dev/fb0";
 	void (*pattern) (struct screen *sc, u32 color) = NULL;
 	u32 color = 0xffffff;
+	bool bench = false;
 
 	struct {
 		const char *name;
@@ -242,8 +276,11 @@ static int do_fbtest(int argc, char *argv[])
 		{ "gradient", fbtest_pattern_gradient },
 	};
 
-	while((opt = getopt(argc, argv, "d:p:c:")) > 0) {
+	while((opt = getopt(argc, argv, "bd:p:c:")) > 0) {
 		switch(opt) {
+		case 'b':
+			bench = true;
+			break;
 		case 'd':
 			fbdev = optarg;
 			break;
@@ -275,6 +312,9 @@ static int do_fbtest(int argc, char *argv[])
 		return COMMAND_ERROR;
 	}
 
+	if (bench)
+		return fbtest_bench(sc);
+
 	if (!pattern_name) {
 		printf("No pattern selected. Cycling through all of them.\n");
 		printf("Press Ctrl-C to stop\n");
@@ -309,12 +349,13 @@ BAREBOX_CMD_HELP_TEXT("Options:")
 BAREBOX_CMD_HELP_OPT ("-d <fbdev>\t",    "framebuffer device (default /dev/fb0)")
 BAREBOX_CMD_HELP_OPT ("-c color\t", "color, in hex RRGGBB format")
 BAREBOX_CMD_HELP_OPT ("-p pattern\t", "pattern name (solid, geometry, bars, gradient)")
+BAREBOX_CMD_HELP_OPT ("-b\t", "measure the lines per second the framebuffer console prints")
 BAREBOX_CMD_HELP_END
 
 BAREBOX_CMD_START(fbtest)
 	.cmd		= do_fbtest,
 	BAREBOX_CMD_DESC("display a test pattern")
-	BAREBOX_CMD_OPTS("[-dcp]")
+	BAREBOX_CMD_OPTS("[-bdcp]")
 	BAREBOX_CMD_GROUP(CMD_GRP_CONSOLE)
 	BAREBOX_CMD_HELP(cmd_fbtest_help)
 BAREBOX_CMD_END
@@ -9,6 +9,8 @@
 #include <malloc.h>
 #include <linux/err.h>
 #include <linux/list.h>
+#include <linux/hash.h>
+#include <linux/math64.h>
 #include <dma.h>
 
 #define BLOCKSIZE(blk)	(1 << blk->blockbits)
@@ -22,15 +24,46 @@ struct chunk {
 	int dirty; /* need to write back to device */
 	int num; /* number of chunk, debugging only */
 	struct list_head list;
+	struct hlist_node hash; /* in chunk_hash while buffered */
 };
 
 #define BUFSIZE (PAGE_SIZE * 16)
+#define NUM_CHUNKS 8
+
+/*
+ * most chunks read ahead at once. Read-ahead has this many buffers of its
+ * own after the NUM_CHUNKS ones, so a stream can't evict chunks used for
+ * random I/O like the FAT or directories.
+ */
+#define RA_MAX_CHUNKS (NUM_CHUNKS / 2)
+
+static bool chunk_is_ra(struct chunk *chunk)
+{
+	return chunk->num >= NUM_CHUNKS;
+}
 
 static int writebuffer_io_len(struct block_device *blk, struct chunk *chunk)
 {
 	return min_t(blkcnt_t, blk->rdbufsize, blk->num_blocks - chunk->block_start);
 }
 
+static int chunk_writeback(struct block_device *blk, struct chunk *chunk)
+{
+	int ret;
+
+	if (!chunk->dirty)
+		return 0;
+
+	ret = blk->ops->write(blk, chunk->data, chunk->block_start,
+			      writebuffer_io_len(blk, chunk));
+	if (ret < 0)
+		return ret;
+
+	chunk->dirty = 0;
+
+	return 0;
+}
+
 /*
  * Write all dirty chunks back to the device
  */
@@ -43,15 +76,9 @@ static int writebuffer_flush(struct block_device *blk)
 		return 0;
 
 	list_for_each_entry(chunk, &blk->buffered_blocks, list) {
-		if (chunk->dirty) {
-			ret = blk->ops->write(blk, chunk->data,
-					      chunk->block_start,
-					      writebuffer_io_len(blk, chunk));
-			if (ret < 0)
-				return ret;
-
-			chunk->dirty = 0;
-		}
+		ret = chunk_writeback(blk, chunk);
+		if (ret < 0)
+			return ret;
 	}
 
 	if (blk->ops->flush)
@@ -60,6 +87,49 @@ static int writebuffer_flush(struct block_device *blk)
 	return 0;
 }
 
+/*
+ * Whether the chunk starting at @start lies in the discarded range and
+ * doesn't need to be read.
+ */
+static bool block_discarded(struct block_device *blk, sector_t start)
+{
+	blkcnt_t len = min_t(blkcnt_t, blk->rdbufsize, blk->num_blocks - start);
+
+	return start * BLOCKSIZE(blk) >= blk->discard_start &&
+	       start * BLOCKSIZE(blk) + len <=
+	       blk->discard_start + blk->discard_size;
+}
+
+/*
+ * Chunks are aligned to rdbufsize, so the chunk a block belongs to is
+ * found by hashing its aligned start.
+ */
+static struct hlist_head *chunk_hash_head(struct block_device *blk,
+					  sector_t block)
+{
+	sector_t start = block & ~(sector_t)blk->blkmask;
+
+	return &blk->chunk_hash[hash_64(start, BLOCK_CHUNK_HASH_BITS)];
+}
+
+static void chunk_buffer(struct block_device *blk, struct chunk *chunk)
+{
+	list_add(&chunk->list, &blk->buffered_blocks);
+	hlist_add_head(&chunk->hash, chunk_hash_head(blk, chunk->block_start));
+}
+
+static struct chunk *chunk_lookup(struct block_device *blk, sector_t block)
+{
+	struct chunk *chunk;
+	sector_t start = block & ~(sector_t)blk->blkmask;
+
+	hlist_for_each_entry(chunk, chunk_hash_head(blk, block), hash)
+		if (chunk->block_start == start)
+			return chunk;
+
+	return NULL;
+}
+
 /*
  * get the chunk containing a given block. Will return NULL if the
  * block is not cached, the chunk otherwise.
@@ -68,20 +138,18 @@ static struct chunk *chunk_get_cached(struct block_device *blk, sector_t block)
 {
 	struct chunk *chunk;
 
-	list_for_each_entry(chunk, &blk->buffered_blocks, list) {
-		if (block >= chunk->block_start &&
-				block < chunk->block_start + blk->rdbufsize) {
-			dev_dbg(blk->dev, "%s: found %llu in %d\n", __func__,
-				block, chunk->num);
-			/*
-			 * move most recently used entry to the head of the list
-			 */
-			list_move(&chunk->list, &blk->buffered_blocks);
-			return chunk;
-		}
-	}
+	chunk = chunk_lookup(blk, block);
+	if (!chunk)
+		return NULL;
 
-	return NULL;
+	dev_dbg(blk->dev, "%s: found %llu in %d\n", __func__, block, chunk->num);
+
+	/*
+	 * move most recently used entry to the head of the list
+	 */
+	list_move(&chunk->list, &blk->buffered_blocks);
+
+	return chunk;
 }
 
 /*
@@ -102,7 +170,7 @@ static void *block_get_cached(struct block_device *blk, sector_t block)
 /*
  * Get a data chunk, either from the idle list or if the idle list
  * is empty, the least recently used is written back to disk and
- * returned.
+ * returned. Read-ahead buffers are left to block_cache_ahead().
  */
 static struct chunk *get_chunk(struct block_device *blk)
 {
@@ -111,16 +179,15 @@ static struct chunk *get_chunk(struct block_device *blk)
 
 	if (list_empty(&blk->idle_blocks)) {
 		/* use last entry which is the most unused */
-		chunk = list_last_entry(&blk->buffered_blocks, struct chunk, list);
-		if (chunk->dirty) {
-			ret = blk->ops->write(blk, chunk->data,
-					      chunk->block_start,
-					      writebuffer_io_len(blk, chunk));
-			if (ret < 0)
-				return ERR_PTR(ret);
-
-			chunk->dirty = 0;
-		}
+		list_for_each_entry_reverse(chunk, &blk->buffered_blocks, list)
+			if (!chunk_is_ra(chunk))
+				break;
+
+		ret = chunk_writeback(blk, chunk);
+		if (ret < 0)
+			return ERR_PTR(ret);
+
+		hlist_del_init(&chunk->hash);
 	} else {
 		chunk = list_first_entry(&blk->idle_blocks, struct chunk, list);
 	}
@@ -131,11 +198,70 @@ static struct chunk *get_chunk(struct block_device *blk)
 }
 
 /*
- * read a block into the cache. This assumes that the block is
- * not cached already. By definition block_get_cached() for
- * the same block will succeed after this call.
+ * Read the chunk starting at @start and up to @num - 1 following ones
+ * with a single request. The read-ahead buffers are allocated in one
+ * piece, so a run of adjacent ones is taken over for this, stream reads
+ * go round them. Read-ahead stops before the first chunk that is cached
+ * already. Returns the number of chunks read.
  */
-static int block_cache(struct block_device *blk, sector_t block)
+static int block_cache_ahead(struct block_device *blk, sector_t start, int num)
+{
+	struct chunk *chunk;
+	blkcnt_t len;
+	int i, slot, ret;
+
+	for (i = 1; i < num; i++) {
+		sector_t next = start + (sector_t)i * blk->rdbufsize;
+
+		if (next >= blk->num_blocks || chunk_lookup(blk, next))
+			break;
+	}
+	num = min_t(blkcnt_t, i, div_u64(blk->max_transfer_blocks, blk->rdbufsize));
+
+	slot = NUM_CHUNKS + blk->ra_slot;
+	if (slot + num > NUM_CHUNKS + RA_MAX_CHUNKS)
+		slot = NUM_CHUNKS;
+
+	for (i = slot; i < slot + num; i++) {
+		ret = chunk_writeback(blk, &blk->chunks[i]);
+		if (ret < 0)
+			return ret;
+	}
+
+	for (i = slot; i < slot + num; i++) {
+		chunk = &blk->chunks[i];
+		list_del_init(&chunk->list);
+		hlist_del_init(&chunk->hash);
+	}
+
+	dev_dbg(blk->dev, "%s: %llu, %d chunks to %d\n", __func__, start, num,
+		slot);
+
+	len = min_t(blkcnt_t, (blkcnt_t)num * blk->rdbufsize,
+		    blk->num_blocks - start);
+
+	ret = blk->ops->read(blk, blk->chunks[slot].data, start, len);
+
+	if (ret)
+		return ret;
+
+	/* add the first chunk last, it is the most recently used */
+	for (i = slot + num - 1; i >= slot; i--) {
+		chunk = &blk->chunks[i];
+		chunk->block_start = start + (sector_t)(i - slot) * blk->rdbufsize;
+		chunk_buffer(blk, chunk);
+	}
+
+	blk->ra_slot = (slot - NUM_CHUNKS + num) % RA_MAX_CHUNKS;
+	blk->stats.readahead += num - 1;
+
+	return num;
+}
+
+/*
+ * Read the chunk starting at @start into a chunk buffer of its own.
+ */
+static int block_cache_chunk(struct block_device *blk, sector_t start)
 {
 	struct chunk *chunk;
 	int ret;
@@ -144,16 +270,14 @@ static int block_cache(struct block_device *blk, sector_t block)
 	if (IS_ERR(chunk))
 		return PTR_ERR(chunk);
 
-	chunk->block_start = block & ~blk->blkmask;
+	chunk->block_start = start;
 
 	dev_dbg(blk->dev, "%s: %llu to %d\n", __func__, chunk->block_start,
 		chunk->num);
 
-	if (chunk->block_start * BLOCKSIZE(blk) >= blk->discard_start &&
-	    chunk->block_start * BLOCKSIZE(blk) + writebuffer_io_len(blk, chunk)
-	    <= blk->discard_start + blk->discard_size) {
+	if (block_discarded(blk, start)) {
 		memset(chunk->data, 0, writebuffer_io_len(blk, chunk));
-		list_add(&chunk->list, &blk->buffered_blocks);
+		chunk_buffer(blk, chunk);
 		return 0;
 	}
 
@@ -163,7 +287,45 @@ static int block_cache(struct block_device *blk, sector_t block)
 		list_add_tail(&chunk->list, &blk->idle_blocks);
 		return ret;
 	}
-	list_add(&chunk->list, &blk->buffered_blocks);
+	chunk_buffer(blk, chunk);
+
+	return 0;
+}
+
+/*
+ * read a block into the cache. This assumes that the block is
+ * not cached already. By definition block_get_cached() for
+ * the same block will succeed after this call.
+ *
+ * A miss on the chunk following the previous stream read continues the
+ * stream, the read-ahead window then doubles up to RA_MAX_CHUNKS. Two
+ * misses on adjacent chunks start a new stream. Other misses, e.g. on
+ * the FAT between reads of a file, leave the stream alone.
+ */
+static int block_cache(struct block_device *blk, sector_t block)
+{
+	sector_t start = block & ~(sector_t)blk->blkmask;
+	int ret;
+
+	if (start == blk->ra_next) {
+		blk->ra_window = min(blk->ra_window * 2, RA_MAX_CHUNKS);
+	} else if (start == blk->ra_miss + blk->rdbufsize) {
+		blk->ra_window = 2;
+	} else {
+		blk->ra_miss = start;
+		return block_cache_chunk(blk, start);
+	}
+
+	if (block_discarded(blk, start)) {
+		blk->ra_next = start + blk->rdbufsize;
+		return block_cache_chunk(blk, start);
+	}
+
+	ret = block_cache_ahead(blk, start, blk->ra_window);
+	if (ret < 0)
+		return ret;
+
+	blk->ra_next = start + (sector_t)ret * blk->rdbufsize;
 
 	return 0;
 }
@@ -181,13 +343,17 @@ static void *block_get(struct block_device *blk, sector_t block)
 		return ERR_PTR(-ENXIO);
 
 	outdata = block_get_cached(blk, block);
-	if (outdata)
+	if (outdata) {
+		blk->stats.hits++;
 		return outdata;
+	}
 
 	ret = block_cache(blk, block);
 	if (ret)
 		return ERR_PTR(ret);
 
+	blk->stats.misses++;
+
 	outdata = block_get_cached(blk, block);
 	if (!outdata)
 		BUG();
@@ -195,6 +361,79 @@ static void *block_get(struct block_device *blk, sector_t block)
 	return outdata;
 }
 
+/*
+ * Read whole blocks straight into the caller's buffer. Dirty chunks hold
+ * data newer than the device, those parts are copied over what was read.
+ */
+static int block_read_direct_one(struct block_device *blk, void *buf,
+				 sector_t block, blkcnt_t num_blocks)
+{
+	struct chunk *chunk;
+	sector_t end = block + num_blocks;
+	int ret;
+
+	ret = blk->ops->read(blk, buf, block, num_blocks);
+	if (ret)
+		return ret;
+
+	list_for_each_entry(chunk, &blk->buffered_blocks, list) {
+		sector_t start = max(block, chunk->block_start);
+		sector_t stop = min(end, chunk->block_start +
+				    writebuffer_io_len(blk, chunk));
+
+		if (!chunk->dirty || start >= stop)
+			continue;
+
+		memcpy(buf + ((start - block) << blk->blockbits),
+		       chunk->data + ((start - chunk->block_start) << blk->blockbits),
+		       (stop - start) << blk->blockbits);
+	}
+
+	blk->stats.bypass_reads++;
+	blk->stats.bypass_blocks += num_blocks;
+
+	return 0;
+}
+
+/*
+ * Drivers may not cope with arbitrarily large requests, e.g. a 16 bit
+ * block count register, so split the read up in max_transfer_blocks.
+ */
+static int block_read_direct(struct block_device *blk, void *buf,
+			     sector_t block, blkcnt_t num_blocks)
+{
+	blkcnt_t now;
+	int ret;
+
+	if (block + num_blocks > blk->num_blocks)
+		return -ENXIO;
+
+	while (num_blocks) {
+		now = min(num_blocks, blk->max_transfer_blocks);
+
+		ret = block_read_direct_one(blk, buf, block, now);
+		if (ret)
+			return ret;
+
+		buf += now << blk->blockbits;
+		block += now;
+		num_blocks -= now;
+	}
+
+	return 0;
+}
+
+/*
+ * Reads of at least a chunk are not worth caching. They bypass the cache
+ * when the buffer is aligned for the driver to DMA into it.
+ */
+static bool block_want_direct(struct block_device *blk, const void *buf,
+			      blkcnt_t num_blocks)
+{
+	return num_blocks >= blk->rdbufsize &&
+	       IS_ALIGNED((unsigned long)buf, DMA_ALIGNMENT);
+}
+
 static ssize_t block_op_read(struct cdev *cdev, void *buf, size_t count,
 		loff_t offset, unsigned long flags)
 {
@@ -221,6 +460,18 @@ static ssize_t block_op_read(struct cdev *cdev, void *buf, size_t count,
 
 	blocks = count >> blk->blockbits;
 
+	if (block_want_direct(blk, buf, blocks)) {
+		int ret = block_read_direct(blk, buf, block, blocks);
+
+		if (ret)
+			return ret;
+
+		buf += blocks << blk->blockbits;
+		count -= blocks << blk->blockbits;
+		block += blocks;
+		blocks = 0;
+	}
+
 	while (blocks) {
 		void *iobuf = block_get(blk, block);
 
@@ -364,6 +615,7 @@ static struct cdev_operations block_ops = {
 int blockdevice_register(struct block_device *blk)
 {
 	loff_t size = (loff_t)blk->num_blocks * BLOCKSIZE(blk);
+	void *data;
 	int ret;
 	int i;
 
@@ -375,18 +627,36 @@ int blockdevice_register(struct block_device *blk)
 
 	INIT_LIST_HEAD(&blk->buffered_blocks);
 	INIT_LIST_HEAD(&blk->idle_blocks);
+	for (i = 0; i < ARRAY_SIZE(blk->chunk_hash); i++)
+		INIT_HLIST_HEAD(&blk->chunk_hash[i]);
 	blk->blkmask = blk->rdbufsize - 1;
 
+	if (!blk->max_transfer_blocks)
+		blk->max_transfer_blocks = (blkcnt_t)blk->rdbufsize * NUM_CHUNKS;
+	blk->max_transfer_blocks = max_t(blkcnt_t, blk->max_transfer_blocks,
+					 blk->rdbufsize);
+
 	dev_dbg(blk->dev, "rdbufsize: %d blockbits: %d blkmask: 0x%08x\n",
 		blk->rdbufsize, blk->blockbits, blk->blkmask);
 
-	for (i = 0; i < 8; i++) {
-		struct chunk *chunk = xzalloc(sizeof(*chunk));
-		chunk->data = dma_alloc(BUFSIZE);
+	/* one allocation, so that adjacent chunks can be read at once */
+	blk->chunks = xzalloc((NUM_CHUNKS + RA_MAX_CHUNKS) * sizeof(*blk->chunks));
+	data = dma_alloc((NUM_CHUNKS + RA_MAX_CHUNKS) * BUFSIZE);
+
+	for (i = 0; i < NUM_CHUNKS + RA_MAX_CHUNKS; i++) {
+		struct chunk *chunk = &blk->chunks[i];
+		chunk->data = data + i * BUFSIZE;
 		chunk->num = i;
-		list_add_tail(&chunk->list, &blk->idle_blocks);
+		if (chunk_is_ra(chunk))
+			INIT_LIST_HEAD(&chunk->list);
+		else
+			list_add_tail(&chunk->list, &blk->idle_blocks);
 	}
 
+	blk->ra_next = -1;
+	blk->ra_miss = -1;
+	blk->ra_window = 1;
+
 	ret = devfs_create(&blk->cdev);
 	if (ret)
 		return ret;
@@ -400,19 +670,10 @@ int blockdevice_register(struct block_device *blk)
 
 int blockdevice_unregister(struct block_device *blk)
 {
-	struct chunk *chunk, *tmp;
-
 	writebuffer_flush(blk);
 
-	list_for_each_entry_safe(chunk, tmp, &blk->buffered_blocks, list) {
-		dma_free(chunk->data);
-		free(chunk);
-	}
-
-	list_for_each_entry_safe(chunk, tmp, &blk->idle_blocks, list) {
-		dma_free(chunk->data);
-		free(chunk);
-	}
+	dma_free(blk->chunks[0].data);
+	free(blk->chunks);
 
 	devfs_remove(&blk->cdev);
 	list_del(&blk->list);
@@ -420,6 +681,26 @@ int blockdevice_unregister(struct block_device *blk)
 	return 0;
 }
 
+/*
+ * Print the cache statistics of the block devices of a device
+ */
+void blockdevice_info(struct device_d *dev)
+{
+	struct block_device *blk;
+
+	for_each_block_device(blk) {
+		if (blk->dev != dev)
+			continue;
+
+		printf("Block cache %s:\n", blk->cdev.name);
+		printf("  hits: %llu blocks, misses: %llu chunks\n",
+		       blk->stats.hits, blk->stats.misses);
+		printf("  bypassed: %llu reads, %llu blocks\n",
+		       blk->stats.bypass_reads, blk->stats.bypass_blocks);
+		printf("  read ahead: %llu chunks\n", blk->stats.readahead);
+	}
+}
+
 int block_read(struct block_device *blk, void *buf, sector_t block, blkcnt_t num_blocks)
 {
 	int ret;
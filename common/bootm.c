@@ -13,6 +13,8 @@
 #include <linux/stat.h>
 #include <magicvar.h>
 #include <uncompress.h>
+#include <clock.h>
+#include <linux/math64.h>
 
 static LIST_HEAD(handler_list);
 
@@ -85,6 +87,98 @@ static int uimage_part_num(const char *partname)
 	return simple_strtoul(partname, NULL, 0);
 }
 
+#ifdef CONFIG_BOOTM_VERBOSE
+static const char * const bootm_phase_names[] = {
+	[BOOTM_PHASE_READ] = "read",
+	[BOOTM_PHASE_DECOMPRESS] = "decompress",
+	[BOOTM_PHASE_VERIFY] = "verify",
+	[BOOTM_PHASE_FIXUP] = "fixup",
+};
+
+static u64 bootm_phase_ns[BOOTM_PHASE_NUM];
+static u64 bootm_phase_begin;
+static int bootm_phase_depth;
+static bool bootm_phase_active;
+
+/*
+ * bootm_phase_start() - get a start time for bootm_phase_end()
+ *
+ * Return: the current time, 0 when no verbose bootm is running
+ */
+u64 bootm_phase_start(void)
+{
+	if (!bootm_phase_active)
+		return 0;
+
+	return get_time_ns();
+}
+
+void bootm_phase_add(enum bootm_phase phase, u64 ns)
+{
+	if (bootm_phase_active)
+		bootm_phase_ns[phase] += ns;
+}
+
+void bootm_phase_end(enum bootm_phase phase, u64 start)
+{
+	if (start)
+		bootm_phase_add(phase, get_time_ns() - start);
+}
+
+/*
+ * bootm_boot() is entered again for compressed images, the times are
+ * accounted from the outermost call.
+ */
+static void bootm_phases_enter(struct image_data *data)
+{
+	if (bootm_phase_depth++)
+		return;
+
+	memset(bootm_phase_ns, 0, sizeof(bootm_phase_ns));
+	bootm_phase_begin = get_time_ns();
+	bootm_phase_active = bootm_verbose(data);
+}
+
+static void bootm_phases_print(void)
+{
+	u64 total, other;
+	int i;
+
+	if (!bootm_phase_active)
+		return;
+
+	bootm_phase_active = false;
+
+	total = get_time_ns() - bootm_phase_begin;
+	other = total;
+
+	printf("Time spent loading:\n");
+	for (i = 0; i < BOOTM_PHASE_NUM; i++) {
+		printf("  %-12s %6llu ms\n", bootm_phase_names[i],
+		       div_u64(bootm_phase_ns[i], MSECOND));
+		other -= min(other, bootm_phase_ns[i]);
+	}
+	printf("  %-12s %6llu ms\n", "other", div_u64(other, MSECOND));
+	printf("  %-12s %6llu ms\n", "total", div_u64(total, MSECOND));
+}
+/* Handlers starting the OS don't return, print the times on the way out */
+early_exitcall(bootm_phases_print);
+
+static void bootm_phases_leave(void)
+{
+	if (!--bootm_phase_depth)
+		bootm_phases_print();
+}
+#else
+static inline void bootm_phases_enter(struct image_data *data)
+{
+}
+
+static inline void bootm_phases_leave(void)
+{
+}
+#endif
+
 /*
  * bootm_load_os() - load OS to RAM
  *
@@ -99,6 +193,9 @@ static int uimage_part_num(const char *partname)
  */
 int bootm_load_os(struct image_data *data, unsigned long load_address)
 {
+	u64 start;
+	int ret;
+
 	if (data->os_res)
 		return 0;
 
@@ -118,7 +215,9 @@ int bootm_load_os(struct image_data *data, unsigned long load_address)
 				(unsigned long long)load_address + kernel_size - 1);
 			return -ENOMEM;
 		}
+		start = bootm_phase_start();
 		memcpy((void *)load_address, kernel, kernel_size);
+		bootm_phase_end(BOOTM_PHASE_READ, start);
 		return 0;
 	}
 
@@ -135,8 +234,12 @@ int bootm_load_os(struct image_data *data, unsigned long load_address)
 		return 0;
 	}
 
-	if (IS_ENABLED(CONFIG_ELF) && data->elf)
-		return elf_load(data->elf);
+	if (IS_ENABLED(CONFIG_ELF) && data->elf) {
+		start = bootm_phase_start();
+		ret = elf_load(data->elf);
+		bootm_phase_end(BOOTM_PHASE_READ, start);
+		return ret;
+	}
 
 	if (data->os_file) {
 		data->os_res = file_to_sdram(data->os_file, load_address);
@@ -205,6 +308,7 @@ static int bootm_open_initrd_uimage(struct image_data *data)
 int bootm_load_initrd(struct image_data *data, unsigned long load_address)
 {
 	enum filetype type;
+	u64 start;
 	int ret;
 
 	if (!IS_ENABLED(CONFIG_BOOTM_INITRD))
@@ -238,7 +342,9 @@ int bootm_load_initrd(struct image_data *data, unsigned long load_address)
 				(unsigned long long)load_address + initrd_size - 1);
 			return -ENOMEM;
 		}
+		start = bootm_phase_start();
 		memcpy((void *)load_address, initrd, initrd_size);
+		bootm_phase_end(BOOTM_PHASE_READ, start);
 		pr_info("Loaded initrd from FIT image\n");
 		goto done1;
 	}
@@ -346,6 +452,7 @@ void *bootm_get_devicetree(struct image_data *data)
 {
 	enum filetype type;
 	struct fdt_header *oftree;
+	u64 start;
 	int ret;
 
 	if (!IS_ENABLED(CONFIG_OFTREE))
@@ -361,7 +468,9 @@ void *bootm_get_devicetree(struct image_data *data)
 		if (ret)
 			return ERR_PTR(ret);
 
+		start = bootm_phase_start();
 		data->of_root_node = of_unflatten_dtb(of_tree, of_size);
+		bootm_phase_end(BOOTM_PHASE_FIXUP, start);
 	} else if (data->oftree_file) {
 		size_t size;
 
@@ -379,8 +488,10 @@ void *bootm_get_devicetree(struct image_data *data)
 			break;
 		case filetype_oftree:
 			pr_info("Loading devicetree from '%s'\n", data->oftree_file);
+			start = bootm_phase_start();
 			ret = read_file_2(data->oftree_file, &size, (void *)&oftree,
 					  FILESIZE_MAX);
+			bootm_phase_end(BOOTM_PHASE_READ, start);
 			break;
 		default:
 			return ERR_PTR(-EINVAL);
@@ -389,7 +500,9 @@ void *bootm_get_devicetree(struct image_data *data)
 		if (ret)
 			return ERR_PTR(ret);
 
+		start = bootm_phase_start();
 		data->of_root_node = of_unflatten_dtb(oftree, size);
+		bootm_phase_end(BOOTM_PHASE_FIXUP, start);
 
 		free(oftree);
 
@@ -408,6 +521,8 @@ void *bootm_get_devicetree(struct image_data *data)
 			printf("using internal devicetree\n");
 	}
 
+	start = bootm_phase_start();
+
 	if (data->initrd_res) {
 		of_add_initrd(data->of_root_node, data->initrd_res->start,
 				data->initrd_res->end);
@@ -420,6 +535,8 @@ void *bootm_get_devicetree(struct image_data *data)
 
 	fdt_add_reserve_map(oftree);
 
+	bootm_phase_end(BOOTM_PHASE_FIXUP, start);
+
 	return oftree;
 }
 
@@ -598,6 +715,8 @@ int bootm_boot(struct bootm_data *bootm_data)
 	data->os_address = bootm_data->os_address;
 	data->os_entry = bootm_data->os_entry;
 
+	bootm_phases_enter(data);
+
 	ret = read_file_2(data->os_file, &size, &data->os_header, PAGE_SIZE);
 	if (ret < 0 && ret != -EFBIG) {
 		pr_err("could not open %s: %s\n", data->os_file,
@@ -806,6 +925,8 @@ err_out:
 	free(data->tee_file);
 	free(data);
 
+	bootm_phases_leave();
+
 	return ret;
 }
 
@@ -12,8 +12,10 @@
 
 #include <common.h>
 #include <bthread.h>
+#include <clock.h>
 #include <asm/setjmp.h>
 #include <linux/overflow.h>
+#include <linux/math64.h>
 
 #if defined CONFIG_ASAN && !defined CONFIG_32BIT
 #define HAVE_FIBER_SANITIZER
@@ -26,6 +28,9 @@ static struct bthread {
 	jmp_buf jmp_buf;
 	void *stack;
 	u32 stack_size;
+	u64 slice_ns;		/* time budget, 0 for none */
+	u64 scheduled_ns;	/* when the thread was last switched to */
+	u64 longest_ns;		/* longest time it ran without yielding */
 	struct list_head list;
 #ifdef HAVE_FIBER_SANITIZER
 	void *fake_stack_save;
@@ -42,21 +47,46 @@ static struct bthread {
 
 struct bthread *current = &main_thread;
 
+/* end of the current thread's time slice, 0 if it has no budget */
+u64 bthread_slice_end;
+
 /*
  * When using ASAN, it needs to be told when we switch stacks.
  */
 static void start_switch_fiber(struct bthread *, bool terminate_old);
 static void finish_switch_fiber(struct bthread *);
 
+static void bthread_switched_to(struct bthread *bthread)
+{
+	bthread->scheduled_ns = get_time_ns();
+	bthread_slice_end = bthread->slice_ns ?
+		bthread->scheduled_ns + bthread->slice_ns : 0;
+}
+
+static void bthread_switching_from(struct bthread *bthread)
+{
+	u64 ran;
+
+	/* the main thread has no switch in before the first switch out */
+	if (!bthread->scheduled_ns)
+		return;
+
+	ran = get_time_ns() - bthread->scheduled_ns;
+	if (ran > bthread->longest_ns)
+		bthread->longest_ns = ran;
+}
+
 static void __noreturn bthread_trampoline(void)
 {
 	finish_switch_fiber(current);
+	bthread_switched_to(current);
 	bthread_reschedule();
 
 	current->threadfn(current->data);
 
 	bthread_suspend(current);
 	current->has_stopped = true;
+	bthread_switching_from(current);
 
 	current = &main_thread;
 	start_switch_fiber(current, true);
@@ -152,6 +182,26 @@ void __bthread_stop(struct bthread *bthread)
 	bthread_free(bthread);
 }
 
+/**
+ * bthread_set_slice - give a thread a time budget
+ * @bthread: the thread
+ * @slice_ns: time it may run before bthread_checkpoint() yields,
+ *	      0 to only yield where the thread reschedules itself
+ */
+void bthread_set_slice(struct bthread *bthread, u64 slice_ns)
+{
+	bthread->slice_ns = slice_ns;
+
+	if (bthread == current)
+		bthread_switched_to(bthread);
+}
+
+void __bthread_checkpoint(void)
+{
+	if ((s64)(get_time_ns() - bthread_slice_end) >= 0)
+		bthread_reschedule();
+}
+
 int bthread_should_stop(void)
 {
 	if (bthread_is_main(current))
@@ -160,14 +210,28 @@ int bthread_should_stop(void)
 	return current->should_stop;
 }
 
+static void bthread_print(struct bthread *bthread)
+{
+	printf("%s", bthread->name);
+
+	if (bthread->slice_ns)
+		printf(" (slice %llu us)", div_u64(bthread->slice_ns, 1000));
+
+	if (bthread->longest_ns)
+		printf(" longest run %llu us", div_u64(bthread->longest_ns, 1000));
+
+	printf("\n");
+}
+
 void bthread_info(void)
 {
 	struct bthread *bthread;
 
-	printf("Registered barebox threads:\n%s\n", current->name);
+	printf("Registered barebox threads:\n");
+	bthread_print(current);
 
 	list_for_each_entry(bthread, &current->list, list)
-		printf("%s\n", bthread->name);
+		bthread_print(bthread);
 }
 
 void bthread_reschedule(void)
@@ -200,11 +264,13 @@ void bthread_schedule(struct bthread *to)
 
 	ret = setjmp(from->jmp_buf);
 	if (ret == 0) {
+		bthread_switching_from(from);
 		current = to;
 		longjmp(to->jmp_buf, 1);
 	}
 
 	finish_switch_fiber(from);
+	bthread_switched_to(from);
 }
 
 #ifdef HAVE_FIBER_SANITIZER
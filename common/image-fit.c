@@ -14,11 +14,13 @@
 #include <digest.h>
 #include <of.h>
 #include <fs.h>
+#include <fcntl.h>
 #include <malloc.h>
 #include <linux/ctype.h>
 #include <asm/byteorder.h>
 #include <errno.h>
 #include <linux/err.h>
+#include <linux/sizes.h>
 #include <stringlist.h>
 #include <rsa.h>
 #include <image-fit.h>
@@ -365,12 +367,24 @@ static int fit_verify_signature(struct device_node *sig_node, const void *fit)
 	return ret;
 }
 
-static int fit_verify_hash(struct fit_handle *handle, struct device_node *image,
-			   const void *data, int data_len)
+/*
+ * Checking an image is split into start, update and finish, so that
+ * externally stored image data can be hashed chunk by chunk while it is
+ * read instead of in a second pass over the whole image.
+ */
+struct fit_image_verify {
+	struct digest *digest;
+	struct device_node *node;	/* the hash or signature node */
+	enum hash_algo algo;
+	bool signature;
+};
+
+static int fit_verify_hash_start(struct fit_handle *handle,
+				 struct device_node *image,
+				 struct fit_image_verify *v)
 {
 	struct digest *d;
 	const char *algo;
-	const char *value_read;
 	int hash_len, ret;
 	struct device_node *hash;
 
@@ -394,8 +408,7 @@ static int fit_verify_hash(struct fit_handle *handle, struct device_node *image,
 		return ret;
 	}
 
-	value_read = of_get_property(hash, "value", &hash_len);
-	if (!value_read) {
+	if (!of_get_property(hash, "value", &hash_len)) {
 		pr_err("%s: \"value\" property not found\n", hash->full_name);
 		return -EINVAL;
 	}
@@ -413,35 +426,42 @@ static int fit_verify_hash(struct fit_handle *handle, struct device_node *image,
 
 	if (hash_len != digest_length(d)) {
 		pr_err("%s: invalid hash length %d\n", hash->full_name, hash_len);
-		ret = -EINVAL;
-		goto err_digest_free;
+		digest_free(d);
+		return -EINVAL;
 	}
 
 	digest_init(d);
-	digest_update(d, data, data_len);
 
-	if (digest_verify(d, value_read)) {
-		pr_info("%s: hash BAD\n", hash->full_name);
+	v->digest = d;
+	v->node = hash;
+
+	return 0;
+}
+
+static int fit_verify_hash_finish(struct fit_image_verify *v)
+{
+	const char *value_read;
+	int ret;
+
+	value_read = of_get_property(v->node, "value", NULL);
+
+	if (digest_verify(v->digest, value_read)) {
+		pr_info("%s: hash BAD\n", v->node->full_name);
 		ret =  -EBADMSG;
 	} else {
-		pr_info("%s: hash OK\n", hash->full_name);
+		pr_info("%s: hash OK\n", v->node->full_name);
 		ret = 0;
 	}
 
-err_digest_free:
-	digest_free(d);
-
 	return ret;
 }
 
-static int fit_image_verify_signature(struct fit_handle *handle,
-				      struct device_node *image,
-				      const void *data, int data_len)
+static int fit_image_verify_signature_start(struct fit_handle *handle,
+					    struct device_node *image,
+					    struct fit_image_verify *v)
 {
 	struct digest *digest;
 	struct device_node *sig_node;
-	enum hash_algo algo = 0;
-	void *hash;
 	int ret;
 
 	if (!IS_ENABLED(CONFIG_FITIMAGE_SIGNATURE))
@@ -465,19 +485,211 @@ static int fit_image_verify_signature(struct fit_handle *handle,
 		return ret;
 	}
 
-	digest = fit_alloc_digest(sig_node, &algo);
+	digest = fit_alloc_digest(sig_node, &v->algo);
 	if (IS_ERR(digest))
 		return PTR_ERR(digest);
 
-	digest_update(digest, data, data_len);
-	hash = xzalloc(digest_length(digest));
-	digest_final(digest, hash);
+	v->digest = digest;
+	v->node = sig_node;
+	v->signature = true;
 
-	ret = fit_check_rsa_signature(sig_node, algo, hash);
+	return 0;
+}
+
+static int fit_image_verify_signature_finish(struct fit_image_verify *v)
+{
+	void *hash;
+	int ret;
+
+	hash = xzalloc(digest_length(v->digest));
+	digest_final(v->digest, hash);
+
+	ret = fit_check_rsa_signature(v->node, v->algo, hash);
 
 	free(hash);
 
-	digest_free(digest);
+	return ret;
+}
+
+/*
+ * If the image is opened as part of a configuration only its hash is
+ * checked, see fit_open_image().
+ */
+static int fit_image_verify_start(struct fit_handle *handle,
+				  void *configuration,
+				  struct device_node *image,
+				  struct fit_image_verify *v)
+{
+	memset(v, 0, sizeof(*v));
+
+	if (configuration)
+		return fit_verify_hash_start(handle, image, v);
+	else
+		return fit_image_verify_signature_start(handle, image, v);
+}
+
+static void fit_image_verify_update(struct fit_image_verify *v,
+				    const void *data, unsigned long len)
+{
+	u64 start;
+
+	if (!v->digest)
+		return;
+
+	start = bootm_phase_start();
+	digest_update(v->digest, data, len);
+	bootm_phase_end(BOOTM_PHASE_VERIFY, start);
+}
+
+static int fit_image_verify_finish(struct fit_image_verify *v)
+{
+	u64 start;
+	int ret;
+
+	if (!v->digest)
+		return 0;
+
+	start = bootm_phase_start();
+
+	if (v->signature)
+		ret = fit_image_verify_signature_finish(v);
+	else
+		ret = fit_verify_hash_finish(v);
+
+	digest_free(v->digest);
+	v->digest = NULL;
+
+	bootm_phase_end(BOOTM_PHASE_VERIFY, start);
+
+	return ret;
+}
+
+/* Size of the reads for external image data, each is hashed while hot */
+#define FIT_READ_CHUNK	SZ_256K
+
+struct fit_image_data {
+	struct list_head list;
+	void *buf;
+};
+
+/*
+ * Files on TFTP can only be read forward. When the images are stored in
+ * another order than bootm opens them, seeking back fails and the file
+ * is opened again to get to @pos from its start.
+ */
+static int fit_seek(struct fit_handle *handle, loff_t pos)
+{
+	if (handle->fd >= 0 && lseek(handle->fd, pos, SEEK_SET) == pos)
+		return 0;
+
+	pr_debug("%s: reopening to seek to 0x%llx\n", handle->filename, pos);
+
+	if (handle->fd >= 0)
+		close(handle->fd);
+
+	handle->fd = open(handle->filename, O_RDONLY);
+	if (handle->fd < 0)
+		return -errno;
+
+	if (lseek(handle->fd, pos, SEEK_SET) != pos)
+		return -errno;
+
+	return 0;
+}
+
+/*
+ * fit_read_external_data - get image data stored behind the FIT blob
+ *
+ * Images built with 'mkimage -E' have a data-size property and either
+ * a data-offset, relative to the 4 byte aligned end of the FIT blob, or
+ * an absolute data-position instead of a data property. When the FIT
+ * was opened from a file, only the blob was read. The image data is then
+ * read in chunks of FIT_READ_CHUNK and each chunk goes through the digest
+ * right after it was read, so no second pass over the data is needed.
+ */
+static int fit_read_external_data(struct fit_handle *handle,
+				  struct device_node *image,
+				  struct fit_image_verify *v,
+				  const void **outdata, int *outlen)
+{
+	const struct fdt_header *fdt = handle->fit;
+	struct fit_image_data *fid;
+	u32 size, offset;
+	loff_t start;
+	size_t pos, now;
+	u64 t;
+	int ret;
+
+	if (of_property_read_u32(image, "data-size", &size)) {
+		pr_err("data not found\n");
+		return -EINVAL;
+	}
+
+	if (!of_property_read_u32(image, "data-position", &offset)) {
+		start = offset;
+	} else if (!of_property_read_u32(image, "data-offset", &offset)) {
+		start = ALIGN(fdt32_to_cpu(fdt->totalsize), 4);
+		start += offset;
+	} else {
+		pr_err("data not found\n");
+		return -EINVAL;
+	}
+
+	if (size > INT_MAX)
+		return -EINVAL;
+
+	if (!handle->filename) {
+		if (start > handle->size || size > handle->size - start) {
+			pr_err("%s: data outside of FIT image\n",
+			       image->full_name);
+			return -EINVAL;
+		}
+
+		*outdata = handle->fit + start;
+		*outlen = size;
+		fit_image_verify_update(v, *outdata, size);
+
+		return 0;
+	}
+
+	fid = xzalloc(sizeof(*fid));
+	fid->buf = malloc(size);
+	if (!fid->buf) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	ret = fit_seek(handle, start);
+	if (ret)
+		goto err;
+
+	for (pos = 0; pos < size; pos += now) {
+		now = min_t(size_t, size - pos, FIT_READ_CHUNK);
+
+		t = bootm_phase_start();
+		ret = read_full(handle->fd, fid->buf + pos, now);
+		bootm_phase_end(BOOTM_PHASE_READ, t);
+		if (ret < 0)
+			goto err;
+		if (ret < now) {
+			pr_err("%s: data outside of FIT image\n",
+			       image->full_name);
+			ret = -EINVAL;
+			goto err;
+		}
+
+		fit_image_verify_update(v, fid->buf + pos, now);
+	}
+
+	list_add_tail(&fid->list, &handle->data);
+
+	*outdata = fid->buf;
+	*outlen = size;
+
+	return 0;
+err:
+	free(fid->buf);
+	free(fid);
 
 	return ret;
 }
@@ -591,6 +803,7 @@ int fit_open_image(struct fit_handle *handle, void *configuration,
 {
 	struct device_node *image;
 	const char *unit = name, *type = NULL, *desc= "(no description)";
+	struct fit_image_verify v;
 	const void *data;
 	int data_len;
 	int ret = 0;
@@ -608,17 +821,23 @@ int fit_open_image(struct fit_handle *handle, void *configuration,
 		return -EINVAL;
 	}
 
+	ret = fit_image_verify_start(handle, configuration, image, &v);
+	if (ret)
+		return ret;
+
 	data = of_get_property(image, "data", &data_len);
-	if (!data) {
-		pr_err("data not found\n");
-		return -EINVAL;
+	if (data) {
+		fit_image_verify_update(&v, data, data_len);
+	} else {
+		ret = fit_read_external_data(handle, image, &v, &data,
+					     &data_len);
+		if (ret) {
+			digest_free(v.digest);
+			return ret;
+		}
 	}
 
-	if (configuration)
-		ret = fit_verify_hash(handle, image, data, data_len);
-	else
-		ret = fit_image_verify_signature(handle, image, data, data_len);
-
+	ret = fit_image_verify_finish(&v);
 	if (ret < 0)
 		return ret;
 
@@ -712,6 +931,7 @@ void *fit_open_configuration(struct fit_handle *handle, const char *name)
 {
 	struct device_node *conf_node = handle->configurations;
 	const char *unit, *desc = "(no description)";
+	u64 start;
 	int ret;
 
 	if (!conf_node)
@@ -736,7 +956,9 @@ void *fit_open_configuration(struct fit_handle *handle, const char *name)
 	of_property_read_string(conf_node, "description", &desc);
 	pr_info("configuration '%s': %s\n", unit, desc);
 
+	start = bootm_phase_start();
 	ret = fit_config_verify_signature(handle, conf_node);
+	bootm_phase_end(BOOTM_PHASE_VERIFY, start);
 	if (ret)
 		return ERR_PTR(ret);
 
@@ -791,6 +1013,8 @@ struct fit_handle *fit_open_buf(const void *buf, size_t size, bool verbose,
 	handle->fit = buf;
 	handle->size = size;
 	handle->verify = verify;
+	handle->fd = -1;
+	INIT_LIST_HEAD(&handle->data);
 
 	ret = fit_do_open(handle);
 	if (ret) {
@@ -816,20 +1040,57 @@ struct fit_handle *fit_open(const char *filename, bool verbose,
 			    enum bootm_verify verify)
 {
 	struct fit_handle *handle;
+	struct fdt_header header;
+	u64 start;
 	int ret;
 
 	handle = xzalloc(sizeof(struct fit_handle));
 
 	handle->verbose = verbose;
 	handle->verify = verify;
+	INIT_LIST_HEAD(&handle->data);
 
-	ret = read_file_2(filename, &handle->size, &handle->fit_alloc,
-			  FILESIZE_MAX);
-	if (ret) {
-		pr_err("unable to read %s: %s\n", filename, strerror(-ret));
-		return ERR_PTR(ret);
+	handle->filename = xstrdup(filename);
+	handle->fd = open(filename, O_RDONLY);
+	if (handle->fd < 0) {
+		ret = -errno;
+		goto err_read;
 	}
 
+	/*
+	 * Read only the FIT blob. Image data stored behind it is read when
+	 * the image is opened, see fit_read_external_data().
+	 */
+	ret = read_full(handle->fd, &header, sizeof(header));
+	if (ret >= 0 && ret < sizeof(header))
+		ret = -EINVAL;
+	if (ret < 0)
+		goto err_read;
+
+	handle->size = fdt32_to_cpu(header.totalsize);
+	if (fdt32_to_cpu(header.magic) != FDT_MAGIC ||
+	    handle->size < sizeof(header) || handle->size > FILESIZE_MAX) {
+		ret = -EINVAL;
+		goto err_read;
+	}
+
+	handle->fit_alloc = malloc(handle->size);
+	if (!handle->fit_alloc) {
+		ret = -ENOMEM;
+		goto err_read;
+	}
+
+	memcpy(handle->fit_alloc, &header, sizeof(header));
+
+	start = bootm_phase_start();
+	ret = read_full(handle->fd, handle->fit_alloc + sizeof(header),
+			handle->size - sizeof(header));
+	bootm_phase_end(BOOTM_PHASE_READ, start);
+	if (ret >= 0 && ret < handle->size - sizeof(header))
+		ret = -EINVAL;
+	if (ret < 0)
+		goto err_read;
+
 	handle->fit = handle->fit_alloc;
 
 	ret = fit_do_open(handle);
@@ -839,13 +1100,30 @@ struct fit_handle *fit_open(const char *filename, bool verbose,
 	}
 
 	return handle;
+
+err_read:
+	pr_err("unable to read %s: %s\n", filename, strerror(-ret));
+	fit_close(handle);
+
+	return ERR_PTR(ret);
 }
 
 void fit_close(struct fit_handle *handle)
 {
+	struct fit_image_data *fid, *tmp;
+
 	if (handle->root)
 		of_delete_node(handle->root);
 
+	list_for_each_entry_safe(fid, tmp, &handle->data, list) {
+		free(fid->buf);
+		free(fid);
+	}
+
+	if (handle->fd >= 0)
+		close(handle->fd);
+
+	free(handle->filename);
 	free(handle->fit_alloc);
 	free(handle);
 }
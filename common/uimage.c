@@ -20,6 +20,7 @@
 #include <filetype.h>
 #include <memory.h>
 #include <zero_page.h>
+#include <bootm.h>
 
 static inline int uimage_is_multi_image(struct uimage_handle *handle)
 {
@@ -256,6 +257,7 @@ int uimage_verify(struct uimage_handle *handle)
 	u32 crc = 0;
 	int len, ret;
 	loff_t off;
+	u64 start;
 	void *buf;
 
 	off = sizeof(struct image_header);
@@ -267,10 +269,16 @@ int uimage_verify(struct uimage_handle *handle)
 	len = handle->header.ih_size;
 	while (len) {
 		int now = min(len, PAGE_SIZE);
+
+		start = bootm_phase_start();
 		ret = read(handle->fd, buf, now);
+		bootm_phase_end(BOOTM_PHASE_READ, start);
 		if (ret < 0)
 			goto err;
+
+		start = bootm_phase_start();
 		crc = crc32(crc, buf, now);
+		bootm_phase_end(BOOTM_PHASE_VERIFY, start);
 		len -= ret;
 	}
 
@@ -299,6 +307,7 @@ int uimage_load(struct uimage_handle *handle, unsigned int image_no,
 	struct uimage_handle_data *iha;
 	int ret;
 	loff_t off;
+	u64 start = 0;
 	int (*uncompress_fn)(unsigned char *inbuf, int len,
 		    int(*fill)(void*, unsigned int),
 	            int(*flush)(void*, unsigned int),
@@ -323,9 +332,17 @@ int uimage_load(struct uimage_handle *handle, unsigned int image_no,
 
 	uimage_fd = handle->fd;
 
+	/* uncompress() accounts reading and decompressing itself */
+	if (uncompress_fn == uncompress_copy)
+		start = bootm_phase_start();
+
 	ret = uncompress_fn(NULL, iha->len, uimage_fill, flush,
 				NULL, NULL,
 				uncompress_err_stdout);
+
+	if (uncompress_fn == uncompress_copy)
+		bootm_phase_end(BOOTM_PHASE_READ, start);
+
 	return ret;
 }
 EXPORT_SYMBOL(uimage_load);
@@ -370,12 +387,15 @@ struct resource *file_to_sdram(const char *filename, unsigned long adr)
 	size_t size = BUFSIZ;
 	size_t ofs = 0;
 	ssize_t now;
+	u64 start;
 	int fd;
 
 	fd = open(filename, O_RDONLY);
 	if (fd < 0)
 		return NULL;
 
+	start = bootm_phase_start();
+
 	while (1) {
 		res = request_sdram_region("image", adr, size);
 		if (!res) {
@@ -417,6 +437,7 @@ struct resource *file_to_sdram(const char *filename, unsigned long adr)
 	}
 out:
 	close(fd);
+	bootm_phase_end(BOOTM_PHASE_READ, start);
 
 	return res;
 }
@@ -467,6 +488,7 @@ void *uimage_load_to_buf(struct uimage_handle *handle, int image_no,
 	struct uimage_handle_data *ihd;
 	char ftbuf[128];
 	enum filetype ft;
+	u64 start;
 	void *buf;
 
 	if (image_no >= handle->nb_data_entries)
@@ -483,7 +505,9 @@ void *uimage_load_to_buf(struct uimage_handle *handle, int image_no,
 		if (!buf)
 			return NULL;
 
+		start = bootm_phase_start();
 		ret = read_full(handle->fd, buf, ihd->len);
+		bootm_phase_end(BOOTM_PHASE_READ, start);
 		if (ret < ihd->len) {
 			free(buf);
 			return NULL;
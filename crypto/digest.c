@@ -23,7 +23,10 @@
 #include <module.h>
 #include <linux/err.h>
 #include <crypto.h>
+#include <clock.h>
 #include <crypto/internal.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
 
 static LIST_HEAD(digests);
 
@@ -159,14 +162,9 @@ void digest_algo_prints(const char *prefix)
 	}
 }
 
-struct digest *digest_alloc(const char *name)
+static struct digest *digest_algo_alloc(struct digest_algo *algo)
 {
 	struct digest *d;
-	struct digest_algo *algo;
-
-	algo = digest_algo_get_by_name(name);
-	if (!algo)
-		return NULL;
 
 	d = xzalloc(sizeof(*d));
 	d->algo = algo;
@@ -178,26 +176,162 @@ struct digest *digest_alloc(const char *name)
 
 	return d;
 }
-EXPORT_SYMBOL_GPL(digest_alloc);
 
-struct digest *digest_alloc_by_algo(enum hash_algo hash_algo)
+#define DIGEST_BENCH_SIZE	SZ_64K
+#define DIGEST_BENCH_NS		(100 * MSECOND)
+
+/* throughput of a driver in MB/s, 0 if it can't be measured */
+static unsigned int digest_algo_speed(struct digest_algo *algo,
+				      const void *buf)
 {
 	struct digest *d;
+	unsigned char *md;
+	u64 start, ns, bytes = 0;
+	int ret;
+
+	if (algo->base.flags & DIGEST_ALGO_NEED_KEY)
+		return 0;
+
+	d = digest_algo_alloc(algo);
+	if (!d)
+		return 0;
+
+	md = xmalloc(algo->length);
+
+	start = get_time_ns();
+
+	ret = digest_init(d);
+
+	do {
+		if (!ret)
+			ret = digest_update(d, buf, DIGEST_BENCH_SIZE);
+		bytes += DIGEST_BENCH_SIZE;
+		ns = get_time_ns() - start;
+	} while (!ret && ns < DIGEST_BENCH_NS);
+
+	if (!ret)
+		ret = digest_final(d, md);
+
+	free(md);
+	digest_free(d);
+
+	return ret ? 0 : div64_u64(bytes * 1000, ns);
+}
+
+/**
+ * digest_algo_bench - measure the throughput of the registered digests
+ * @name: only measure the drivers of this algorithm, NULL for all
+ * @prefer: raise the priority of the fastest driver of each measured
+ *	    algorithm, so that digest_alloc() returns it from now on
+ *
+ * Drivers that need a key are listed, but not measured.
+ *
+ * Return: 0 on success, -ENOENT if there is no driver for @name
+ */
+int digest_algo_bench(const char *name, bool prefer)
+{
+	struct digest_algo *d, *tmp, *fastest;
+	unsigned int *speed, fastest_speed;
+	void *buf;
+	int i, j, n = 0, priority;
+
+	list_for_each_entry(d, &digests, list)
+		if (!name || !strcmp(d->base.name, name))
+			n++;
+
+	if (!n)
+		return -ENOENT;
+
+	speed = xzalloc(n * sizeof(*speed));
+	buf = xmalloc(DIGEST_BENCH_SIZE);
+	memset(buf, 0x5a, DIGEST_BENCH_SIZE);
+
+	printf("%-15s\t%-20s\t%-8s\t%s\n", "name", "driver", "priority",
+	       "MB/s");
+	printf("--------------------------------------------------------\n");
+
+	i = 0;
+	list_for_each_entry(d, &digests, list) {
+		if (name && strcmp(d->base.name, name))
+			continue;
+
+		speed[i] = digest_algo_speed(d, buf);
+
+		printf("%-15s\t%-20s\t%-8d\t", d->base.name,
+		       d->base.driver_name, d->base.priority);
+		if (speed[i])
+			printf("%u\n", speed[i]);
+		else
+			printf("-\n");
+		i++;
+	}
+
+	free(buf);
+
+	if (!prefer)
+		goto out;
+
+	/* compare each measured driver with the others of its algorithm */
+	i = 0;
+	list_for_each_entry(d, &digests, list) {
+		if (name && strcmp(d->base.name, name))
+			continue;
+
+		fastest = d;
+		fastest_speed = speed[i];
+		priority = d->base.priority;
+
+		j = 0;
+		list_for_each_entry(tmp, &digests, list) {
+			if (name && strcmp(tmp->base.name, name))
+				continue;
+
+			if (!strcmp(tmp->base.name, d->base.name)) {
+				if (speed[j] > fastest_speed) {
+					fastest = tmp;
+					fastest_speed = speed[j];
+				}
+				priority = max(priority, tmp->base.priority);
+			}
+			j++;
+		}
+
+		if (fastest == d && fastest_speed &&
+		    digest_algo_get_by_name(d->base.name) != d) {
+			d->base.priority = priority + 1;
+			printf("using %s for %s\n", d->base.driver_name,
+			       d->base.name);
+		}
+		i++;
+	}
+
+out:
+	free(speed);
+
+	return 0;
+}
+
+struct digest *digest_alloc(const char *name)
+{
 	struct digest_algo *algo;
 
-	algo = digest_algo_get_by_algo(hash_algo);
+	algo = digest_algo_get_by_name(name);
 	if (!algo)
 		return NULL;
 
-	d = xzalloc(sizeof(*d));
-	d->algo = algo;
-	d->ctx = xzalloc(algo->ctx_length);
-	if (d->algo->alloc(d)) {
-		digest_free(d);
+	return digest_algo_alloc(algo);
+}
+EXPORT_SYMBOL_GPL(digest_alloc);
+
+struct digest *digest_alloc_by_algo(enum hash_algo hash_algo)
+{
+	struct digest_algo *algo;
+
+	algo = digest_algo_get_by_algo(hash_algo);
+	if (!algo)
 		return NULL;
-	}
 
-	return d;
+	return digest_algo_alloc(algo);
 }
 EXPORT_SYMBOL_GPL(digest_alloc_by_algo);
 
@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Generate the slice-by-8 tables for crypto/crc32.c, so that they can be
+ * const and end up in rodata instead of being filled in at runtime.
+ */
+#include <stdio.h>
+#include <stdint.h>
+
+#define CRC32_POLY	0xedb88320
+#define CRC32C_POLY	0x82f63b78
+
+static uint32_t table[8][256];
+
+static void make_table(uint32_t poly)
+{
+	uint32_t c;
+	int n, k;
+
+	for (n = 0; n < 256; n++) {
+		c = n;
+		for (k = 0; k < 8; k++)
+			c = c & 1 ? poly ^ (c >> 1) : c >> 1;
+		table[0][n] = c;
+	}
+
+	/* row k is the CRC of a byte followed by k zero bytes */
+	for (n = 0; n < 256; n++) {
+		c = table[0][n];
+		for (k = 1; k < 8; k++) {
+			c = table[0][c & 0xff] ^ (c >> 8);
+			table[k][n] = c;
+		}
+	}
+}
+
+static void output_table(const char *name, uint32_t poly)
+{
+	int n, k;
+
+	make_table(poly);
+
+	printf("static const uint32_t %s[8][256] = {\n", name);
+
+	for (k = 0; k < 8; k++) {
+		printf("\t{\n");
+		for (n = 0; n < 256; n++)
+			printf("%s0x%08xL,%s", n % 4 ? " " : "\t\t", table[k][n],
+			       n % 4 == 3 ? "\n" : "");
+		printf("\t},\n");
+	}
+
+	printf("};\n");
+}
+
+int main(void)
+{
+	printf("/* this file is generated - do not edit */\n\n");
+
+	output_table("crc_table", CRC32_POLY);
+	printf("\n");
+	output_table("crc32c_table", CRC32C_POLY);
+
+	return 0;
+}
@@ -66,6 +66,12 @@ static const u64 sha512_K[80] = {
 #define s0(x)       (ror64(x, 1) ^ ror64(x, 8) ^ (x >> 7))
 #define s1(x)       (ror64(x,19) ^ ror64(x,61) ^ (x >> 6))
 
+/*
+ * As for SHA-256, the message schedule is a window of 16 words extended
+ * just before each round uses it. The rounds are unrolled 16 at a time so
+ * the window indices are constants, a full unroll of all 80 rounds on
+ * 64-bit words would be far too large on 32-bit machines.
+ */
 static inline void LOAD_OP(int I, u64 *W, const u8 *input)
 {
 	W[I] = get_unaligned_be64((__u64 *)input + I);
@@ -76,51 +82,53 @@ static inline void BLEND_OP(int I, u64 *W)
 	W[I & 15] += s1(W[(I-2) & 15]) + W[(I-7) & 15] + s0(W[(I-15) & 15]);
 }
 
+#define SHA512_ROUND(i, j, load, a, b, c, d, e, f, g, h) do {		\
+	u64 t1, t2;							\
+	if (load)							\
+		LOAD_OP(j, W, input);					\
+	else								\
+		BLEND_OP(j, W);						\
+	t1 = h + e1(e) + Ch(e, f, g) + sha512_K[(i) + (j)] + W[j];	\
+	t2 = e0(a) + Maj(a, b, c);					\
+	d += t1;							\
+	h = t1 + t2;							\
+} while (0)
+
+#define SHA512_16ROUNDS(i, load) do {					\
+	SHA512_ROUND(i,  0, load, a, b, c, d, e, f, g, h);		\
+	SHA512_ROUND(i,  1, load, h, a, b, c, d, e, f, g);		\
+	SHA512_ROUND(i,  2, load, g, h, a, b, c, d, e, f);		\
+	SHA512_ROUND(i,  3, load, f, g, h, a, b, c, d, e);		\
+	SHA512_ROUND(i,  4, load, e, f, g, h, a, b, c, d);		\
+	SHA512_ROUND(i,  5, load, d, e, f, g, h, a, b, c);		\
+	SHA512_ROUND(i,  6, load, c, d, e, f, g, h, a, b);		\
+	SHA512_ROUND(i,  7, load, b, c, d, e, f, g, h, a);		\
+	SHA512_ROUND(i,  8, load, a, b, c, d, e, f, g, h);		\
+	SHA512_ROUND(i,  9, load, h, a, b, c, d, e, f, g);		\
+	SHA512_ROUND(i, 10, load, g, h, a, b, c, d, e, f);		\
+	SHA512_ROUND(i, 11, load, f, g, h, a, b, c, d, e);		\
+	SHA512_ROUND(i, 12, load, e, f, g, h, a, b, c, d);		\
+	SHA512_ROUND(i, 13, load, d, e, f, g, h, a, b, c);		\
+	SHA512_ROUND(i, 14, load, c, d, e, f, g, h, a, b);		\
+	SHA512_ROUND(i, 15, load, b, c, d, e, f, g, h, a);		\
+} while (0)
+
 static void
 sha512_transform(u64 *state, const u8 *input)
 {
-	u64 a, b, c, d, e, f, g, h, t1, t2;
-
-	int i;
+	u64 a, b, c, d, e, f, g, h;
 	u64 W[16];
+	int i;
 
 	/* load the state into our registers */
 	a=state[0];   b=state[1];   c=state[2];   d=state[3];
 	e=state[4];   f=state[5];   g=state[6];   h=state[7];
 
-	/* now iterate */
-	for (i=0; i<80; i+=8) {
-		if (!(i & 8)) {
-			int j;
-
-			if (i < 16) {
-				/* load the input */
-				for (j = 0; j < 16; j++)
-					LOAD_OP(i + j, W, input);
-			} else {
-				for (j = 0; j < 16; j++) {
-					BLEND_OP(i + j, W);
-				}
-			}
-		}
-
-		t1 = h + e1(e) + Ch(e,f,g) + sha512_K[i  ] + W[(i & 15)];
-		t2 = e0(a) + Maj(a,b,c);    d+=t1;    h=t1+t2;
-		t1 = g + e1(d) + Ch(d,e,f) + sha512_K[i+1] + W[(i & 15) + 1];
-		t2 = e0(h) + Maj(h,a,b);    c+=t1;    g=t1+t2;
-		t1 = f + e1(c) + Ch(c,d,e) + sha512_K[i+2] + W[(i & 15) + 2];
-		t2 = e0(g) + Maj(g,h,a);    b+=t1;    f=t1+t2;
-		t1 = e + e1(b) + Ch(b,c,d) + sha512_K[i+3] + W[(i & 15) + 3];
-		t2 = e0(f) + Maj(f,g,h);    a+=t1;    e=t1+t2;
-		t1 = d + e1(a) + Ch(a,b,c) + sha512_K[i+4] + W[(i & 15) + 4];
-		t2 = e0(e) + Maj(e,f,g);    h+=t1;    d=t1+t2;
-		t1 = c + e1(h) + Ch(h,a,b) + sha512_K[i+5] + W[(i & 15) + 5];
-		t2 = e0(d) + Maj(d,e,f);    g+=t1;    c=t1+t2;
-		t1 = b + e1(g) + Ch(g,h,a) + sha512_K[i+6] + W[(i & 15) + 6];
-		t2 = e0(c) + Maj(c,d,e);    f+=t1;    b=t1+t2;
-		t1 = a + e1(f) + Ch(f,g,h) + sha512_K[i+7] + W[(i & 15) + 7];
-		t2 = e0(b) + Maj(b,c,d);    e+=t1;    a=t1+t2;
-	}
+	/* the first 16 rounds load the input, the others blend */
+	SHA512_16ROUNDS(0, 1);
+
+	for (i = 16; i < 80; i += 16)
+		SHA512_16ROUNDS(i, 0);
 
 	state[0] += a; state[1] += b; state[2] += c; state[3] += d;
 	state[4] += e; state[5] += f; state[6] += g; state[7] += h;
@@ -11,7 +11,7 @@
 
 #include <common.h>
 #include <init.h>
-#include <kfifo.h>
+#include <spsc_ring.h>
 #include <poller.h>
 #include <clock.h>
 #include <input/input.h>
@@ -34,11 +34,22 @@ void input_unregister_notfier(struct input_notifier *in)
 	list_del(&in->list);
 }
 
-void input_report_key_event(struct input_device *idev, unsigned int code, int value)
+static void input_report_event(unsigned int type, unsigned int code, int value)
 {
 	struct input_event event;
 	struct input_notifier *in;
 
+	event.type = type;
+	event.code = code;
+	event.value = value;
+	event.time = get_time_ns();
+
+	list_for_each_entry(in, &input_consumers, list)
+		in->notify(in, &event);
+}
+
+void input_report_key_event(struct input_device *idev, unsigned int code, int value)
+{
 	if (code > KEY_MAX)
 		return;
 
@@ -47,11 +58,19 @@ void input_report_key_event(struct input_device *idev, unsigned int code, int va
 	else
 		clear_bit(code, idev->keys);
 
-	event.code = code;
-	event.value = value;
+	input_report_event(EV_KEY, code, value);
+}
 
-	list_for_each_entry(in, &input_consumers, list)
-		in->notify(in, &event);
+/*
+ * Relative axis motion, e.g. from a mouse. Not tracked in the device
+ * state, notifiers see the delta only.
+ */
+void input_report_rel_event(struct input_device *idev, unsigned int code, int value)
+{
+	if (code > REL_MAX)
+		return;
+
+	input_report_event(EV_REL, code, value);
 }
 
 static LIST_HEAD(input_devices);
@@ -84,7 +103,7 @@ void input_key_get_status(unsigned long *keys, int bits)
 struct input_console {
 	struct console_device console;
 	struct input_notifier notifier;
-	struct kfifo *fifo;
+	struct spsc_ring *fifo;
 	struct poller_async poller;
 	uint8_t current_key;
 	uint8_t modstate[6];
@@ -94,15 +113,15 @@ static int input_console_tstc(struct console_device *cdev)
 {
 	struct input_console *ic = container_of(cdev, struct input_console, console);
 
-	return kfifo_len(ic->fifo) ? 1 : 0;
+	return spsc_ring_len(ic->fifo) ? 1 : 0;
 }
 
 static int input_console_getc(struct console_device *cdev)
 {
 	struct input_console *ic = container_of(cdev, struct input_console, console);
-	uint8_t c;
+	uint8_t c = 0;
 
-	kfifo_getc(ic->fifo, &c);
+	spsc_ring_pop(ic->fifo, &c);
 
 	return c;
 }
@@ -112,7 +131,7 @@ static void input_console_repeat(void *ctx)
 	struct input_console *ic = ctx;
 
 	if (ic->current_key) {
-		kfifo_putc(ic->fifo, ic->current_key);
+		spsc_ring_push(ic->fifo, ic->current_key);
 		poller_call_async(&ic->poller, 40 * MSECOND,
 				  input_console_repeat, ic);
 	}
@@ -130,6 +149,9 @@ static void input_console_notify(struct input_notifier *in,
 	uint8_t modstate = 0;
 	unsigned char ascii;
 
+	if (ev->type != EV_KEY)
+		return;
+
 	switch (ev->code) {
 	case KEY_LEFTSHIFT:
 		ic->modstate[0] = ev->value;
@@ -179,7 +201,7 @@ static void input_console_notify(struct input_notifier *in,
 	pr_debug("map %02x KEY: 0x%04x code: %d\n", modstate, ascii, ev->code);
 
 	if (ev->value) {
-		kfifo_putc(ic->fifo, ascii);
+		spsc_ring_push(ic->fifo, (uint8_t)ascii);
 		ic->current_key = ascii;
 		poller_call_async(&ic->poller, 400 * MSECOND,
 				  input_console_repeat, ic);
@@ -201,7 +223,10 @@ static int input_init(void)
 	ic->console.devid = DEVICE_ID_DYNAMIC;
 	ic->console.devname = "input";
 
-	ic->fifo = kfifo_alloc(32);
+	ic->fifo = spsc_ring_alloc_type(uint8_t, 32);
+	if (!ic->fifo)
+		return -ENOMEM;
+
 	ic->notifier.notify = input_console_notify;
 	input_register_notfier(&ic->notifier);
 	poller_async_register(&ic->poller, "input");
@@ -11,6 +11,9 @@
 static void input_specialkeys_notify(struct input_notifier *in,
 				     struct input_event *ev)
 {
+	if (ev->type != EV_KEY)
+		return;
+
 	switch (ev->code) {
 	case KEY_RESTART:
 		pr_info("Triggering reset due to special key.\n");
@@ -38,9 +38,16 @@ static int virtinput_recv_events(struct virtio_input *vi)
 	int i = 0;
 
 	while ((event = virtqueue_get_buf(vi->evt, &len)) != NULL) {
-		if (le16_to_cpu(event->type) == EV_KEY)
+		switch (le16_to_cpu(event->type)) {
+		case EV_KEY:
 			input_report_key_event(&vi->idev, le16_to_cpu(event->code),
 					       le32_to_cpu(event->value));
+			break;
+		case EV_REL:
+			input_report_rel_event(&vi->idev, le16_to_cpu(event->code),
+					       (s32)le32_to_cpu(event->value));
+			break;
+		}
 
 		pr_debug("\n%s: input event #%td received (type=%u, code=%u, value=%u)\n",
 			 dev_name(dev),
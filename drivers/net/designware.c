@@ -141,13 +141,12 @@ static void rx_descs_init(struct eth_device *dev)
 	struct dw_eth_dev *priv = dev->priv;
 	struct eth_dma_regs *dma_p = priv->dma_regs_p;
 	struct dmamacdescr *desc_table_p = &priv->rx_mac_descrtable_cpu[0];
-	char *rxbuffs = &priv->rxbuffs[0];
 	struct dmamacdescr *desc_p;
 	u32 idx;
 
 	for (idx = 0; idx < CONFIG_RX_DESCR_NUM; idx++) {
 		desc_p = &desc_table_p[idx];
-		desc_p->dmamac_addr = virt_to_phys(&rxbuffs[idx * CONFIG_ETH_BUFSIZE]);
+		desc_p->dmamac_addr = virt_to_phys(priv->rxbufs[idx]->data);
 		desc_p->dmamac_next = rx_dma_addr(priv, &desc_table_p[idx + 1]);
 
 		desc_p->dmamac_cntl = MAC_MAX_FRAME_SZ;
@@ -157,7 +156,7 @@ static void rx_descs_init(struct eth_device *dev)
 			desc_p->dmamac_cntl |= DESC_RXCTRL_RXCHAIN;
 
 		dma_sync_single_for_cpu(desc_p->dmamac_addr,
-					CONFIG_ETH_BUFSIZE, DMA_FROM_DEVICE);
+					NET_RXBUF_SIZE, DMA_FROM_DEVICE);
 		desc_p->txrx_status = DESC_RXSTS_OWNBYDMA;
 	}
 
@@ -325,6 +324,7 @@ static int dwc_ether_rx(struct eth_device *dev)
 	struct dw_eth_dev *priv = dev->priv;
 	u32 desc_num = priv->rx_currdescnum;
 	struct dmamacdescr *desc_p = &priv->rx_mac_descrtable_cpu[desc_num];
+	struct net_rxbuf *buf;
 
 	u32 status = desc_p->txrx_status;
 	int length = 0;
@@ -360,9 +360,17 @@ static int dwc_ether_rx(struct eth_device *dev)
 
 		dma_sync_single_for_cpu(desc_p->dmamac_addr,
 					length, DMA_FROM_DEVICE);
-		net_receive(dev, dmamac_addr(desc_p), length);
-		dma_sync_single_for_device(desc_p->dmamac_addr,
-					   length, DMA_FROM_DEVICE);
+		buf = net_receive_rxbuf(dev, priv->rxbufs[desc_num], length);
+		if (buf != priv->rxbufs[desc_num]) {
+			/* the packet was kept, receive into the spare instead */
+			priv->rxbufs[desc_num] = buf;
+			desc_p->dmamac_addr = virt_to_phys(buf->data);
+			dma_sync_single_for_device(desc_p->dmamac_addr,
+						   NET_RXBUF_SIZE, DMA_FROM_DEVICE);
+		} else {
+			dma_sync_single_for_device(desc_p->dmamac_addr,
+						   length, DMA_FROM_DEVICE);
+		}
 		ret = length;
 	}
 
@@ -448,7 +456,7 @@ struct dw_eth_dev *dwc_drv_probe(struct device_d *dev)
 	struct mii_bus *miibus;
 	void __iomem *base;
 	struct dwc_ether_platform_data *pdata = dev->platform_data;
-	int ret;
+	int ret, i;
 	struct dw_eth_drvdata *drvdata;
 
 	dma_set_mask(dev, DMA_BIT_MASK(32));
@@ -500,7 +508,13 @@ struct dw_eth_dev *dwc_drv_probe(struct device_d *dev)
 		return ERR_PTR(-EFAULT);
 
 	priv->txbuffs = dma_alloc(TX_TOTAL_BUFSIZE);
-	priv->rxbuffs = dma_alloc(RX_TOTAL_BUFSIZE);
+
+	priv->rxbufs = xzalloc(CONFIG_RX_DESCR_NUM * sizeof(*priv->rxbufs));
+	for (i = 0; i < CONFIG_RX_DESCR_NUM; i++) {
+		priv->rxbufs[i] = net_rxbuf_alloc();
+		if (!priv->rxbufs[i])
+			return ERR_PTR(-ENOMEM);
+	}
 
 	edev = &priv->netdev;
 	miibus = &priv->miibus;
@@ -529,6 +543,11 @@ struct dw_eth_dev *dwc_drv_probe(struct device_d *dev)
 void dwc_drv_remove(struct device_d *dev)
 {
 	struct eth_device *edev = dev->priv;
+	struct dw_eth_dev *priv = edev->priv;
+	int i;
 
 	dwc_ether_halt(edev);
+
+	for (i = 0; i < CONFIG_RX_DESCR_NUM; i++)
+		net_rxbuf_put(priv->rxbufs[i]);
 }
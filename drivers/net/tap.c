@@ -15,6 +15,7 @@
 struct tap_priv {
 	int fd;
 	char *name;
+	struct net_rxbuf *rxbuf;
 };
 
 static int tap_eth_send(struct eth_device *edev, void *packet, int length)
@@ -30,10 +31,16 @@ static int tap_eth_rx(struct eth_device *edev)
 	struct tap_priv *priv = edev->priv;
 	int length;
 
-	length = linux_read_nonblock(priv->fd, NetRxPackets[0], PKTSIZE);
+	if (!priv->rxbuf) {
+		priv->rxbuf = net_rxbuf_alloc();
+		if (!priv->rxbuf)
+			return 0;
+	}
+
+	length = linux_read_nonblock(priv->fd, priv->rxbuf->data, PKTSIZE);
 
 	if (length > 0)
-		net_receive(edev, NetRxPackets[0], length);
+		priv->rxbuf = net_receive_rxbuf(edev, priv->rxbuf, length);
 
 	return 0;
 }
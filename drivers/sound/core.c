@@ -6,9 +6,27 @@
 #include <sound.h>
 #include <poller.h>
 #include <linux/iopoll.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+#include <linux/time.h>
 
 static LIST_HEAD(card_list);
 
+/*
+ * Single producer, single consumer ring: sound_card_pcm_write() only
+ * advances head and the poller only advances tail, so neither side
+ * needs a lock. Both are free running byte counters.
+ */
+struct sound_pcm {
+	struct poller_struct poller;
+	struct sound_card *card;
+	u8 *buf;
+	unsigned int size;
+	unsigned int frame_size;
+	unsigned int head;
+	unsigned int tail;
+};
+
 struct beep {
 	int freq;
 	unsigned int us;
@@ -18,6 +36,9 @@ struct beep {
 static int sound_card_do_beep(struct sound_card *card,
 			      int freq, unsigned int us)
 {
+	if (card->pcm)
+		return -EBUSY;
+
 	if (freq == -1)
 		freq = card->bell_frequency;
 
@@ -119,3 +140,149 @@ int sound_card_beep_cancel(struct sound_card *card)
 
 	return ret;
 }
+
+static void sound_pcm_poll(struct poller_struct *poller)
+{
+	struct sound_pcm *pcm = container_of(poller, struct sound_pcm, poller);
+	struct sound_card *card = pcm->card;
+	unsigned int head, off, len, now;
+
+	head = READ_ONCE(pcm->head);
+	len = head - pcm->tail;
+	if (!len)
+		return;
+
+	if (card->pcm_queued(card) * pcm->frame_size >= pcm->size / 2)
+		return;
+
+	off = pcm->tail & (pcm->size - 1);
+	now = min(len, pcm->size - off);
+
+	card->pcm_submit(card, pcm->buf + off, now / pcm->frame_size);
+	if (now < len)
+		card->pcm_submit(card, pcm->buf, (len - now) / pcm->frame_size);
+
+	WRITE_ONCE(pcm->tail, head);
+}
+
+/**
+ * sound_card_pcm_open() - start streaming PCM samples to a sound card
+ * @card: The sound card
+ * @rate: Sample rate in Hz
+ * @format: Sample format
+ * @latency_us: Amount of audio the ring buffer can hold
+ *
+ * Beeping is not possible while the PCM stream is open.
+ *
+ * Return: 0 on success, negative error code otherwise
+ */
+int sound_card_pcm_open(struct sound_card *card, unsigned rate,
+			enum sound_pcm_format format, unsigned latency_us)
+{
+	struct sound_pcm *pcm;
+	unsigned int frame_size;
+	int ret;
+
+	if (!card)
+		return -ENODEV;
+	if (!card->pcm_open)
+		return -ENOSYS;
+	if (card->pcm)
+		return -EBUSY;
+
+	switch (format) {
+	case SOUND_PCM_S16_MONO:
+		frame_size = 2;
+		break;
+	case SOUND_PCM_S16_STEREO:
+		frame_size = 4;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	sound_card_beep_cancel(card);
+
+	ret = card->pcm_open(card, rate, format);
+	if (ret)
+		return ret;
+
+	pcm = xzalloc(sizeof(*pcm));
+	pcm->card = card;
+	pcm->frame_size = frame_size;
+	pcm->size = roundup_pow_of_two(div_u64((u64)rate * latency_us,
+					       USEC_PER_SEC) * frame_size);
+	pcm->buf = xmalloc(pcm->size);
+	pcm->poller.func = sound_pcm_poll;
+
+	card->pcm = pcm;
+	poller_register(&pcm->poller, card->name);
+
+	return 0;
+}
+
+/**
+ * sound_card_pcm_space() - number of frames that can be written
+ * @card: The sound card
+ */
+unsigned sound_card_pcm_space(struct sound_card *card)
+{
+	struct sound_pcm *pcm = card->pcm;
+
+	if (!pcm)
+		return 0;
+
+	return (pcm->size - (pcm->head - READ_ONCE(pcm->tail))) /
+		pcm->frame_size;
+}
+
+/**
+ * sound_card_pcm_write() - queue PCM frames for playback
+ * @card: The sound card
+ * @buf: Frames in the format passed to sound_card_pcm_open()
+ * @nframes: Number of frames in @buf
+ *
+ * Return: number of frames queued, less than @nframes if the ring is full
+ */
+unsigned sound_card_pcm_write(struct sound_card *card, const void *buf,
+			      unsigned nframes)
+{
+	struct sound_pcm *pcm = card->pcm;
+	unsigned int len, off, now;
+
+	if (!pcm)
+		return 0;
+
+	nframes = min(nframes, sound_card_pcm_space(card));
+	len = nframes * pcm->frame_size;
+
+	off = pcm->head & (pcm->size - 1);
+	now = min(len, pcm->size - off);
+
+	memcpy(pcm->buf + off, buf, now);
+	memcpy(pcm->buf, buf + now, len - now);
+
+	WRITE_ONCE(pcm->head, pcm->head + len);
+
+	return nframes;
+}
+
+/**
+ * sound_card_pcm_close() - stop the PCM stream and drop queued samples
+ * @card: The sound card
+ */
+void sound_card_pcm_close(struct sound_card *card)
+{
+	struct sound_pcm *pcm = card->pcm;
+
+	if (!pcm)
+		return;
+
+	poller_unregister(&pcm->poller);
+	card->pcm = NULL;
+
+	card->pcm_close(card);
+
+	free(pcm->buf);
+	free(pcm);
+}
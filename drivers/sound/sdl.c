@@ -40,6 +40,45 @@ static int sandbox_sound_beep(struct sound_card *card, unsigned freq, unsigned d
     return ret;
 }
 
+static unsigned sandbox_sound_frame_size;
+
+static int sandbox_sound_pcm_open(struct sound_card *card, unsigned rate,
+				  enum sound_pcm_format format)
+{
+	unsigned channels = format == SOUND_PCM_S16_STEREO ? 2 : 1;
+
+	sdl_sound_close();
+
+	if (sdl_sound_init(rate, channels)) {
+		sdl_sound_init(SAMPLERATE, 1);
+		return -EIO;
+	}
+
+	sandbox_sound_frame_size = channels * sizeof(int16_t);
+
+	return 0;
+}
+
+static unsigned sandbox_sound_pcm_queued(struct sound_card *card)
+{
+	return sdl_sound_queued() / sandbox_sound_frame_size;
+}
+
+static int sandbox_sound_pcm_submit(struct sound_card *card, const void *buf,
+				    unsigned nframes)
+{
+	if (sdl_sound_queue(buf, nframes * sandbox_sound_frame_size))
+		return -EIO;
+
+	return 0;
+}
+
+static void sandbox_sound_pcm_close(struct sound_card *card)
+{
+	sdl_sound_close();
+	sdl_sound_init(SAMPLERATE, 1);
+}
+
 static int sandbox_sound_probe(struct device_d *dev)
 {
 	struct sandbox_sound *priv;
@@ -51,8 +90,12 @@ static int sandbox_sound_probe(struct device_d *dev)
 	card = &priv->card;
 	card->name = "SDL-Audio";
 	card->beep = sandbox_sound_beep;
+	card->pcm_open = sandbox_sound_pcm_open;
+	card->pcm_queued = sandbox_sound_pcm_queued;
+	card->pcm_submit = sandbox_sound_pcm_submit;
+	card->pcm_close = sandbox_sound_pcm_close;
 
-	ret = sdl_sound_init(SAMPLERATE);
+	ret = sdl_sound_init(SAMPLERATE, 1);
 	if (ret) {
 		ret = -ENODEV;
 		goto free_priv;
@@ -37,8 +37,7 @@ static int fb_close(struct cdev *cdev)
 {
 	struct fb_info *info = cdev->priv;
 
-	if (info->fbops->fb_flush)
-		info->fbops->fb_flush(info);
+	fb_flush(info);
 	return 0;
 }
 
@@ -46,15 +45,51 @@ static int fb_op_flush(struct cdev *cdev)
 {
 	struct fb_info *info = cdev->priv;
 
-	if (info->fbops->fb_flush)
-		info->fbops->fb_flush(info);
+	fb_flush(info);
 	return 0;
 }
 
+/**
+ * fb_flush - make the screen contents visible
+ * @info: the framebuffer
+ *
+ * Drivers may restrict the update to info->damage, where an empty
+ * rectangle means the damaged region is unknown.
+ */
 void fb_flush(struct fb_info *info)
 {
 	if (info->fbops->fb_flush)
 		info->fbops->fb_flush(info);
+
+	memset(&info->damage, 0, sizeof(info->damage));
+}
+
+/**
+ * fb_damage - record a changed region for the next fb_flush
+ * @info: the framebuffer
+ * @rect: the region, clipped to the screen
+ */
+void fb_damage(struct fb_info *info, const struct fb_rect *rect)
+{
+	struct fb_rect *d = &info->damage;
+	u32 x2 = min(rect->x2, info->xres);
+	u32 y2 = min(rect->y2, info->yres);
+
+	if (rect->x1 >= x2 || rect->y1 >= y2)
+		return;
+
+	if (d->x1 >= d->x2 || d->y1 >= d->y2) {
+		d->x1 = rect->x1;
+		d->y1 = rect->y1;
+		d->x2 = x2;
+		d->y2 = y2;
+		return;
+	}
+
+	d->x1 = min(d->x1, rect->x1);
+	d->y1 = min(d->y1, rect->y1);
+	d->x2 = max(d->x2, x2);
+	d->y2 = max(d->y2, y2);
 }
 
 static void fb_release_shadowfb(struct fb_info *info)
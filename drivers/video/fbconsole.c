@@ -2,10 +2,14 @@
 #include <errno.h>
 #include <malloc.h>
 #include <getopt.h>
+#include <clock.h>
+#include <poller.h>
+#include <console.h>
 #include <fb.h>
 #include <gui/image_renderer.h>
 #include <gui/graphic_utils.h>
 #include <linux/font.h>
+#include <linux/math64.h>
 
 enum state_t {
 	LIT,				/* Literal input */
@@ -14,6 +18,25 @@ enum state_t {
 	CSI_CNT,
 };
 
+/*
+ * Text is written to a grid of cells and only drawn when the console
+ * is updated. An update draws the cells that differ from what the
+ * screen shows. Scrolling moves the start of the grid's ring of rows,
+ * and an update moves the pixels once for all rows scrolled since the
+ * last one. Output that follows within update_interval_ms of the last
+ * update is drawn from a poller, so a burst of boot messages costs a
+ * few updates instead of a screen scroll per line.
+ */
+struct fbc_cell {
+	u8 c;
+	u8 color;
+	u8 bgcolor;
+#define FBC_CELL_CURSOR		(1 << 0)
+	u8 flags;
+};
+
+#define FBC_UPDATE_INTERVAL_MS	20
+
 struct fbc_priv {
 	struct console_device cdev;
 	struct fb_info *fb;
@@ -42,10 +65,21 @@ struct fbc_priv {
 	u8 csi[256];
 	unsigned char csi_cmd;
 
+	struct fbc_cell *cells;	/* the text, a ring of rows starting at @top */
+	struct fbc_cell *shown;	/* what the screen shows, not a ring */
+	unsigned int top;
+	unsigned int scrolled;	/* rows scrolled since the last update */
+
+	struct poller_async update_poller;
+	u64 last_update;
+	u32 update_interval_ms;
+
 	int active;
 	int in_console;
 };
 
+static const struct fbc_cell fbc_blank = { .c = ' ' };
+
 static int fbc_getc(struct console_device *cdev)
 {
 	return 0;
@@ -56,10 +90,34 @@ static int fbc_tstc(struct console_device *cdev)
 	return 0;
 }
 
+static unsigned int fbc_ncells(struct fbc_priv *priv)
+{
+	return (priv->rows + 1) * (priv->cols + 1);
+}
+
+static struct fbc_cell *fbc_cell(struct fbc_priv *priv, int x, int y)
+{
+	unsigned int row = (priv->top + y) % (priv->rows + 1);
+
+	return &priv->cells[row * (priv->cols + 1) + x];
+}
+
+static void fbc_fill(struct fbc_cell *cell, const struct fbc_cell *val,
+		     unsigned int n)
+{
+	while (n--)
+		*cell++ = *val;
+}
+
 static void cls(struct fbc_priv *priv)
 {
 	void *buf = gui_screen_render_buffer(priv->sc);
 
+	fbc_fill(priv->cells, &fbc_blank, fbc_ncells(priv));
+	fbc_fill(priv->shown, &fbc_blank, fbc_ncells(priv));
+	priv->top = 0;
+	priv->scrolled = 0;
+
 	memset(buf, 0, priv->fb->line_length * priv->fb->yres);
 	gu_screen_blit(priv->sc);
 }
@@ -87,7 +145,8 @@ static struct rgb colors[] = {
 	{ 255, 255, 255 },
 };
 
-static void drawchar(struct fbc_priv *priv, int x, int y, int c)
+static void drawchar(struct fbc_priv *priv, int x, int y,
+		     const struct fbc_cell *cell)
 {
 	void *buf;
 	int bpp = priv->fb->bits_per_pixel >> 3;
@@ -100,21 +159,15 @@ static void drawchar(struct fbc_priv *priv, int x, int y, int c)
 
 	buf = gui_screen_render_buffer(priv->sc);
 
-	i = find_font_index(priv->font, c);
+	i = find_font_index(priv->font, cell->c);
 	inbuf = priv->font->data + i;
 
 	line_length = priv->fb->line_length;
 
-	color = priv->flags & ANSI_FLAG_INVERT ? priv->bgcolor : priv->color;
-	bgcolor = priv->flags & ANSI_FLAG_INVERT ? priv->color : priv->bgcolor;
-
-	if (priv->flags & ANSI_FLAG_BRIGHT)
-		color += 8;
-
-	rgb = &colors[color];
+	rgb = &colors[cell->color];
 	color = gu_rgb_to_pixel(priv->fb, rgb->r, rgb->g, rgb->b, 0xff);
 
-	rgb = &colors[bgcolor];
+	rgb = &colors[cell->bgcolor];
 	bgcolor = gu_rgb_to_pixel(priv->fb, rgb->r, rgb->g, rgb->b, 0xff);
 
 	for (i = 0; i < priv->font->height; i++) {
@@ -133,30 +186,159 @@ static void drawchar(struct fbc_priv *priv, int x, int y, int c)
 			t <<= 1;
 		}
 	}
+
+	if (cell->flags & FBC_CELL_CURSOR)
+		gu_invert_area(priv->fb, buf, x * priv->font->width,
+			       y * priv->font->height, priv->font->width,
+			       priv->font->height);
 }
 
-static void video_invertchar(struct fbc_priv *priv, int x, int y)
+/* store a character with the current attributes */
+static void setchar(struct fbc_priv *priv, int x, int y, int c)
 {
-	void *buf;
+	struct fbc_cell *cell = fbc_cell(priv, x, y);
+	u8 color, bgcolor;
 
-	buf = gui_screen_render_buffer(priv->sc);
+	color = priv->flags & ANSI_FLAG_INVERT ? priv->bgcolor : priv->color;
+	bgcolor = priv->flags & ANSI_FLAG_INVERT ? priv->color : priv->bgcolor;
+
+	/* the reset color is already a bright one */
+	if (priv->flags & ANSI_FLAG_BRIGHT && color < 8)
+		color += 8;
 
-	gu_invert_area(priv->fb, buf, x * priv->font->width, y * priv->font->height,
-			priv->font->width, priv->font->height);
-	gu_screen_blit_area(priv->sc, x * priv->font->width, y * priv->font->height,
-			priv->font->width, priv->font->height);
+	cell->c = c;
+	cell->bgcolor = bgcolor;
+	/* a space looks the same in every color, don't redraw it for that */
+	cell->color = c == ' ' ? bgcolor : color;
+	cell->flags = 0;
 }
 
-static void show_cursor(struct fbc_priv *priv, int x, int y)
+static void scroll(struct fbc_priv *priv)
 {
-	if (!(priv->flags & HIDE_CURSOR))
-		video_invertchar(priv, x, y);
+	fbc_fill(fbc_cell(priv, 0, 0), &fbc_blank, priv->cols + 1);
+	priv->top = (priv->top + 1) % (priv->rows + 1);
+	priv->scrolled++;
 }
 
-static void printchar(struct fbc_priv *priv, int c)
+/* make the screen show the grid */
+static void fbc_update(struct fbc_priv *priv)
 {
-	video_invertchar(priv, priv->x, priv->y);
+	struct fb_info *fb = priv->fb;
+	unsigned int cols = priv->cols + 1, rows = priv->rows + 1;
+	unsigned int x, y, x1 = cols, y1 = rows, x2 = 0, y2 = 0;
+	int fw = priv->font->width, fh = priv->font->height;
+	struct fbc_cell *row, *shown, want;
+
+	if (priv->scrolled) {
+		void *buf = gui_screen_render_buffer(priv->sc);
+		u32 line_height = fb->line_length * fh;
+		unsigned int n = min(priv->scrolled, rows);
+
+		memmove(buf, buf + line_height * n, line_height * (rows - n));
+		memset(buf + line_height * (rows - n), 0, line_height * n);
+
+		memmove(priv->shown, priv->shown + cols * n,
+			sizeof(*priv->shown) * cols * (rows - n));
+		fbc_fill(priv->shown + cols * (rows - n), &fbc_blank, cols * n);
+
+		priv->scrolled = 0;
+		x1 = y1 = 0;
+		x2 = cols;
+		y2 = rows;
+	}
+
+	for (y = 0; y < rows; y++) {
+		row = fbc_cell(priv, 0, y);
+		shown = priv->shown + y * cols;
+
+		if (y != priv->y && !memcmp(row, shown, sizeof(*row) * cols))
+			continue;
+
+		for (x = 0; x < cols; x++, shown++) {
+			want = row[x];
+
+			if (x == priv->x && y == priv->y &&
+			    !(priv->flags & HIDE_CURSOR))
+				want.flags |= FBC_CELL_CURSOR;
+
+			if (!memcmp(&want, shown, sizeof(want)))
+				continue;
+
+			drawchar(priv, x, y, &want);
+			*shown = want;
 
+			x1 = min(x1, x);
+			y1 = min(y1, y);
+			x2 = max(x2, x + 1);
+			y2 = max(y2, y + 1);
+		}
+	}
+
+	if (y1 >= y2)
+		return;
+
+	/* a scroll moved the pixels right of the last column, too */
+	if (x1 == 0 && x2 == cols && y1 == 0 && y2 == rows)
+		gu_screen_blit_area(priv->sc, 0, 0, fb->xres, rows * fh);
+	else
+		gu_screen_blit_area(priv->sc, x1 * fw, y1 * fh,
+				    (x2 - x1) * fw, (y2 - y1) * fh);
+}
+
+static void fbc_flush_now(struct fbc_priv *priv)
+{
+	if (IS_ENABLED(CONFIG_POLLER))
+		poller_async_cancel(&priv->update_poller);
+
+	fbc_update(priv);
+
+	/* nothing changed, and an empty damage rectangle flushes it all */
+	if (!fb_damage_pending(priv->fb))
+		return;
+
+	fb_flush(priv->fb);
+
+	priv->last_update = get_time_ns();
+}
+
+static void fbc_update_poller(void *ctx)
+{
+	struct fbc_priv *priv = ctx;
+
+	if (!priv->active)
+		return;
+
+	if (priv->in_console) {
+		poller_call_async(&priv->update_poller,
+				  priv->update_interval_ms * MSECOND,
+				  fbc_update_poller, priv);
+		return;
+	}
+
+	fbc_flush_now(priv);
+}
+
+/*
+ * Called after output. Updates the screen right away, or from a poller
+ * if the last update was too recent.
+ */
+static void fbc_output_done(struct fbc_priv *priv)
+{
+	u64 interval = priv->update_interval_ms * MSECOND;
+	u64 since = get_time_ns() - priv->last_update;
+
+	if (!IS_ENABLED(CONFIG_POLLER) || since >= interval) {
+		fbc_flush_now(priv);
+		return;
+	}
+
+	if (!poller_async_active(&priv->update_poller))
+		poller_call_async(&priv->update_poller, interval - since,
+				  fbc_update_poller, priv);
+}
+
+static void printchar(struct fbc_priv *priv, int c)
+{
 	switch (c) {
 	case '\007': /* bell: ignore */
 		break;
@@ -182,11 +364,17 @@ static void printchar(struct fbc_priv *priv, int c)
 		break;
 
 	default:
-		drawchar(priv, priv->x, priv->y, c);
+		/* a tab can move the cursor past the last column */
+		if (priv->x > priv->cols) {
+			priv->y++;
+			priv->x = 0;
+			if (priv->y > priv->rows) {
+				scroll(priv);
+				priv->y = priv->rows;
+			}
+		}
 
-		gu_screen_blit_area(priv->sc, priv->x * priv->font->width,
-				priv->y * priv->font->height,
-				priv->font->width, priv->font->height);
+		setchar(priv, priv->x, priv->y, c);
 
 		priv->x++;
 		if (priv->x > priv->cols) {
@@ -196,22 +384,9 @@ static void printchar(struct fbc_priv *priv, int c)
 	}
 
 	if (priv->y > priv->rows) {
-		void *buf;
-		u32 line_length = priv->fb->line_length;
-		int line_height = line_length * priv->font->height;
-
-		buf = gui_screen_render_buffer(priv->sc);
-
-		memcpy(buf, buf + line_height, line_height * priv->rows);
-		memset(buf + line_height * priv->rows, 0, line_height);
-
-		gu_screen_blit(priv->sc);
+		scroll(priv);
 		priv->y = priv->rows;
 	}
-
-	show_cursor(priv, priv->x, priv->y);
-
-	return;
 }
 
 static void fbc_parse_colors(struct fbc_priv *priv)
@@ -280,8 +455,6 @@ static void fbc_parse_csi(struct fbc_priv *priv)
 				break;
 
 			priv->flags &= ~HIDE_CURSOR;
-			/* show cursor now */
-			show_cursor(priv, priv->x, priv->y);
 			break;
 		}
 		break;
@@ -290,9 +463,6 @@ static void fbc_parse_csi(struct fbc_priv *priv)
 		switch (priv->csi_cmd) {
 		case '?': /* cursor invisible */
 			priv->csi_cmd = -1;
-
-			/* hide cursor now */
-			video_invertchar(priv, priv->x, priv->y);
 			priv->flags |= HIDE_CURSOR;
 
 			break;
@@ -300,47 +470,32 @@ static void fbc_parse_csi(struct fbc_priv *priv)
 		break;
 	case 'J':
 		cls(priv);
-		show_cursor(priv, priv->x, priv->y);
 		return;
 	case 'H':
-		show_cursor(priv, priv->x, priv->y);
-
 		pos = simple_strtoul(priv->csi, &end, 10);
 		priv->y = clamp(pos - 1, 0, (int) priv->rows);
 
 		pos = simple_strtoul(end + 1, NULL, 10);
 		priv->x = clamp(pos - 1, 0, (int) priv->cols);
-
-		show_cursor(priv, priv->x, priv->y);
 	case 'K':
 		pos = simple_strtoul(priv->csi, &end, 10);
-		video_invertchar(priv, priv->x, priv->y);
 		switch (pos) {
 		case 0:
 			for (i = priv->x; i < priv->cols; i++)
-				drawchar(priv, i, priv->y, ' ');
+				setchar(priv, i, priv->y, ' ');
 			break;
 		case 1:
-			for (i = 0; i <= priv->x; i++)
-				drawchar(priv, i, priv->y, ' ');
+			for (i = 0; i <= priv->x && i <= priv->cols; i++)
+				setchar(priv, i, priv->y, ' ');
 			break;
 		}
-		video_invertchar(priv, priv->x, priv->y);
 
 		break;
 	}
 }
 
-static void fbc_putc(struct console_device *cdev, char c)
+static void __fbc_putc(struct fbc_priv *priv, char c)
 {
-	struct fbc_priv *priv = container_of(cdev,
-					struct fbc_priv, cdev);
-	struct fb_info *fb = priv->fb;
-
-	if (priv->in_console)
-		return;
-	priv->in_console = 1;
-
 	switch (priv->state) {
 	case LIT:
 		switch (c) {
@@ -365,7 +520,7 @@ static void fbc_putc(struct console_device *cdev, char c)
 		if (priv->csipos == 255) {
 			priv->csipos = 0;
 			priv->state = LIT;
-			return;
+			break;
 		}
 
 		switch (c) {
@@ -393,9 +548,56 @@ static void fbc_putc(struct console_device *cdev, char c)
 		break;
 
 	}
+}
+
+static void fbc_putc(struct console_device *cdev, char c)
+{
+	struct fbc_priv *priv = container_of(cdev,
+					struct fbc_priv, cdev);
+
+	if (priv->in_console)
+		return;
+	priv->in_console = 1;
+
+	__fbc_putc(priv, c);
+
 	priv->in_console = 0;
 
-	fb_flush(fb);
+	fbc_output_done(priv);
+}
+
+static int fbc_puts(struct console_device *cdev, const char *s,
+		    size_t nbytes)
+{
+	struct fbc_priv *priv = container_of(cdev,
+					struct fbc_priv, cdev);
+	size_t i;
+
+	if (priv->in_console)
+		return 0;
+	priv->in_console = 1;
+
+	for (i = 0; i < nbytes; i++) {
+		if (s[i] == '\n')
+			__fbc_putc(priv, '\r');
+
+		__fbc_putc(priv, s[i]);
+	}
+
+	priv->in_console = 0;
+
+	fbc_output_done(priv);
+
+	return nbytes;
+}
+
+static void fbc_flush(struct console_device *cdev)
+{
+	struct fbc_priv *priv = container_of(cdev,
+					struct fbc_priv, cdev);
+
+	if (priv->active && !priv->in_console)
+		fbc_flush_now(priv);
 }
 
 static int setup_font(struct fbc_priv *priv)
@@ -413,6 +615,23 @@ static int setup_font(struct fbc_priv *priv)
 	priv->rows = fb->yres / priv->font->height - 1;
 	priv->cols = fb->xres / priv->font->width - 1;
 
+	priv->x = min(priv->x, priv->cols);
+	priv->y = min(priv->y, priv->rows);
+
+	/*
+	 * Start out assuming an empty screen, so that whatever is shown,
+	 * a splash screen for example, is only drawn over where there is
+	 * text.
+	 */
+	free(priv->cells);
+	free(priv->shown);
+	priv->cells = xmalloc(fbc_ncells(priv) * sizeof(*priv->cells));
+	priv->shown = xmalloc(fbc_ncells(priv) * sizeof(*priv->shown));
+	fbc_fill(priv->cells, &fbc_blank, fbc_ncells(priv));
+	fbc_fill(priv->shown, &fbc_blank, fbc_ncells(priv));
+	priv->top = 0;
+	priv->scrolled = 0;
+
 	return 0;
 }
 
@@ -435,6 +654,9 @@ static int fbc_open(struct console_device *cdev)
 
 	priv->state = LIT;
 
+	if (IS_ENABLED(CONFIG_POLLER))
+		poller_async_register(&priv->update_poller, "fbconsole");
+
 	dev_info(priv->cdev.dev, "framebuffer console %dx%d activated\n",
 		priv->cols + 1, priv->rows + 1);
 
@@ -449,6 +671,10 @@ static int fbc_close(struct console_device *cdev)
 					struct fbc_priv, cdev);
 
 	if (priv->active) {
+		fbc_flush_now(priv);
+		if (IS_ENABLED(CONFIG_POLLER))
+			poller_async_unregister(&priv->update_poller);
+
 		fb_close(priv->sc);
 		priv->active = false;
 
@@ -471,6 +697,77 @@ static int set_font(struct param_d *p, void *vpriv)
 	return 0;
 }
 
+/**
+ * fbconsole_bench - measure how fast the console of a framebuffer prints
+ * @fb: the framebuffer
+ * @immediate: update the screen after every line instead of at most once
+ *	       per update interval
+ *
+ * Prints lines of text to the console for a second and clears it again.
+ * The console is opened for the measurement if it is not active.
+ *
+ * Return: the number of lines printed per second, a negative error code
+ * otherwise
+ */
+int fbconsole_bench(struct fb_info *fb, bool immediate)
+{
+	struct console_device *cdev;
+	struct fbc_priv *priv = NULL;
+	char line[128];
+	u32 interval;
+	u64 start, ns;
+	unsigned int n = 0;
+	int ret, len;
+	bool opened = false;
+
+	for_each_console(cdev) {
+		if (cdev->putc == fbc_putc && cdev->dev == &fb->dev) {
+			priv = container_of(cdev, struct fbc_priv, cdev);
+			break;
+		}
+	}
+
+	if (!priv)
+		return -ENODEV;
+
+	if (!priv->active) {
+		ret = fbc_open(cdev);
+		if (ret)
+			return ret;
+		opened = true;
+	}
+
+	interval = priv->update_interval_ms;
+	if (immediate)
+		priv->update_interval_ms = 0;
+
+	fbc_puts(cdev, "\033[2J", 4);
+
+	start = get_time_ns();
+
+	do {
+		len = snprintf(line, sizeof(line),
+			       "fbconsole benchmark, line %u: the quick brown fox jumps over the lazy dog\n",
+			       n++);
+		fbc_puts(cdev, line, len);
+		ns = get_time_ns() - start;
+	} while (ns < SECOND);
+
+	fbc_flush(cdev);
+	ns = get_time_ns() - start;
+
+	priv->update_interval_ms = interval;
+
+	fbc_puts(cdev, "\033[2J", 4);
+
+	if (opened)
+		fbc_close(cdev);
+	else
+		fbc_flush(cdev);
+
+	return div64_u64((u64)n * SECOND, ns);
+}
+
 int register_fbconsole(struct fb_info *fb)
 {
 	struct fbc_priv *priv;
@@ -489,6 +786,8 @@ int register_fbconsole(struct fb_info *fb)
 	cdev->dev = &fb->dev;
 	cdev->tstc = fbc_tstc;
 	cdev->putc = fbc_putc;
+	cdev->puts = fbc_puts;
+	cdev->flush = fbc_flush;
 	cdev->getc = fbc_getc;
 	cdev->devname = "fbconsole";
 	cdev->devid = DEVICE_ID_DYNAMIC;
@@ -507,6 +806,10 @@ int register_fbconsole(struct fb_info *fb)
 			set_font, NULL,
 			&priv->par_font_val, priv);
 
+	priv->update_interval_ms = FBC_UPDATE_INTERVAL_MS;
+	dev_add_param_uint32(&cdev->class_dev, "update_interval_ms", NULL, NULL,
+			     &priv->update_interval_ms, "%u", priv);
+
 	pr_info("registered as %s%d\n", cdev->class_dev.name, cdev->class_dev.id);
 
 	return 0;
@@ -0,0 +1,343 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Framebuffer in memory only, for sandbox runs without a display.
+ *
+ * Every fb_flush is counted as a frame. Selected frames can be written
+ * to host files as raw pixels or uncompressed PNG, and the CRC32 of
+ * every frame can be logged, so rendering can be checked pixel exact
+ * on machines without a display.
+ */
+
+#include <common.h>
+#include <driver.h>
+#include <init.h>
+#include <malloc.h>
+#include <mach/linux.h>
+#include <fb.h>
+#include <crc.h>
+#include <errno.h>
+#include <param.h>
+
+enum headlessfb_format {
+	HEADLESSFB_RAW,
+	HEADLESSFB_PNG,
+};
+
+static const char * const headlessfb_format_names[] = {
+	[HEADLESSFB_RAW] = "raw",
+	[HEADLESSFB_PNG] = "png",
+};
+
+struct headlessfb {
+	struct fb_info info;
+
+	char *capture;		/* host path prefix of captured frames */
+	u32 interval;		/* capture every Nth frame, 0 for none */
+	int format;
+	char *crclog;		/* host path of the CRC log */
+	int crclog_fd;
+	u32 frames;
+
+	u8 *png;		/* IDAT chunk of the PNG being written */
+	size_t png_size;
+};
+
+#define PNG_STORED_MAX	65535
+
+static int headlessfb_write(int fd, const void *buf, size_t len)
+{
+	ssize_t now;
+
+	while (len) {
+		now = linux_write(fd, buf, len);
+		if (now <= 0)
+			return -EIO;
+
+		buf += now;
+		len -= now;
+	}
+
+	return 0;
+}
+
+static void put_be32(u8 *p, u32 val)
+{
+	p[0] = val >> 24;
+	p[1] = val >> 16;
+	p[2] = val >> 8;
+	p[3] = val;
+}
+
+static int headlessfb_write_chunk(int fd, const char *type, u8 *chunk,
+				  size_t len)
+{
+	u8 hdr[8];
+	u8 crc[4];
+
+	/* chunk has room for the type in front of the data */
+	memcpy(chunk, type, 4);
+	put_be32(hdr, len);
+	memcpy(hdr + 4, type, 4);
+	put_be32(crc, crc32(0, chunk, len + 4));
+
+	if (headlessfb_write(fd, hdr, sizeof(hdr)) ||
+	    headlessfb_write(fd, chunk + 4, len) ||
+	    headlessfb_write(fd, crc, sizeof(crc)))
+		return -EIO;
+
+	return 0;
+}
+
+static u32 fb_pixel_channel(u32 pixel, struct fb_bitfield *f)
+{
+	return (pixel >> f->offset) & GENMASK(f->length - 1, 0);
+}
+
+/*
+ * Write an RGB PNG. The image data is zlib wrapped with stored deflate
+ * blocks, so no compressor is needed and writing stays fast.
+ */
+static int headlessfb_write_png(struct headlessfb *hfb, int fd)
+{
+	static const u8 signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	struct fb_info *info = &hfb->info;
+	size_t rawlen = info->yres * (1 + info->xres * 3);
+	size_t blocks = DIV_ROUND_UP(rawlen, PNG_STORED_MAX);
+	size_t idatlen = 2 + rawlen + 5 * blocks + 4;
+	u32 a = 1, b = 0;
+	u8 ihdr[4 + 13];
+	u8 *p, *raw;
+	size_t left, now, i;
+	int x, y;
+
+	if (hfb->png_size < 4 + idatlen) {
+		free(hfb->png);
+		hfb->png = malloc(4 + idatlen);
+		if (!hfb->png) {
+			hfb->png_size = 0;
+			return -ENOMEM;
+		}
+		hfb->png_size = 4 + idatlen;
+	}
+
+	/* filter type 0 and RGB for each line, after the headers */
+	raw = hfb->png + idatlen - rawlen;
+	p = raw;
+
+	for (y = 0; y < info->yres; y++) {
+		u32 *line = info->screen_base + y * info->line_length;
+
+		*p++ = 0;
+		for (x = 0; x < info->xres; x++) {
+			*p++ = fb_pixel_channel(line[x], &info->red);
+			*p++ = fb_pixel_channel(line[x], &info->green);
+			*p++ = fb_pixel_channel(line[x], &info->blue);
+		}
+	}
+
+	for (i = 0; i < rawlen; i++) {
+		a += raw[i];
+		if (a >= 65521)
+			a -= 65521;
+		b += a;
+		if (b >= 65521)
+			b -= 65521;
+	}
+
+	/* move the data down, making room for the block headers */
+	p = hfb->png + 4;
+	*p++ = 0x78;
+	*p++ = 0x01;
+
+	for (left = rawlen; left; left -= now) {
+		now = min_t(size_t, left, PNG_STORED_MAX);
+
+		*p++ = now == left;
+		*p++ = now;
+		*p++ = now >> 8;
+		*p++ = ~now;
+		*p++ = ~now >> 8;
+
+		memmove(p, raw, now);
+		p += now;
+		raw += now;
+	}
+
+	put_be32(p, (b << 16) | a);
+
+	put_be32(ihdr + 4, info->xres);
+	put_be32(ihdr + 8, info->yres);
+	ihdr[12] = 8;	/* bit depth */
+	ihdr[13] = 2;	/* RGB */
+	ihdr[14] = 0;
+	ihdr[15] = 0;
+	ihdr[16] = 0;
+
+	if (headlessfb_write(fd, signature, sizeof(signature)) ||
+	    headlessfb_write_chunk(fd, "IHDR", ihdr, 13) ||
+	    headlessfb_write_chunk(fd, "IDAT", hfb->png, idatlen) ||
+	    headlessfb_write_chunk(fd, "IEND", ihdr, 0))
+		return -EIO;
+
+	return 0;
+}
+
+static void headlessfb_capture(struct headlessfb *hfb)
+{
+	struct fb_info *info = &hfb->info;
+	char *name;
+	int fd, ret;
+
+	name = basprintf("%s%06u.%s", hfb->capture, hfb->frames,
+			 headlessfb_format_names[hfb->format]);
+
+	fd = linux_create(name);
+	if (fd < 0) {
+		dev_err(&info->dev, "cannot create %s\n", name);
+		free(name);
+		return;
+	}
+
+	if (hfb->format == HEADLESSFB_PNG)
+		ret = headlessfb_write_png(hfb, fd);
+	else
+		ret = headlessfb_write(fd, info->screen_base,
+				       info->line_length * info->yres);
+
+	if (ret)
+		dev_err(&info->dev, "writing %s failed: %pe\n", name,
+			ERR_PTR(ret));
+
+	linux_close(fd);
+	free(name);
+}
+
+static void headlessfb_log_crc(struct headlessfb *hfb)
+{
+	struct fb_info *info = &hfb->info;
+	char line[32];
+	u32 crc;
+
+	if (hfb->crclog_fd < 0) {
+		hfb->crclog_fd = linux_create(hfb->crclog);
+		if (hfb->crclog_fd < 0) {
+			dev_err(&info->dev, "cannot create %s\n", hfb->crclog);
+			free(hfb->crclog);
+			hfb->crclog = NULL;
+			return;
+		}
+	}
+
+	crc = crc32(0, info->screen_base, info->line_length * info->yres);
+
+	snprintf(line, sizeof(line), "%u %08x\n", hfb->frames, crc);
+	headlessfb_write(hfb->crclog_fd, line, strlen(line));
+}
+
+static void headlessfb_flush(struct fb_info *info)
+{
+	struct headlessfb *hfb = container_of(info, struct headlessfb, info);
+
+	hfb->frames++;
+
+	if (hfb->crclog && *hfb->crclog)
+		headlessfb_log_crc(hfb);
+
+	if (hfb->capture && *hfb->capture && hfb->interval &&
+	    hfb->frames % hfb->interval == 0)
+		headlessfb_capture(hfb);
+}
+
+static int headlessfb_crclog_set(struct param_d *p, void *priv)
+{
+	struct headlessfb *hfb = priv;
+
+	/* reopened, and truncated, on the next frame */
+	if (hfb->crclog_fd >= 0)
+		linux_close(hfb->crclog_fd);
+	hfb->crclog_fd = -1;
+
+	return 0;
+}
+
+static struct fb_ops headlessfb_ops = {
+	.fb_flush	= headlessfb_flush,
+};
+
+static int headlessfb_probe(struct device_d *dev)
+{
+	struct headlessfb *hfb;
+	struct fb_info *fb;
+	int ret;
+
+	if (!dev->platform_data)
+		return -EIO;
+
+	hfb = xzalloc(sizeof(*hfb));
+	hfb->crclog_fd = -1;
+	hfb->format = HEADLESSFB_PNG;
+
+	fb = &hfb->info;
+	fb->modes.modes = fb->mode = dev->platform_data;
+	fb->modes.num_modes = 1;
+	fb->xres = fb->mode->xres;
+	fb->yres = fb->mode->yres;
+
+	fb->bits_per_pixel = 32;
+	fb->transp.length = 8;
+	fb->red.length = 8;
+	fb->green.length = 8;
+	fb->blue.length = 8;
+	fb->transp.offset = 24;
+	fb->red.offset = 16;
+	fb->green.offset = 8;
+	fb->blue.offset = 0;
+
+	fb->priv = hfb;
+	fb->fbops = &headlessfb_ops;
+
+	fb->dev.parent = dev;
+	fb->screen_base = xzalloc(fb->xres * fb->yres *
+				  fb->bits_per_pixel >> 3);
+
+	dev->priv = hfb;
+
+	ret = register_framebuffer(fb);
+	if (ret) {
+		free(fb->screen_base);
+		free(hfb);
+		return ret;
+	}
+
+	dev_add_param_string(&fb->dev, "capture", NULL, NULL,
+			     &hfb->capture, hfb);
+	dev_add_param_uint32(&fb->dev, "capture_interval", NULL, NULL,
+			     &hfb->interval, "%u", hfb);
+	dev_add_param_enum(&fb->dev, "capture_format", NULL, NULL,
+			   &hfb->format, headlessfb_format_names,
+			   ARRAY_SIZE(headlessfb_format_names), hfb);
+	dev_add_param_string(&fb->dev, "crclog", headlessfb_crclog_set, NULL,
+			     &hfb->crclog, hfb);
+	dev_add_param_uint32_ro(&fb->dev, "frames", &hfb->frames, "%u");
+
+	return 0;
+}
+
+static void headlessfb_remove(struct device_d *dev)
+{
+	struct headlessfb *hfb = dev->priv;
+
+	if (hfb->crclog_fd >= 0)
+		linux_close(hfb->crclog_fd);
+
+	free(hfb->png);
+	free(hfb->info.screen_base);
+	free(hfb);
+}
+
+static struct driver_d headlessfb_driver = {
+	.name	= "headlessfb",
+	.probe	= headlessfb_probe,
+	.remove	= headlessfb_remove,
+};
+device_platform_driver(headlessfb_driver);
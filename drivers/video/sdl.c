@@ -34,9 +34,24 @@ static void sdlfb_disable(struct fb_info *info)
 	sdl_video_close();
 }
 
+/* Hand the damaged region, or the whole screen, to the scanout thread */
+static void sdlfb_flush(struct fb_info *info)
+{
+	struct fb_rect *d = &info->damage;
+
+	if (!info->enabled)
+		return;
+
+	if (d->x1 < d->x2 && d->y1 < d->y2)
+		sdl_video_damage(d->x1, d->y1, d->x2 - d->x1, d->y2 - d->y1);
+	else
+		sdl_video_damage(0, 0, info->xres, info->yres);
+}
+
 static struct fb_ops sdlfb_ops = {
 	.fb_enable	= sdlfb_enable,
 	.fb_disable	= sdlfb_disable,
+	.fb_flush	= sdlfb_flush,
 };
 
 static int sdlfb_probe(struct device_d *dev)
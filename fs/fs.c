@@ -1075,6 +1075,28 @@ bool __is_tftp_fs(const char *path)
 	return true;
 }
 
+/**
+ * __is_nfs_fs() - return true when path is mounted on NFS
+ * @path: The path
+ *
+ * Do not use directly, use is_nfs_fs instead.
+ *
+ * Return: true when @path is on NFS, false otherwise
+ */
+bool __is_nfs_fs(const char *path)
+{
+	struct fs_device_d *fsdev;
+
+	fsdev = get_fsdevice_by_path(path);
+	if (!fsdev)
+		return false;
+
+	if (strcmp(fsdev->driver->drv.name, "nfs"))
+		return false;
+
+	return true;
+}
+
 /* inode.c */
 unsigned int get_next_ino(void)
 {
@@ -30,10 +30,10 @@
 #include <init.h>
 #include <linux/stat.h>
 #include <linux/err.h>
-#include <kfifo.h>
 #include <linux/sizes.h>
 #include <byteorder.h>
 #include <globalvar.h>
+#include <magicvar.h>
 #include <parseopt.h>
 
 #define SUNRPC_PORT     111
@@ -122,6 +122,16 @@ struct rpc_reply {
 #define NFS_TIMEOUT	(100 * MSECOND)
 #define NFS_MAX_RESEND	100
 
+/*
+ * A READ reply has to fit into a single frame, barebox does not
+ * reassemble IP fragments.
+ */
+#define NFS_READ_SIZE		1024
+#define NFS_READ_WINDOW		8
+#define NFS_MAX_READ_WINDOW	64
+
+static int nfs_read_window = NFS_READ_WINDOW;
+
 struct nfs_fh {
 	unsigned short size;
 	unsigned char data[NFS3_FHSIZE];
@@ -144,13 +154,46 @@ struct nfs_priv {
 	uint32_t rpc_id;
 	struct nfs_fh rootfh;
 	struct list_head packets;
+	struct list_head files;	/* open files, see nfs_read_poll() */
+};
+
+enum nfs_slot_state {
+	NFS_SLOT_FREE,
+	NFS_SLOT_SENT,
+	NFS_SLOT_DONE,
+};
+
+/* One outstanding READ request and, once it is answered, its data */
+struct nfs_read_slot {
+	enum nfs_slot_state state;
+	uint32_t xid;
+	uint64_t offset;
+	uint32_t len;		/* bytes asked for */
+	uint32_t rlen;		/* bytes received */
+	int eof;
+	int err;
+	int tries;
+	uint64_t sent;
+	char data[NFS_READ_SIZE];
 };
 
 struct file_priv {
-	struct kfifo *fifo;
 	void *buf;
 	struct nfs_priv *npriv;
+	struct list_head list;
 	struct nfs_fh fh;
+
+	/*
+	 * Ring of READ requests for consecutive parts of the file, starting
+	 * with the one at pos in slots[head]. Replies may complete the slots
+	 * in any order, read() returns the data in order.
+	 */
+	struct nfs_read_slot *slots;
+	int nslots;
+	int head;
+	uint32_t head_off;	/* bytes of slots[head] already returned */
+	uint64_t pos;		/* file offset read() continues at */
+	uint64_t next_offset;	/* offset of the next READ to start */
 };
 
 struct nfs_inode {
@@ -458,29 +501,21 @@ static void nfs_free_packet(struct packet *packet)
 }
 
 /*
- * rpc_req - synchronous RPC request
+ * rpc_send - send an RPC call without waiting for the reply
  */
-static struct packet *rpc_req(struct nfs_priv *npriv, int rpc_prog,
-			      int rpc_proc, uint32_t *data, int datalen)
+static int rpc_send(struct nfs_priv *npriv, int rpc_prog, int rpc_proc,
+		    uint32_t xid, uint32_t *data, int datalen)
 {
 	struct rpc_call pkt;
 	unsigned short dport;
-	int ret;
 	unsigned char *payload = net_udp_get_payload(npriv->con);
-	int nfserr;
-	int tries = 0;
-	struct packet *packet;
-
-	npriv->rpc_id++;
 
-	pkt.id = hton32(npriv->rpc_id);
+	pkt.id = hton32(xid);
 	pkt.type = hton32(MSG_CALL);
 	pkt.rpcvers = hton32(2);	/* use RPC version 2 */
 	pkt.prog = hton32(rpc_prog);
 	pkt.proc = hton32(rpc_proc);
 
-	debug("%s: prog: %d, proc: %d\n", __func__, rpc_prog, rpc_proc);
-
 	if (rpc_prog == PROG_PORTMAP) {
 		dport = SUNRPC_PORT;
 		pkt.vers = hton32(2);
@@ -497,11 +532,30 @@ static struct packet *rpc_req(struct nfs_priv *npriv, int rpc_prog,
 
 	npriv->con->udp->uh_dport = hton16(dport);
 
+	return net_udp_send(npriv->con,
+			sizeof(pkt) + datalen * sizeof(uint32_t));
+}
+
+/*
+ * rpc_req - synchronous RPC request
+ */
+static struct packet *rpc_req(struct nfs_priv *npriv, int rpc_prog,
+			      int rpc_proc, uint32_t *data, int datalen)
+{
+	int ret;
+	int nfserr;
+	int tries = 0;
+	struct packet *packet;
+
+	npriv->rpc_id++;
+
+	debug("%s: prog: %d, proc: %d\n", __func__, rpc_prog, rpc_proc);
+
 	nfs_timer_start = get_time_ns();
 
 again:
-	ret = net_udp_send(npriv->con,
-			sizeof(pkt) + datalen * sizeof(uint32_t));
+	ret = rpc_send(npriv, rpc_prog, rpc_proc, npriv->rpc_id,
+		       data, datalen);
 	if (ret) {
 		if (is_timeout(nfs_timer_start, NFS_TIMEOUT)) {
 			tries++;
@@ -964,16 +1018,13 @@ static void *nfs_readdirattr_req(struct nfs_priv *npriv, struct nfs_dir *dir)
 }
 
 /*
- * nfs_read_req - Read File on NFS Server
+ * nfs_read_send - (re)send the READ request of a slot
  */
-static int nfs_read_req(struct file_priv *priv, uint64_t offset,
-		uint32_t readlen)
+static void nfs_read_send(struct file_priv *priv, struct nfs_read_slot *slot)
 {
 	uint32_t data[1024];
-	uint32_t *p, status;
-	int len, ret;
-	struct packet *nfs_packet;
-	uint32_t rlen, eof;
+	uint32_t *p;
+	int len;
 
 	/*
 	 * struct READ3args {
@@ -981,7 +1032,92 @@ static int nfs_read_req(struct file_priv *priv, uint64_t offset,
 	 * 	offset3 offset;
 	 * 	count3 count;
 	 * };
-	 *
+	 */
+	p = &(data[0]);
+	p = rpc_add_credentials(p);
+
+	p = nfs_add_fh3(p, &priv->fh);
+	p = nfs_add_uint64(p, slot->offset);
+	p = nfs_add_uint32(p, slot->len);
+
+	len = p - &(data[0]);
+
+	slot->state = NFS_SLOT_SENT;
+	slot->sent = get_time_ns();
+
+	/* a failed send is retried like a lost request */
+	rpc_send(priv->npriv, PROG_NFS, NFSPROC3_READ, slot->xid, data, len);
+}
+
+static void nfs_read_start(struct file_priv *priv, struct nfs_read_slot *slot,
+			   uint64_t offset, uint32_t len)
+{
+	slot->xid = ++priv->npriv->rpc_id;
+	slot->offset = offset;
+	slot->len = len;
+	slot->rlen = 0;
+	slot->eof = 0;
+	slot->err = 0;
+	slot->tries = 0;
+
+	nfs_read_send(priv, slot);
+}
+
+static struct nfs_read_slot *nfs_read_find_slot(struct file_priv *priv,
+						 struct packet *packet)
+{
+	struct rpc_reply rpc;
+	int i;
+
+	if (packet->len < sizeof(struct rpc_reply))
+		return NULL;
+
+	memcpy(&rpc, packet->data, sizeof(rpc));
+
+	for (i = 0; i < priv->nslots; i++) {
+		if (priv->slots[i].state == NFS_SLOT_SENT &&
+		    priv->slots[i].xid == ntoh32(rpc.id))
+			return &priv->slots[i];
+	}
+
+	return NULL;
+}
+
+static bool nfs_read_is_foreign(struct file_priv *priv, struct packet *packet)
+{
+	struct file_priv *other;
+
+	if (nfs_read_find_slot(priv, packet))
+		return false;
+
+	list_for_each_entry(other, &priv->npriv->files, list) {
+		if (other != priv && nfs_read_find_slot(other, packet))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * nfs_read_reply - complete the slot a READ reply belongs to
+ */
+static void nfs_read_reply(struct file_priv *priv, struct packet *packet)
+{
+	struct nfs_read_slot *slot;
+	uint32_t *p, *end, status;
+	uint32_t rlen, eof, avail;
+	int ret, nfserr;
+
+	if (packet->len < sizeof(struct rpc_reply) + sizeof(uint32_t))
+		return;
+
+	slot = nfs_read_find_slot(priv, packet);
+
+	/* a late reply to a request we have given up on or already have */
+	if (!slot)
+		return;
+
+	/*
 	 * struct READ3resok {
 	 * 	post_op_attr file_attributes;
 	 * 	count3 count;
@@ -1000,28 +1136,36 @@ static int nfs_read_req(struct file_priv *priv, uint64_t offset,
 	 * 	READ3resfail resfail;
 	 * };
 	 */
-	p = &(data[0]);
-	p = rpc_add_credentials(p);
-
-	p = nfs_add_fh3(p, &priv->fh);
-	p = nfs_add_uint64(p, offset);
-	p = nfs_add_uint32(p, readlen);
-
-	len = p - &(data[0]);
+	ret = rpc_check_reply(packet, PROG_NFS, slot->xid, &nfserr);
+	if (ret) {
+		slot->err = ret;
+		slot->state = NFS_SLOT_DONE;
+		return;
+	}
 
-	nfs_packet = rpc_req(priv->npriv, PROG_NFS, NFSPROC3_READ, data, len);
-	if (IS_ERR(nfs_packet))
-		return PTR_ERR(nfs_packet);
+	p = (void *)packet->data + sizeof(struct rpc_reply);
+	end = (void *)packet->data + packet->len;
 
-	p = (void *)nfs_packet->data + sizeof(struct rpc_reply);
 	status = ntoh32(net_read_uint32(p++));
 	if (status != NFS3_OK) {
-		pr_err("Read failed: %s\n", nfserrstr(status, &ret));
-		return ret;
+		pr_err("Read failed: %s\n", nfserrstr(status, &slot->err));
+		slot->state = NFS_SLOT_DONE;
+		return;
 	}
 
+	/*
+	 * A truncated reply is left alone, the request is resent when it
+	 * times out. Check for the attributes and for count, eof and the
+	 * length of data before reading them.
+	 */
+	if (end - p < 1 || (ntoh32(net_read_uint32(p)) && end - p < 1 + 21))
+		return;
+
 	p = nfs_read_post_op_attr(p, NULL);
 
+	if (end - p < 3)
+		return;
+
 	rlen = ntoh32(net_read_uint32(p));
 
 	/* skip over count */
@@ -1035,16 +1179,100 @@ static int nfs_read_req(struct file_priv *priv, uint64_t offset,
 	 */
 	p += 2;
 
-	if (readlen && !rlen && !eof) {
-		nfs_free_packet(nfs_packet);
-		return -EIO;
+	avail = (void *)end - (void *)p;
+	if (rlen > avail)
+		return;
+
+	slot->eof = eof;
+
+	if (rlen > slot->len || (!rlen && !slot->eof))
+		slot->err = -EIO;
+	else
+		memcpy(slot->data, p, rlen);
+
+	slot->rlen = rlen;
+	slot->state = NFS_SLOT_DONE;
+}
+
+/*
+ * nfs_read_poll - collect READ replies and resend requests that timed out
+ */
+static void nfs_read_poll(struct file_priv *priv)
+{
+	struct nfs_priv *npriv = priv->npriv;
+	struct nfs_read_slot *slot;
+	struct packet *packet, *tmp;
+	int i;
+
+	net_poll();
+
+	list_for_each_entry_safe(packet, tmp, &npriv->packets, list) {
+		/*
+		 * All open files share the connection. Leave replies to
+		 * another file's requests queued for it, dropping them would
+		 * only make it wait for the resend.
+		 */
+		if (nfs_read_is_foreign(priv, packet))
+			continue;
+
+		nfs_read_reply(priv, packet);
+		nfs_free_packet(packet);
 	}
 
-	kfifo_put(priv->fifo, (char *)p, rlen);
+	for (i = 0; i < priv->nslots; i++) {
+		slot = &priv->slots[i];
 
-	nfs_free_packet(nfs_packet);
+		if (slot->state != NFS_SLOT_SENT ||
+		    !is_timeout(slot->sent, NFS_TIMEOUT))
+			continue;
 
-	return 0;
+		if (++slot->tries == NFS_MAX_RESEND) {
+			slot->err = -ETIMEDOUT;
+			slot->state = NFS_SLOT_DONE;
+			continue;
+		}
+
+		nfs_read_send(priv, slot);
+	}
+}
+
+/*
+ * nfs_read_fill - start READ requests on all free slots
+ *
+ * Only the slot at pos is sent beyond the size the file had when it was
+ * opened, to find out whether it has grown.
+ */
+static void nfs_read_fill(struct file_priv *priv, loff_t size)
+{
+	struct nfs_read_slot *slot;
+	int i;
+
+	for (i = 0; i < priv->nslots; i++) {
+		slot = &priv->slots[(priv->head + i) % priv->nslots];
+
+		if (slot->state != NFS_SLOT_FREE)
+			continue;
+
+		if (i && priv->next_offset >= size)
+			break;
+
+		nfs_read_start(priv, slot, priv->next_offset, NFS_READ_SIZE);
+		priv->next_offset += NFS_READ_SIZE;
+	}
+}
+
+static void nfs_read_reset(struct file_priv *priv, uint64_t pos)
+{
+	int i;
+
+	/* replies to dropped requests no longer match any slot */
+	for (i = 0; i < priv->nslots; i++)
+		priv->slots[i].state = NFS_SLOT_FREE;
+
+	priv->head = 0;
+	priv->head_off = 0;
+	priv->pos = pos;
+	priv->next_offset = pos;
 }
 
 static void nfs_handler(void *ctx, char *p, unsigned len)
@@ -1067,9 +1295,8 @@ static int nfs_truncate(struct device_d *dev, FILE *f, loff_t size)
 
 static void nfs_do_close(struct file_priv *priv)
 {
-	if (priv->fifo)
-		kfifo_free(priv->fifo);
-
+	list_del(&priv->list);
+	free(priv->slots);
 	free(priv);
 }
 
@@ -1164,11 +1391,10 @@ static int nfs_open(struct device_d *dev, FILE *file, const char *filename)
 	file->priv = priv;
 	file->size = inode->i_size;
 
-	priv->fifo = kfifo_alloc(1024);
-	if (!priv->fifo) {
-		free(priv);
-		return -ENOMEM;
-	}
+	priv->nslots = clamp(nfs_read_window, 1, NFS_MAX_READ_WINDOW);
+	priv->slots = xzalloc(priv->nslots * sizeof(*priv->slots));
+
+	list_add_tail(&priv->list, &npriv->files);
 
 	return 0;
 }
@@ -1188,27 +1414,67 @@ static int nfs_write(struct device_d *_dev, FILE *file, const void *inbuf,
 	return -ENOSYS;
 }
 
+/*
+ * Sequential reads keep up to global.nfs.read_window READ requests in
+ * flight, so reading is not bound by the round trip time per request.
+ */
 static int nfs_read(struct device_d *dev, FILE *file, void *buf, size_t insize)
 {
 	struct file_priv *priv = file->priv;
+	struct nfs_read_slot *slot;
+	size_t outsize = 0;
+	uint32_t now;
+	int ret;
+
+	if (priv->pos != file->pos)
+		nfs_read_reset(priv, file->pos);
+
+	while (outsize < insize) {
+		nfs_read_fill(priv, file->size);
 
-	if (insize > 1024)
-		insize = 1024;
+		slot = &priv->slots[priv->head];
 
-	if (insize && !kfifo_len(priv->fifo)) {
-		int ret = nfs_read_req(priv, file->pos, insize);
-		if (ret)
+		while (slot->state == NFS_SLOT_SENT)
+			nfs_read_poll(priv);
+
+		if (slot->err) {
+			ret = slot->err;
+			nfs_read_reset(priv, file->pos);
 			return ret;
+		}
+
+		now = min_t(size_t, insize - outsize,
+			    slot->rlen - priv->head_off);
+
+		memcpy(buf + outsize, slot->data + priv->head_off, now);
+		outsize += now;
+		priv->head_off += now;
+		priv->pos += now;
+
+		if (priv->head_off < slot->rlen || slot->eof)
+			break;
+
+		if (slot->rlen < slot->len) {
+			/* short read, ask for the rest */
+			nfs_read_start(priv, slot, slot->offset + slot->rlen,
+				       slot->len - slot->rlen);
+		} else {
+			slot->state = NFS_SLOT_FREE;
+			priv->head = (priv->head + 1) % priv->nslots;
+		}
+
+		priv->head_off = 0;
 	}
 
-	return kfifo_get(priv->fifo, buf, insize);
+	return outsize;
 }
 
 static int nfs_lseek(struct device_d *dev, FILE *file, loff_t pos)
 {
 	struct file_priv *priv = file->priv;
 
-	kfifo_reset(priv->fifo);
+	if (pos != priv->pos)
+		nfs_read_reset(priv, pos);
 
 	return 0;
 }
@@ -1433,6 +1699,7 @@ static int nfs_probe(struct device_d *dev)
 	dev->priv = npriv;
 
 	INIT_LIST_HEAD(&npriv->packets);
+	INIT_LIST_HEAD(&npriv->files);
 
 	debug("nfs: mount: %s\n", fsdev->backingstore);
 
@@ -1551,7 +1818,11 @@ static int nfs_init(void)
 	rootnfsopts = xstrdup("v3,tcp");
 
 	globalvar_add_simple_string("linux.rootnfsopts", &rootnfsopts);
+	globalvar_add_simple_int("nfs.read_window", &nfs_read_window, "%d");
 
 	return register_fs_driver(&nfs_driver);
 }
 coredevice_initcall(nfs_init);
+
+BAREBOX_MAGICVAR(global.nfs.read_window,
+		 "Number of NFS READ requests kept in flight per file");
@@ -27,6 +27,8 @@
 #include <fcntl.h>
 #include <getopt.h>
 #include <init.h>
+#include <globalvar.h>
+#include <magicvar.h>
 #include <linux/stat.h>
 #include <linux/err.h>
 #include <kfifo.h>
@@ -64,8 +66,14 @@
 #define STATE_DONE	8
 
 #define TFTP_BLOCK_SIZE		512	/* default TFTP block size */
+#define TFTP_MAX_BLOCK_SIZE	1432	/* block size we ask for */
 #define TFTP_FIFO_SIZE		4096
 
+#define TFTP_WINDOWSIZE		8	/* blocks per ACK we ask for, RFC 7440 */
+#define TFTP_MAX_WINDOWSIZE	16	/* three windows must fit the rxbuf pool */
+
+static int tftp_windowsize = TFTP_WINDOWSIZE;
+
 #define TFTP_ERR_RESEND	1
 
 struct file_priv {
@@ -83,6 +91,23 @@ struct file_priv {
 	void *buf;
 	int blocksize;
 	int block_requested;
+	int windowsize;		/* negotiated, 1 without RFC 7440 */
+	int windowsize_req;
+	uint16_t window_start;	/* last block acknowledged */
+	int ack_due;
+	struct tftp_rxblock *window;	/* blocks ahead of a gap */
+	struct tftp_rxblock *rxq;	/* received data not read yet */
+	int rxq_size;
+	unsigned int rxq_head, rxq_tail;
+	int rxq_off;			/* bytes read from the oldest block */
+};
+
+/* a received block, kept in the packet it arrived in */
+struct tftp_rxblock {
+	struct net_rxbuf *buf;	/* NULL if unused */
+	void *data;
+	int len;
+	uint16_t block;
 };
 
 struct tftp_priv {
@@ -134,15 +159,20 @@ static int tftp_send(struct file_priv *priv)
 				"tsize%c"
 				"%lld%c"
 				"blksize%c"
-				"1432",
+				"%d",
 				priv->filename + 1, 0,
 				0,
 				0,
 				TIMEOUT, 0,
 				0,
 				priv->filesize, 0,
-				0);
+				0, TFTP_MAX_BLOCK_SIZE);
 		pkt++;
+		if (priv->windowsize_req > 1) {
+			pkt += sprintf((unsigned char *)pkt, "windowsize%c%d",
+				       0, priv->windowsize_req);
+			pkt++;
+		}
 		len = pkt - xp;
 		break;
 
@@ -155,6 +185,8 @@ static int tftp_send(struct file_priv *priv)
 		*s++ = htons(TFTP_ACK);
 		*s++ = htons(priv->block);
 		priv->block_requested = priv->block;
+		priv->window_start = priv->block;
+		priv->ack_due = 0;
 		pkt = (unsigned char *)s;
 		len = pkt - xp;
 		break;
@@ -233,7 +265,12 @@ static void tftp_parse_oack(struct file_priv *priv, unsigned char *pkt, int len)
 		if (!strcmp(opt, "tsize"))
 			priv->filesize = simple_strtoull(val, NULL, 10);
 		if (!strcmp(opt, "blksize"))
-			priv->blocksize = simple_strtoul(val, NULL, 10);
+			priv->blocksize = min_t(int, TFTP_MAX_BLOCK_SIZE,
+					simple_strtoul(val, NULL, 10));
+		if (!strcmp(opt, "windowsize"))
+			priv->windowsize = clamp_t(int,
+					simple_strtoul(val, NULL, 10),
+					1, priv->windowsize_req);
 		pr_debug("OACK opt: %s val: %s\n", opt, val);
 		s = val + strlen(val) + 1;
 	}
@@ -244,10 +281,126 @@ static void tftp_timer_reset(struct file_priv *priv)
 	priv->progress_timeout = priv->resend_timeout = get_time_ns();
 }
 
-static void tftp_recv(struct file_priv *priv,
-			uint8_t *pkt, unsigned len, uint16_t uh_sport)
+/* whether the receive queue can take the next window */
+static bool tftp_window_fits(struct file_priv *priv)
 {
-	uint16_t opcode;
+	return priv->rxq_size - (int)(priv->rxq_head - priv->rxq_tail) >=
+	       priv->windowsize;
+}
+
+static void tftp_ack_window(struct file_priv *priv)
+{
+	priv->ack_due = 1;
+
+	if (tftp_window_fits(priv))
+		tftp_send(priv);
+}
+
+/* queue the next block in order, the queue takes over the reference */
+static void tftp_put_block(struct file_priv *priv, struct net_rxbuf *buf,
+			   void *data, int len)
+{
+	struct tftp_rxblock *rb;
+
+	if (len) {
+		rb = &priv->rxq[priv->rxq_head++ % priv->rxq_size];
+		rb->buf = buf;
+		rb->data = data;
+		rb->len = len;
+	} else {
+		net_rxbuf_put(buf);
+	}
+
+	priv->last_block++;
+	priv->block = priv->last_block;
+
+	if (len < priv->blocksize) {
+		tftp_send(priv);
+		priv->err = 0;
+		priv->state = STATE_DONE;
+	}
+}
+
+/*
+ * With a window (RFC 7440) the server sends windowsize blocks per ACK.
+ * Blocks that arrive ahead of a missing one are kept until the gap is
+ * filled. The window is acknowledged once it arrived completely, or
+ * with the last block in order when its final block shows up behind a
+ * gap, so that the server resends from there.
+ *
+ * Blocks stay in the packets they arrived in until tftp_read() copies
+ * them out.
+ */
+static void tftp_recv_data(struct file_priv *priv, char *packet,
+			   unsigned int packet_len, uint16_t block,
+			   void *data, int len)
+{
+	uint16_t ahead = block - priv->last_block;
+	struct tftp_rxblock *wb;
+	struct net_rxbuf *buf;
+
+	if (ahead == 0 || ahead > priv->windowsize || len > priv->blocksize)
+		/* Same or an old block again; ignore it. */
+		return;
+
+	/* out of buffers, drop it like a lost packet */
+	if (priv->rxq_head - priv->rxq_tail == priv->rxq_size)
+		return;
+
+	buf = net_rxbuf_hold(packet, packet_len);
+	if (!buf)
+		return;
+
+	data = buf->data + ((char *)data - packet);
+
+	tftp_timer_reset(priv);
+
+	if (ahead > 1) {
+		wb = &priv->window[block % priv->windowsize];
+		net_rxbuf_put(wb->buf);
+		wb->buf = buf;
+		wb->data = data;
+		wb->len = len;
+		wb->block = block;
+
+		if ((uint16_t)(block - priv->window_start) >= priv->windowsize) {
+			pr_vdebug("gap after block %d\n", priv->last_block);
+			/* may repeat the last ACK, the server then resends */
+			priv->block_requested = -1;
+			tftp_ack_window(priv);
+		}
+
+		return;
+	}
+
+	tftp_put_block(priv, buf, data, len);
+
+	/* blocks kept from ahead of the gap follow it now */
+	while (priv->state != STATE_DONE && priv->windowsize > 1) {
+		block = priv->last_block + 1;
+		wb = &priv->window[block % priv->windowsize];
+
+		if (!wb->buf || wb->block != block)
+			break;
+
+		tftp_put_block(priv, wb->buf, wb->data, wb->len);
+		wb->buf = NULL;
+	}
+
+	if (priv->state == STATE_DONE)
+		return;
+
+	if ((uint16_t)(priv->last_block - priv->window_start) >= priv->windowsize)
+		tftp_ack_window(priv);
+}
+
+static void tftp_recv(struct file_priv *priv, char *packet,
+		      unsigned int packet_len)
+{
+	uint8_t *pkt = net_eth_to_udp_payload(packet);
+	unsigned len = net_eth_to_udplen(packet);
+	uint16_t uh_sport = net_eth_to_udphdr(packet)->uh_sport;
+	uint16_t opcode, block;
 
 	/* according to RFC1350 minimal tftp packet length is 4 bytes */
 	if (len < 4)
@@ -306,38 +459,31 @@ static void tftp_recv(struct file_priv *priv,
 		break;
 	case TFTP_DATA:
 		len -= 2;
-		priv->block = ntohs(*(uint16_t *)pkt);
+		block = ntohs(*(uint16_t *)pkt);
 
 		if (priv->state == STATE_RRQ || priv->state == STATE_OACK) {
 			/* first block received */
 			priv->state = STATE_RDATA;
 			priv->tftp_con->udp->uh_dport = uh_sport;
 			priv->last_block = 0;
+			priv->window_start = 0;
 
-			if (priv->block != 1) {	/* Assertion */
+			if (block != 1) {	/* Assertion */
 				pr_err("error: First block is not block 1 (%d)\n",
-					priv->block);
+					block);
 				priv->err = -EINVAL;
 				priv->state = STATE_DONE;
 				break;
 			}
+
+			pr_debug("blocksize %d, windowsize %d\n",
+				 priv->blocksize, priv->windowsize);
 		}
 
-		if (priv->block == priv->last_block)
-			/* Same block again; ignore it. */
+		if (priv->state != STATE_RDATA)
 			break;
 
-		priv->last_block = priv->block;
-
-		tftp_timer_reset(priv);
-
-		kfifo_put(priv->fifo, pkt + 2, len);
-
-		if (len < priv->blocksize) {
-			tftp_send(priv);
-			priv->err = 0;
-			priv->state = STATE_DONE;
-		}
+		tftp_recv_data(priv, packet, packet_len, block, pkt + 2, len);
 
 		break;
 
@@ -362,11 +508,21 @@ static void tftp_recv(struct file_priv *priv,
 static void tftp_handler(void *ctx, char *packet, unsigned len)
 {
 	struct file_priv *priv = ctx;
-	char *pkt = net_eth_to_udp_payload(packet);
-	struct udphdr *udp = net_eth_to_udphdr(packet);
 
-	(void)len;
-	tftp_recv(priv, pkt, net_eth_to_udplen(packet), udp->uh_sport);
+	tftp_recv(priv, packet, len);
+}
+
+static void tftp_free_blocks(struct tftp_rxblock *rb, int num)
+{
+	int i;
+
+	if (!rb)
+		return;
+
+	for (i = 0; i < num; i++)
+		net_rxbuf_put(rb[i].buf);
+
+	free(rb);
 }
 
 static struct file_priv *tftp_do_open(struct device_d *dev,
@@ -398,11 +554,24 @@ static struct file_priv *tftp_do_open(struct device_d *dev,
 	priv->filename = dpath(dentry, fsdev->vfsmount.mnt_root);
 	priv->blocksize = TFTP_BLOCK_SIZE;
 	priv->block_requested = -1;
-
-	priv->fifo = kfifo_alloc(TFTP_FIFO_SIZE);
-	if (!priv->fifo) {
-		ret = -ENOMEM;
-		goto out;
+	priv->windowsize = 1;
+
+	if (priv->push) {
+		/* windows are for reading only, we send one block per ACK */
+		priv->fifo = kfifo_alloc(TFTP_FIFO_SIZE);
+		if (!priv->fifo) {
+			ret = -ENOMEM;
+			goto out;
+		}
+	} else {
+		priv->windowsize_req = clamp(tftp_windowsize, 1,
+					     TFTP_MAX_WINDOWSIZE);
+
+		/* room for two windows, one is read while the next arrives */
+		priv->rxq_size = 2 * priv->windowsize_req;
+		priv->rxq = xzalloc(priv->rxq_size * sizeof(*priv->rxq));
+		priv->window = xzalloc(priv->windowsize_req *
+				       sizeof(*priv->window));
 	}
 
 	priv->tftp_con = net_udp_new(tpriv->server, TFTP_PORT, tftp_handler,
@@ -438,8 +607,11 @@ static struct file_priv *tftp_do_open(struct device_d *dev,
 out2:
 	net_unregister(priv->tftp_con);
 out1:
-	kfifo_free(priv->fifo);
+	if (priv->fifo)
+		kfifo_free(priv->fifo);
 out:
+	tftp_free_blocks(priv->rxq, priv->rxq_size);
+	tftp_free_blocks(priv->window, priv->windowsize_req);
 	free(priv);
 
 	return ERR_PTR(ret);
@@ -489,7 +661,10 @@ static int tftp_do_close(struct file_priv *priv)
 	}
 
 	net_unregister(priv->tftp_con);
-	kfifo_free(priv->fifo);
+	if (priv->fifo)
+		kfifo_free(priv->fifo);
+	tftp_free_blocks(priv->rxq, priv->rxq_size);
+	tftp_free_blocks(priv->window, priv->windowsize_req);
 	free(priv->filename);
 	free(priv->buf);
 	free(priv);
@@ -540,6 +715,32 @@ static int tftp_write(struct device_d *_dev, FILE *f, const void *inbuf,
 	return insize;
 }
 
+/* copy received data out, releasing the packets that are used up */
+static size_t tftp_get(struct file_priv *priv, void *buf, size_t size)
+{
+	struct tftp_rxblock *rb;
+	size_t done = 0, now;
+
+	while (size && priv->rxq_tail != priv->rxq_head) {
+		rb = &priv->rxq[priv->rxq_tail % priv->rxq_size];
+		now = min_t(size_t, size, rb->len - priv->rxq_off);
+
+		memcpy(buf + done, rb->data + priv->rxq_off, now);
+		done += now;
+		size -= now;
+		priv->rxq_off += now;
+
+		if (priv->rxq_off == rb->len) {
+			net_rxbuf_put(rb->buf);
+			rb->buf = NULL;
+			priv->rxq_tail++;
+			priv->rxq_off = 0;
+		}
+	}
+
+	return done;
+}
+
 static int tftp_read(struct device_d *dev, FILE *f, void *buf, size_t insize)
 {
 	struct file_priv *priv = f->priv;
@@ -549,14 +750,14 @@ static int tftp_read(struct device_d *dev, FILE *f, void *buf, size_t insize)
 	pr_vdebug("%s %zu\n", __func__, insize);
 
 	while (insize) {
-		now = kfifo_get(priv->fifo, buf, insize);
+		now = tftp_get(priv, buf, insize);
 		outsize += now;
 		buf += now;
 		insize -= now;
 		if (priv->state == STATE_DONE)
 			return outsize;
 
-		if (TFTP_FIFO_SIZE - kfifo_len(priv->fifo) >= priv->blocksize)
+		if (priv->ack_due && tftp_window_fits(priv))
 			tftp_send(priv);
 
 		ret = tftp_poll(priv);
@@ -748,6 +949,11 @@ static struct fs_driver_d tftp_driver = {
 
 static int tftp_init(void)
 {
+	globalvar_add_simple_int("tftp.windowsize", &tftp_windowsize, "%d");
+
 	return register_fs_driver(&tftp_driver);
 }
 coredevice_initcall(tftp_init);
+
+BAREBOX_MAGICVAR(global.tftp.windowsize,
+		 "TFTP blocks per ACK to ask for (RFC 7440), 1 to disable");
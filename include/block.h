@@ -16,6 +16,16 @@ struct block_device_ops {
 
 struct chunk;
 
+#define BLOCK_CHUNK_HASH_BITS	4
+
+struct block_cache_stats {
+	u64 hits;		/* blocks found in the cache */
+	u64 misses;		/* chunks read into the cache */
+	u64 bypass_reads;	/* reads done without the cache */
+	u64 bypass_blocks;	/* blocks read without the cache */
+	u64 readahead;		/* chunks read ahead of a miss */
+};
+
 struct block_device {
 	struct device_d *dev;
 	struct list_head list;
@@ -24,12 +34,25 @@ struct block_device {
 	blkcnt_t num_blocks;
 	int rdbufsize;
 	int blkmask;
+	blkcnt_t max_transfer_blocks;	/* most blocks in one read, 0 for the
+					 * default, at least rdbufsize
+					 */
 
 	sector_t discard_start;
 	blkcnt_t discard_size;
 
+	struct chunk *chunks;
 	struct list_head buffered_blocks;
 	struct list_head idle_blocks;
+	struct hlist_head chunk_hash[1 << BLOCK_CHUNK_HASH_BITS];
+
+	/* sequential read-ahead */
+	sector_t ra_next;	/* chunk after the last stream read */
+	sector_t ra_miss;	/* last miss outside the stream */
+	int ra_window;		/* chunks read on the last stream miss */
+	int ra_slot;		/* next read-ahead buffer to read into */
+
+	struct block_cache_stats stats;
 
 	struct cdev cdev;
 };
@@ -41,6 +64,14 @@ extern struct list_head block_device_list;
 int blockdevice_register(struct block_device *blk);
 int blockdevice_unregister(struct block_device *blk);
 
+#ifdef CONFIG_BLOCK
+void blockdevice_info(struct device_d *dev);
+#else
+static inline void blockdevice_info(struct device_d *dev)
+{
+}
+#endif
+
 int block_read(struct block_device *blk, void *buf, sector_t block, blkcnt_t num_blocks);
 int block_write(struct block_device *blk, void *buf, sector_t block, blkcnt_t num_blocks);
 
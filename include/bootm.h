@@ -132,6 +132,37 @@ static inline int bootm_verbose(struct image_data *data)
 }
 #endif
 
+/*
+ * Phases of loading an image. With bootm -v the time spent in each is
+ * accounted and printed before the OS is started.
+ */
+enum bootm_phase {
+	BOOTM_PHASE_READ,
+	BOOTM_PHASE_DECOMPRESS,
+	BOOTM_PHASE_VERIFY,
+	BOOTM_PHASE_FIXUP,
+	BOOTM_PHASE_NUM,
+};
+
+#ifdef CONFIG_BOOTM_VERBOSE
+u64 bootm_phase_start(void);
+void bootm_phase_add(enum bootm_phase phase, u64 ns);
+void bootm_phase_end(enum bootm_phase phase, u64 start);
+#else
+static inline u64 bootm_phase_start(void)
+{
+	return 0;
+}
+
+static inline void bootm_phase_add(enum bootm_phase phase, u64 ns)
+{
+}
+
+static inline void bootm_phase_end(enum bootm_phase phase, u64 start)
+{
+}
+#endif
+
 void bootm_data_init_defaults(struct bootm_data *data);
 
 int bootm_load_os(struct image_data *data, unsigned long load_address);
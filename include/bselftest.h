@@ -39,6 +39,24 @@ static unsigned int total_tests __initdata;	\
 static unsigned int failed_tests __initdata;	\
 static unsigned int skipped_tests __initdata
 
+static inline void __bselftest_ok(bool cond, unsigned int *total_tests,
+				  unsigned int *failed_tests,
+				  const char *func, int line)
+{
+	(*total_tests)++;
+	if (!cond) {
+		(*failed_tests)++;
+		printf("%s:%d: assertion failure\n", func, line);
+	}
+}
+
+/*
+ * ok - count a test and report it as failed when @cond is false.
+ * Uses the counters declared by BSELFTEST_GLOBALS().
+ */
+#define ok(cond) \
+	__bselftest_ok(cond, &total_tests, &failed_tests, __func__, __LINE__)
+
 #ifdef CONFIG_SELFTEST
 #define __bselftest_initcall(func) late_initcall(func)
 void selftests_run(void);
@@ -7,6 +7,7 @@
 #define __BTHREAD_H_
 
 #include <linux/stddef.h>
+#include <linux/types.h>
 
 struct bthread;
 
@@ -24,6 +25,7 @@ void *bthread_data(struct bthread *bthread);
 void bthread_info(void);
 const char *bthread_name(struct bthread *bthread);
 bool bthread_is_main(struct bthread *bthread);
+void bthread_set_slice(struct bthread *bthread, u64 slice_ns);
 
 /**
  * bthread_run - create and wake a thread.
@@ -45,10 +47,29 @@ bool bthread_is_main(struct bthread *bthread);
 
 #ifdef CONFIG_BTHREAD
 void bthread_reschedule(void);
+
+extern u64 bthread_slice_end;
+void __bthread_checkpoint(void);
+
+/**
+ * bthread_checkpoint - yield if the current thread's time slice is used up
+ *
+ * Cheap enough for the inner loops of long running threads: without a
+ * budget set with bthread_set_slice() it only tests a variable.
+ */
+static inline void bthread_checkpoint(void)
+{
+	if (bthread_slice_end)
+		__bthread_checkpoint();
+}
 #else
 static inline void bthread_reschedule(void)
 {
 }
+
+static inline void bthread_checkpoint(void)
+{
+}
 #endif
 
 #endif
@@ -78,6 +78,14 @@ struct fb_bitfield {
 					/* right */
 };
 
+/* Region of the screen, x2 and y2 exclusive */
+struct fb_rect {
+	u32 x1;
+	u32 y1;
+	u32 x2;
+	u32 y2;
+};
+
 struct fb_info;
 
 struct fb_ops {
@@ -145,6 +153,10 @@ struct fb_info {
 					 * be created.
 					 */
 	int shadowfb;
+
+	struct fb_rect damage;		/* changed since the last flush, empty
+					 * if unknown
+					 */
 };
 
 struct display_timings *of_get_display_timings(struct device_node *np);
@@ -155,6 +167,14 @@ int register_framebuffer(struct fb_info *info);
 int fb_enable(struct fb_info *info);
 int fb_disable(struct fb_info *info);
 void fb_flush(struct fb_info *info);
+void fb_damage(struct fb_info *info, const struct fb_rect *rect);
+
+/* true if fb_damage() recorded a change since the last fb_flush() */
+static inline bool fb_damage_pending(struct fb_info *info)
+{
+	return info->damage.x1 < info->damage.x2 &&
+	       info->damage.y1 < info->damage.y2;
+}
 
 #define FBIOGET_SCREENINFO	_IOR('F', 1, loff_t)
 #define	FBIO_ENABLE		_IO('F', 2)
@@ -172,6 +192,7 @@ void fb_edid_add_modes(struct fb_info *info);
 void fb_of_reserve_add_fixup(struct fb_info *info);
 
 int register_fbconsole(struct fb_info *fb);
+int fbconsole_bench(struct fb_info *fb, bool immediate);
 void *fb_get_screen_base(struct fb_info *info);
 
 #endif /* __FB_H */
@@ -7,6 +7,7 @@
 #define __IMAGE_FIT_H__
 
 #include <linux/types.h>
+#include <linux/list.h>
 #include <bootm.h>
 
 struct fit_handle {
@@ -14,6 +15,10 @@ struct fit_handle {
 	void *fit_alloc;
 	size_t size;
 
+	char *filename;		/* the FIT file, NULL for fit_open_buf() */
+	int fd;			/* open on @filename */
+	struct list_head data;	/* image data read from @fd */
+
 	bool verbose;
 	enum bootm_verify verify;
 
@@ -6,8 +6,10 @@
 #include <dt-bindings/input/linux-event-codes.h>
 
 struct input_event {
+	uint16_t type;		/* EV_KEY or EV_REL */
 	uint16_t code;
-	uint16_t value;
+	int32_t value;
+	uint64_t time;		/* get_time_ns() when reported */
 };
 
 struct input_device {
@@ -16,6 +18,7 @@ struct input_device {
 };
 
 void input_report_key_event(struct input_device *idev, unsigned int code, int value);
+void input_report_rel_event(struct input_device *idev, unsigned int code, int value);
 
 int input_device_register(struct input_device *);
 void input_device_unregister(struct input_device *);
@@ -440,6 +440,27 @@ struct eth_device *eth_get_byname(const char *name);
  */
 int net_receive(struct eth_device *edev, unsigned char *pkt, int len);
 
+/* size of the data of a struct net_rxbuf, drivers may DMA full frames */
+#define NET_RXBUF_SIZE		2048
+
+/**
+ * struct net_rxbuf - reference counted receive buffer
+ * @data: the packet, starting with the ethernet header
+ * @len: length of the packet
+ */
+struct net_rxbuf {
+	unsigned char *data;
+	int len;
+	int refcount;
+	struct list_head list;	/* in the free pool */
+};
+
+struct net_rxbuf *net_rxbuf_alloc(void);
+void net_rxbuf_put(struct net_rxbuf *buf);
+struct net_rxbuf *net_rxbuf_hold(const char *packet, int len);
+struct net_rxbuf *net_receive_rxbuf(struct eth_device *edev,
+				    struct net_rxbuf *buf, int len);
+
 struct net_connection {
 	struct ethernet *et;
 	struct iphdr *ip;
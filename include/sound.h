@@ -9,15 +9,34 @@
 
 #define BELL_DEFAULT_FREQUENCY	-1
 
+enum sound_pcm_format {
+	SOUND_PCM_S16_MONO,
+	SOUND_PCM_S16_STEREO,
+};
+
+struct sound_pcm;
+
 struct sound_card {
 	const char *name;
 	int bell_frequency;
 	int (*beep)(struct sound_card *, unsigned freq, unsigned us);
 
+	/*
+	 * Optional PCM streaming. The core buffers written samples in a
+	 * ring and a poller submits them to the card whenever fewer than
+	 * half a ring of frames are left queued in the hardware.
+	 */
+	int (*pcm_open)(struct sound_card *, unsigned rate,
+			enum sound_pcm_format format);
+	unsigned (*pcm_queued)(struct sound_card *);
+	int (*pcm_submit)(struct sound_card *, const void *buf, unsigned nframes);
+	void (*pcm_close)(struct sound_card *);
+
 	/* private */
 	struct list_head list;
 	struct list_head tune;
 	struct poller_async poller;
+	struct sound_pcm *pcm;
 };
 
 int sound_card_register(struct sound_card *card);
@@ -27,6 +46,13 @@ int sound_card_beep_cancel(struct sound_card *card);
 
 struct sound_card *sound_card_get_default(void);
 
+int sound_card_pcm_open(struct sound_card *card, unsigned rate,
+			enum sound_pcm_format format, unsigned latency_us);
+unsigned sound_card_pcm_space(struct sound_card *card);
+unsigned sound_card_pcm_write(struct sound_card *card, const void *buf,
+			      unsigned nframes);
+void sound_card_pcm_close(struct sound_card *card);
+
 static inline int beep(int freq, unsigned us)
 {
 	return sound_card_beep(sound_card_get_default(), freq, us);
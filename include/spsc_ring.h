@@ -0,0 +1,189 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Lock-free single producer, single consumer ring of fixed size elements.
+ *
+ * The producer only writes @head, the consumer only writes @tail. Both
+ * indices run freely and are masked on access, so the ring holds up to
+ * nelem elements without a wasted slot. Index updates are published with
+ * release stores and read with acquire loads, which keeps the ring correct
+ * when producer and consumer run on different CPUs, in an interrupt
+ * handler, a poller or, on sandbox, a host thread.
+ */
+#ifndef __SPSC_RING_H
+#define __SPSC_RING_H
+
+#include <linux/types.h>
+#include <linux/kernel.h>
+#include <linux/bug.h>
+
+struct spsc_ring {
+	void *buf;
+	unsigned int esize;	/* size of one element */
+	unsigned int mask;	/* number of elements - 1 */
+	unsigned int head;	/* next element written, producer only */
+	unsigned int tail;	/* next element read, consumer only */
+};
+
+int spsc_ring_init(struct spsc_ring *r, void *buf, unsigned int esize,
+		   unsigned int nelem);
+struct spsc_ring *spsc_ring_alloc(unsigned int esize, unsigned int nelem);
+void spsc_ring_free(struct spsc_ring *r);
+
+#define spsc_ring_alloc_type(type, nelem) \
+	spsc_ring_alloc(sizeof(type), nelem)
+
+static inline unsigned int __spsc_ring_load(const unsigned int *idx)
+{
+	return __atomic_load_n(idx, __ATOMIC_ACQUIRE);
+}
+
+static inline void __spsc_ring_store(unsigned int *idx, unsigned int val)
+{
+	__atomic_store_n(idx, val, __ATOMIC_RELEASE);
+}
+
+static inline void *__spsc_ring_slot(struct spsc_ring *r, unsigned int idx)
+{
+	return r->buf + (idx & r->mask) * r->esize;
+}
+
+/**
+ * spsc_ring_size - number of elements the ring can hold
+ * @r: the ring
+ */
+static inline unsigned int spsc_ring_size(struct spsc_ring *r)
+{
+	return r->mask + 1;
+}
+
+/**
+ * spsc_ring_len - number of elements queued
+ * @r: the ring
+ *
+ * Exact when called by the producer or consumer, a snapshot otherwise.
+ */
+static inline unsigned int spsc_ring_len(struct spsc_ring *r)
+{
+	return __spsc_ring_load(&r->head) - __spsc_ring_load(&r->tail);
+}
+
+/**
+ * spsc_ring_space - number of free elements
+ * @r: the ring
+ */
+static inline unsigned int spsc_ring_space(struct spsc_ring *r)
+{
+	return spsc_ring_size(r) - spsc_ring_len(r);
+}
+
+/**
+ * spsc_ring_reserve - get free elements to fill in place
+ * @r: the ring
+ * @ptr: returns the first free element
+ *
+ * Producer only. Returns the number of free elements that follow @ptr
+ * without wrapping, 0 if the ring is full. Filled elements become
+ * visible to the consumer with spsc_ring_commit().
+ */
+static inline unsigned int spsc_ring_reserve(struct spsc_ring *r, void **ptr)
+{
+	unsigned int head = r->head;
+	unsigned int free = spsc_ring_size(r) -
+			    (head - __spsc_ring_load(&r->tail));
+	unsigned int contig = spsc_ring_size(r) - (head & r->mask);
+
+	*ptr = __spsc_ring_slot(r, head);
+
+	return min(free, contig);
+}
+
+/**
+ * spsc_ring_commit - publish elements filled after spsc_ring_reserve()
+ * @r: the ring
+ * @n: number of elements filled, at most what was reserved
+ */
+static inline void spsc_ring_commit(struct spsc_ring *r, unsigned int n)
+{
+	__spsc_ring_store(&r->head, r->head + n);
+}
+
+/**
+ * spsc_ring_peek - get queued elements to read in place
+ * @r: the ring
+ * @ptr: returns the oldest queued element
+ *
+ * Consumer only. Returns the number of queued elements that follow @ptr
+ * without wrapping, 0 if the ring is empty. The elements stay owned by
+ * the consumer until released with spsc_ring_consume().
+ */
+static inline unsigned int spsc_ring_peek(struct spsc_ring *r, void **ptr)
+{
+	unsigned int tail = r->tail;
+	unsigned int used = __spsc_ring_load(&r->head) - tail;
+	unsigned int contig = spsc_ring_size(r) - (tail & r->mask);
+
+	*ptr = __spsc_ring_slot(r, tail);
+
+	return min(used, contig);
+}
+
+/**
+ * spsc_ring_consume - release elements read after spsc_ring_peek()
+ * @r: the ring
+ * @n: number of elements read, at most what was peeked
+ */
+static inline void spsc_ring_consume(struct spsc_ring *r, unsigned int n)
+{
+	__spsc_ring_store(&r->tail, r->tail + n);
+}
+
+unsigned int spsc_ring_put(struct spsc_ring *r, const void *elems,
+			   unsigned int n);
+unsigned int spsc_ring_get(struct spsc_ring *r, void *elems, unsigned int n);
+
+/**
+ * spsc_ring_push - queue one element by value
+ * @r: the ring
+ * @val: the element, its type must match the ring's element size
+ *
+ * Producer only. Evaluates to true if @val was queued, false if the
+ * ring is full.
+ */
+#define spsc_ring_push(r, val)						\
+({									\
+	struct spsc_ring *__r = (r);					\
+	unsigned int __head = __r->head;				\
+	bool __ok = __head - __spsc_ring_load(&__r->tail) <= __r->mask;	\
+									\
+	BUG_ON(sizeof(val) != __r->esize);				\
+	if (__ok) {							\
+		*(typeof(val) *)__spsc_ring_slot(__r, __head) = (val);	\
+		__spsc_ring_store(&__r->head, __head + 1);		\
+	}								\
+	__ok;								\
+})
+
+/**
+ * spsc_ring_pop - dequeue one element by value
+ * @r: the ring
+ * @ptr: where to store the element, its type must match the ring's
+ *	 element size
+ *
+ * Consumer only. Evaluates to true if an element was stored to @ptr,
+ * false if the ring is empty.
+ */
+#define spsc_ring_pop(r, ptr)						\
+({									\
+	struct spsc_ring *__r = (r);					\
+	unsigned int __tail = __r->tail;				\
+	bool __ok = __spsc_ring_load(&__r->head) != __tail;		\
+									\
+	BUG_ON(sizeof(*(ptr)) != __r->esize);				\
+	if (__ok) {							\
+		*(ptr) = *(typeof(ptr))__spsc_ring_slot(__r, __tail);	\
+		__spsc_ring_store(&__r->tail, __tail + 1);		\
+	}								\
+	__ok;								\
+})
+
+#endif /* __SPSC_RING_H */
@@ -1,8 +1,30 @@
 #ifndef __SYS_MOUNT_H
 #define __SYS_MOUNT_H
 
+#include <linux/types.h>
+
 int mount(const char *device, const char *fsname, const char *path,
 		const char *fsoptions);
 int umount(const char *pathname);
 
+bool __is_tftp_fs(const char *path);
+
+static inline bool is_tftp_fs(const char *path)
+{
+	if (!IS_ENABLED(CONFIG_FS_TFTP))
+		return false;
+
+	return __is_tftp_fs(path);
+}
+
+bool __is_nfs_fs(const char *path);
+
+static inline bool is_nfs_fs(const char *path)
+{
+	if (!IS_ENABLED(CONFIG_FS_NFS))
+		return false;
+
+	return __is_nfs_fs(path);
+}
+
 #endif /* __SYS_MOUNT_H */
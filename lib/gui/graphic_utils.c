@@ -311,6 +311,12 @@ void gu_screen_blit_area(struct screen *sc, int startx, int starty, int width,
 {
 	struct fb_info *info = sc->info;
 	int bpp = info->bits_per_pixel >> 3;
+	struct fb_rect rect = {
+		.x1 = startx, .y1 = starty,
+		.x2 = startx + width, .y2 = starty + height,
+	};
+
+	fb_damage(info, &rect);
 
 	if (info->screen_base_shadow) {
 		int y;
@@ -328,6 +334,9 @@ void gu_screen_blit_area(struct screen *sc, int startx, int starty, int width,
 void gu_screen_blit(struct screen *sc)
 {
 	struct fb_info *info = sc->info;
+	struct fb_rect rect = { .x2 = info->xres, .y2 = info->yres };
+
+	fb_damage(info, &rect);
 
 	if (info->screen_base_shadow)
 		memcpy(info->screen_base, info->screen_base_shadow, sc->fbsize);
@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Lock-free single producer, single consumer ring
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <errno.h>
+#include <spsc_ring.h>
+#include <linux/log2.h>
+
+/**
+ * spsc_ring_init - set up a ring in a preallocated buffer
+ * @r: the ring
+ * @buf: buffer of @nelem elements
+ * @esize: size of one element
+ * @nelem: number of elements, must be a power of 2
+ *
+ * Return: 0 on success, -EINVAL if @nelem is not a power of 2
+ */
+int spsc_ring_init(struct spsc_ring *r, void *buf, unsigned int esize,
+		   unsigned int nelem)
+{
+	if (!esize || !is_power_of_2(nelem))
+		return -EINVAL;
+
+	r->buf = buf;
+	r->esize = esize;
+	r->mask = nelem - 1;
+	r->head = r->tail = 0;
+
+	return 0;
+}
+
+/**
+ * spsc_ring_alloc - allocate a ring and its buffer
+ * @esize: size of one element
+ * @nelem: number of elements, rounded up to a power of 2
+ *
+ * Return: the new ring, NULL if out of memory
+ */
+struct spsc_ring *spsc_ring_alloc(unsigned int esize, unsigned int nelem)
+{
+	struct spsc_ring *r;
+	void *buf;
+
+	if (!nelem || nelem > 0x80000000)
+		return NULL;
+
+	nelem = roundup_pow_of_two(nelem);
+
+	buf = calloc(nelem, esize);
+	if (!buf)
+		return NULL;
+
+	r = malloc(sizeof(*r));
+	if (!r) {
+		free(buf);
+		return NULL;
+	}
+
+	if (spsc_ring_init(r, buf, esize, nelem)) {
+		free(r);
+		free(buf);
+		return NULL;
+	}
+
+	return r;
+}
+
+/**
+ * spsc_ring_free - free a ring allocated with spsc_ring_alloc()
+ * @r: the ring
+ */
+void spsc_ring_free(struct spsc_ring *r)
+{
+	if (!r)
+		return;
+
+	free(r->buf);
+	free(r);
+}
+
+/**
+ * spsc_ring_put - copy elements into the ring
+ * @r: the ring
+ * @elems: the elements to queue
+ * @n: number of elements
+ *
+ * Producer only. Queues as many elements as there is room for and
+ * publishes them to the consumer at once.
+ *
+ * Return: the number of elements queued
+ */
+unsigned int spsc_ring_put(struct spsc_ring *r, const void *elems,
+			   unsigned int n)
+{
+	unsigned int head = r->head;
+	unsigned int free = spsc_ring_size(r) -
+			    (head - __spsc_ring_load(&r->tail));
+	unsigned int first;
+
+	n = min(n, free);
+
+	/* up to the end of the buffer, then the rest from its start */
+	first = min(n, spsc_ring_size(r) - (head & r->mask));
+	memcpy(__spsc_ring_slot(r, head), elems, first * r->esize);
+	memcpy(r->buf, elems + first * r->esize, (n - first) * r->esize);
+
+	spsc_ring_commit(r, n);
+
+	return n;
+}
+
+/**
+ * spsc_ring_get - copy elements out of the ring
+ * @r: the ring
+ * @elems: where to store the elements
+ * @n: maximum number of elements
+ *
+ * Consumer only.
+ *
+ * Return: the number of elements dequeued
+ */
+unsigned int spsc_ring_get(struct spsc_ring *r, void *elems, unsigned int n)
+{
+	unsigned int tail = r->tail;
+	unsigned int used = __spsc_ring_load(&r->head) - tail;
+	unsigned int first;
+
+	n = min(n, used);
+
+	first = min(n, spsc_ring_size(r) - (tail & r->mask));
+	memcpy(elems, __spsc_ring_slot(r, tail), first * r->esize);
+	memcpy(elems + first * r->esize, r->buf, (n - first) * r->esize);
+
+	spsc_ring_consume(r, n);
+
+	return n;
+}
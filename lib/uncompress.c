@@ -25,6 +25,8 @@
 #include <malloc.h>
 #include <fs.h>
 #include <libfile.h>
+#include <bootm.h>
+#include <clock.h>
 
 static void *uncompress_buf;
 static unsigned int uncompress_size;
@@ -35,10 +37,12 @@ void uncompress_err_stdout(char *x)
 }
 
 static int (*uncompress_fill_fn)(void*, unsigned int);
+static u64 uncompress_fill_ns;
 
 static int uncompress_fill(void *buf, unsigned int len)
 {
 	int total = 0;
+	u64 start;
 
 	if (uncompress_size) {
 		int now = min(len, uncompress_size);
@@ -51,7 +55,12 @@ static int uncompress_fill(void *buf, unsigned int len)
 	}
 
 	if (len) {
-		int ret = uncompress_fill_fn(buf, len);
+		int ret;
+
+		start = bootm_phase_start();
+		ret = uncompress_fill_fn(buf, len);
+		if (start)
+			uncompress_fill_ns += get_time_ns() - start;
 		if (ret < 0)
 			return ret;
 		total += ret;
@@ -76,6 +85,11 @@ int uncompress(unsigned char *inbuf, int len,
             void(*error)(char *x));
 	int ret;
 	char *err;
+	u64 start;
+
+	/* time spent in fill counts as reading, the rest as decompressing */
+	start = bootm_phase_start();
+	uncompress_fill_ns = 0;
 
 	if (inbuf) {
 		ft = file_detect_type(inbuf, len);
@@ -93,6 +107,9 @@ int uncompress(unsigned char *inbuf, int len,
 		if (ret < 0)
 			goto err;
 
+		if (start)
+			uncompress_fill_ns += get_time_ns() - start;
+
 		ft = file_detect_type(uncompress_buf, 32);
 	}
 
@@ -136,6 +153,14 @@ int uncompress(unsigned char *inbuf, int len,
 err:
 	free(uncompress_buf);
 
+	if (start) {
+		u64 total = get_time_ns() - start;
+
+		bootm_phase_add(BOOTM_PHASE_READ, uncompress_fill_ns);
+		bootm_phase_add(BOOTM_PHASE_DECOMPRESS,
+				total - min(total, uncompress_fill_ns));
+	}
+
 	return ret;
 }
 
@@ -45,7 +45,6 @@ int zlib_inflateReset(z_streamp strm)
     return Z_OK;
 }
 
-#if 0
 int zlib_inflatePrime(z_streamp strm, int bits, int value)
 {
     struct inflate_state *state;
@@ -58,7 +57,6 @@ int zlib_inflatePrime(z_streamp strm, int bits, int value)
     state->bits += bits;
     return Z_OK;
 }
-#endif
 
 int zlib_inflateInit2(z_streamp strm, int windowBits)
 {
@@ -761,7 +759,6 @@ int zlib_inflateEnd(z_streamp strm)
     return Z_OK;
 }
 
-#if 0
 int zlib_inflateSetDictionary(z_streamp strm, const Byte *dictionary,
         uInt dictLength)
 {
@@ -798,7 +795,6 @@ int zlib_inflateSetDictionary(z_streamp strm, const Byte *dictionary,
     state->havedict = 1;
     return Z_OK;
 }
-#endif
 
 #if 0
 /*
@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * rxbuf.c - reference counted receive buffers
+ *
+ * Drivers that receive into buffers from net_rxbuf_alloc() pass them up
+ * with net_receive_rxbuf(). A protocol handler that wants to keep the
+ * payload beyond its handler calls net_rxbuf_hold(), which then takes a
+ * reference instead of copying, and the driver continues with a spare
+ * buffer. Packets from drivers using plain net_receive() are copied once
+ * into a pool buffer when held.
+ */
+
+#define pr_fmt(fmt) "net: " fmt
+
+#include <common.h>
+#include <dma.h>
+#include <malloc.h>
+#include <net.h>
+
+/*
+ * buffers in the pool, enough for a few protocol windows in flight and
+ * the receive rings of converted drivers
+ */
+#define NET_RXBUF_NUM	96
+
+static LIST_HEAD(rxbuf_free);
+static int rxbufs_allocated;
+
+/* the buffer net_receive_rxbuf() is dispatching and its replacement */
+struct rxbuf_dispatch {
+	struct net_rxbuf *buf;
+	struct net_rxbuf *spare;
+};
+
+static struct rxbuf_dispatch *rxbuf_cur;
+
+/**
+ * net_rxbuf_alloc - get a receive buffer from the pool
+ *
+ * Return: a buffer with one reference, NULL if all are in use
+ */
+struct net_rxbuf *net_rxbuf_alloc(void)
+{
+	struct net_rxbuf *buf;
+
+	if (list_empty(&rxbuf_free)) {
+		if (rxbufs_allocated == NET_RXBUF_NUM)
+			return NULL;
+
+		buf = xzalloc(sizeof(*buf));
+		buf->data = dma_alloc(NET_RXBUF_SIZE);
+		rxbufs_allocated++;
+	} else {
+		buf = list_first_entry(&rxbuf_free, struct net_rxbuf, list);
+		list_del(&buf->list);
+	}
+
+	buf->refcount = 1;
+	buf->len = 0;
+
+	return buf;
+}
+
+/**
+ * net_rxbuf_put - drop a reference to a receive buffer
+ * @buf: the buffer, may be NULL
+ */
+void net_rxbuf_put(struct net_rxbuf *buf)
+{
+	if (!buf)
+		return;
+
+	if (--buf->refcount == 0)
+		list_add(&buf->list, &rxbuf_free);
+}
+
+/**
+ * net_rxbuf_hold - keep a received packet beyond its rx handler
+ * @packet: the packet passed to the handler
+ * @len: its length
+ *
+ * Return: a reference to a buffer holding the packet at the same offsets,
+ * NULL if no buffer is free. Release it with net_rxbuf_put().
+ */
+struct net_rxbuf *net_rxbuf_hold(const char *packet, int len)
+{
+	struct rxbuf_dispatch *d = rxbuf_cur;
+	struct net_rxbuf *buf;
+
+	if (d && packet == (char *)d->buf->data) {
+		/* the driver receives into the spare from now on */
+		if (!d->spare) {
+			d->spare = net_rxbuf_alloc();
+			if (!d->spare)
+				return NULL;
+		}
+
+		d->buf->refcount++;
+
+		return d->buf;
+	}
+
+	buf = net_rxbuf_alloc();
+	if (!buf)
+		return NULL;
+
+	memcpy(buf->data, packet, len);
+	buf->len = len;
+
+	return buf;
+}
+
+/**
+ * net_receive_rxbuf - pass a packet in a receive buffer to the stack
+ * @edev: the receiving device
+ * @buf: buffer from net_rxbuf_alloc() the packet was received into
+ * @len: length of the packet
+ *
+ * Return: the buffer to receive the next packet into. This is @buf unless
+ * a protocol kept the packet.
+ */
+struct net_rxbuf *net_receive_rxbuf(struct eth_device *edev,
+				    struct net_rxbuf *buf, int len)
+{
+	struct rxbuf_dispatch d = { .buf = buf }, *prev = rxbuf_cur;
+
+	buf->len = len;
+
+	rxbuf_cur = &d;
+	net_receive(edev, buf->data, len);
+	rxbuf_cur = prev;
+
+	if (!d.spare)
+		return buf;
+
+	net_rxbuf_put(buf);
+
+	return d.spare;
+}
@@ -0,0 +1,19 @@
+import pytest
+from .helper import *
+
+def test_headless_fb(barebox, barebox_config):
+    skip_disabled(barebox_config, "CONFIG_DRIVER_VIDEO_HEADLESS",
+                  "CONFIG_CMD_FBTEST")
+
+    frames = barebox.run_check("echo ${fb0.frames}")
+    if len(frames) == 0 or not frames[0].isdigit():
+        pytest.skip("fb0 is not the headless framebuffer")
+
+    before = int(frames[0])
+
+    # closing the framebuffer flushes it
+    barebox.run_check("fbtest -p solid -c ff0000")
+
+    after = int(barebox.run_check("echo ${fb0.frames}")[0])
+
+    assert after > before
@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <common.h>
+#include <bselftest.h>
+#include <crc.h>
+#include <malloc.h>
+
+BSELFTEST_GLOBALS();
+
+static void test_check_values(void)
+{
+	ok(crc32(0, "123456789", 9) == 0xcbf43926);
+	ok(crc32c(0, "123456789", 9) == 0xe3069283);
+	ok(crc32_bytewise(0, "123456789", 9) == 0xcbf43926);
+	ok(crc32c_bytewise(0, "123456789", 9) == 0xe3069283);
+	ok(crc32(0, NULL, 0) == 0);
+	ok(crc32_no_comp(0, "\0\0\0\0", 4) == 0);
+}
+
+#define BUF_SIZE	1024
+
+/* all lengths and alignments against the byte at a time versions */
+static void test_slice_by_8(void)
+{
+	unsigned char *buf;
+	unsigned int ofs, len, i;
+	bool good = true;
+
+	buf = malloc(BUF_SIZE);
+	if (!buf) {
+		ok(false);
+		return;
+	}
+
+	for (i = 0; i < BUF_SIZE; i++)
+		buf[i] = i * 131 + (i >> 3);
+
+	for (ofs = 0; ofs < 8; ofs++) {
+		for (len = 0; len <= BUF_SIZE - 8; len++) {
+			good &= crc32(ofs, buf + ofs, len) ==
+				crc32_bytewise(ofs, buf + ofs, len);
+			good &= crc32c(ofs, buf + ofs, len) ==
+				crc32c_bytewise(ofs, buf + ofs, len);
+		}
+	}
+	ok(good);
+
+	/* a CRC can be continued over several buffers */
+	ok(crc32(crc32(0, buf, 13), buf + 13, BUF_SIZE - 13) ==
+	   crc32(0, buf, BUF_SIZE));
+	ok(crc32c(crc32c(0, buf, 100), buf + 100, BUF_SIZE - 100) ==
+	   crc32c(0, buf, BUF_SIZE));
+
+	free(buf);
+}
+
+static void test_crc32(void)
+{
+	test_check_values();
+	test_slice_by_8();
+}
+bselftest(core, test_crc32);
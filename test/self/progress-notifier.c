@@ -8,18 +8,6 @@
 
 BSELFTEST_GLOBALS();
 
-static void __ok(bool cond, const char *func, int line)
-{
-	total_tests++;
-	if (!cond) {
-		failed_tests++;
-		printf("%s:%d: assertion failure\n", func, line);
-	}
-}
-
-#define ok(cond) \
-	__ok(cond, __func__, __LINE__)
-
 static unsigned long stage;
 static const void *prefix;
 static int counter;
@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <common.h>
+#include <bselftest.h>
+#include <clock.h>
+#include <kfifo.h>
+#include <malloc.h>
+#include <spsc_ring.h>
+#include <linux/math64.h>
+
+BSELFTEST_GLOBALS();
+
+struct elem {
+	u32 seq;
+	u16 a, b;
+};
+
+static void test_init(void)
+{
+	struct spsc_ring r, *pr;
+	u8 buf[8];
+
+	ok(spsc_ring_init(&r, buf, 1, 6) == -EINVAL);
+	ok(spsc_ring_init(&r, buf, 0, 8) == -EINVAL);
+	ok(spsc_ring_init(&r, buf, 1, 8) == 0);
+	ok(spsc_ring_size(&r) == 8);
+	ok(spsc_ring_len(&r) == 0);
+	ok(spsc_ring_space(&r) == 8);
+
+	pr = spsc_ring_alloc_type(struct elem, 5);
+	ok(pr != NULL);
+	if (!pr)
+		return;
+
+	ok(spsc_ring_size(pr) == 8);
+	ok(pr->esize == sizeof(struct elem));
+	spsc_ring_free(pr);
+}
+
+static void test_push_pop(void)
+{
+	struct spsc_ring *r;
+	struct elem e;
+	unsigned int i, seq = 0, next = 0;
+	bool good = true;
+
+	r = spsc_ring_alloc_type(struct elem, 4);
+	if (!r) {
+		ok(false);
+		return;
+	}
+
+	ok(!spsc_ring_pop(r, &e));
+
+	for (i = 0; i < 4; i++) {
+		e.seq = seq++;
+		ok(spsc_ring_push(r, e));
+	}
+
+	e.seq = seq;
+	ok(!spsc_ring_push(r, e));
+	ok(spsc_ring_len(r) == 4);
+
+	/* run the indices around the buffer many times */
+	for (i = 0; i < 1000; i++) {
+		good &= spsc_ring_pop(r, &e);
+		good &= e.seq == next++;
+		e.seq = seq++;
+		good &= spsc_ring_push(r, e);
+	}
+	ok(good);
+
+	while (spsc_ring_pop(r, &e))
+		good &= e.seq == next++;
+	ok(good);
+	ok(next == seq);
+	ok(spsc_ring_len(r) == 0);
+
+	spsc_ring_free(r);
+}
+
+static void test_reserve_commit(void)
+{
+	struct spsc_ring r;
+	u8 buf[8], out[8];
+	u8 *p;
+	unsigned int n;
+
+	spsc_ring_init(&r, buf, 1, 8);
+
+	n = spsc_ring_reserve(&r, (void **)&p);
+	ok(n == 8 && p == buf);
+	memcpy(p, "abcdef", 6);
+
+	/* nothing is visible before the commit */
+	ok(spsc_ring_len(&r) == 0);
+	spsc_ring_commit(&r, 6);
+	ok(spsc_ring_len(&r) == 6);
+
+	n = spsc_ring_peek(&r, (void **)&p);
+	ok(n == 6 && !memcmp(p, "abcdef", 6));
+	spsc_ring_consume(&r, 5);
+
+	/* free space wraps, reserve only returns the part up to the end */
+	n = spsc_ring_reserve(&r, (void **)&p);
+	ok(n == 2 && p == buf + 6);
+	memcpy(p, "gh", 2);
+	spsc_ring_commit(&r, 2);
+
+	n = spsc_ring_reserve(&r, (void **)&p);
+	ok(n == 5 && p == buf);
+
+	ok(spsc_ring_put(&r, "ijklmnop", 8) == 5);
+	ok(spsc_ring_space(&r) == 0);
+
+	n = spsc_ring_peek(&r, (void **)&p);
+	ok(n == 3 && !memcmp(p, "fgh", 3));
+
+	ok(spsc_ring_get(&r, out, sizeof(out)) == 8);
+	ok(!memcmp(out, "fghijklm", 8));
+	ok(spsc_ring_len(&r) == 0);
+}
+
+#define BENCH_BYTES	(1024 * 1024)
+#define BENCH_BURST	64
+
+static u64 bench_ns(u64 start)
+{
+	return get_time_ns() - start;
+}
+
+/*
+ * Not a pass/fail test: pass bytes through both rings, one at a time
+ * as the input console does and in bursts, and report the time taken.
+ */
+static void bench_kfifo(void)
+{
+	struct spsc_ring *r;
+	struct kfifo *f;
+	u8 burst[BENCH_BURST];
+	u64 start, t_kfifo, t_ring, t_kfifo_burst, t_ring_burst;
+	unsigned int i;
+	u8 c, sum = 0;
+
+	f = kfifo_alloc(256);
+	r = spsc_ring_alloc_type(u8, 256);
+	if (!f || !r)
+		goto out;
+
+	start = get_time_ns();
+	for (i = 0; i < BENCH_BYTES; i++) {
+		kfifo_putc(f, i);
+		kfifo_getc(f, &c);
+		sum += c;
+	}
+	t_kfifo = bench_ns(start);
+
+	start = get_time_ns();
+	for (i = 0; i < BENCH_BYTES; i++) {
+		spsc_ring_push(r, (u8)i);
+		spsc_ring_pop(r, &c);
+		sum -= c;
+	}
+	t_ring = bench_ns(start);
+
+	ok(sum == 0);
+
+	memset(burst, 0x55, sizeof(burst));
+
+	start = get_time_ns();
+	for (i = 0; i < BENCH_BYTES; i += BENCH_BURST) {
+		kfifo_put(f, burst, BENCH_BURST);
+		kfifo_get(f, burst, BENCH_BURST);
+	}
+	t_kfifo_burst = bench_ns(start);
+
+	start = get_time_ns();
+	for (i = 0; i < BENCH_BYTES; i += BENCH_BURST) {
+		spsc_ring_put(r, burst, BENCH_BURST);
+		spsc_ring_get(r, burst, BENCH_BURST);
+	}
+	t_ring_burst = bench_ns(start);
+
+	pr_info("%u bytes single: kfifo %llu us, spsc_ring %llu us\n",
+		BENCH_BYTES, div_u64(t_kfifo, 1000), div_u64(t_ring, 1000));
+	pr_info("%u bytes in %u byte bursts: kfifo %llu us, spsc_ring %llu us\n",
+		BENCH_BYTES, BENCH_BURST, div_u64(t_kfifo_burst, 1000),
+		div_u64(t_ring_burst, 1000));
+out:
+	spsc_ring_free(r);
+	if (f)
+		kfifo_free(f);
+}
+
+static void test_spsc_ring(void)
+{
+	test_init();
+	test_push_pop();
+	test_reserve_commit();
+	bench_kfifo();
+}
+bselftest(core, test_spsc_ring);